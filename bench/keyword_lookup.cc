@@ -0,0 +1,197 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * bench/keyword_lookup.cc:
+ *   Times the perfect hash keyword lookup against a std::unordered_map
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/keywords.hh"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using cascade::core::token;
+
+namespace util = cascade::util;
+
+/** @brief Number of times each measurement is repeated, the fastest run is reported */
+static constexpr int runs = 5;
+
+/**
+ * @brief Collects every spelling the keyword table knows about
+ * @return The spellings, each with the kind it maps to
+ */
+static std::vector<std::pair<std::string_view, token::kind>> spellings() {
+  auto result = std::vector<std::pair<std::string_view, token::kind>>{
+      {"true", token::kind::literal_bool},
+      {"false", token::kind::literal_bool},
+  };
+
+  for (auto i = 0; i <= static_cast<int>(token::kind::symbol_tilde); ++i) {
+    auto type = static_cast<token::kind>(i);
+    auto str = util::string_from_kind(type);
+
+    if (type != token::kind::literal_bool && !str.empty() && util::is_kind(str)
+        && util::kind_from_string(str) == type) {
+      result.emplace_back(str, type);
+    }
+  }
+
+  return result;
+}
+
+/**
+ * @brief Builds an identifier-heavy word list: real keywords, near misses that
+ * share a prefix or length with one, and ordinary identifiers
+ * @param keywords The spellings to build the words around
+ * @param count How many words to build
+ * @return The words
+ */
+static std::vector<std::string> generate(const std::vector<std::string_view> &keywords,
+    std::size_t count) {
+  static constexpr std::string_view identifiers[] = {
+      "x", "value", "buffer", "index", "result", "node", "count", "lhs", "rhs", "source",
+  };
+
+  auto engine = std::mt19937{42};
+  auto pick = std::uniform_int_distribution<std::size_t>{0, keywords.size() - 1};
+  auto coin = std::uniform_int_distribution<int>{0, 9};
+  auto result = std::vector<std::string>{};
+
+  result.reserve(count);
+
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    auto keyword = std::string{keywords[pick(engine)]};
+
+    switch (coin(engine)) {
+      case 0:
+      case 1:
+      case 2: result.push_back(keyword); break;
+      case 3: result.push_back(keyword + "s"); break;
+      case 4: result.push_back(keyword.substr(0, keyword.size() - 1)); break;
+      case 5: result.push_back("_" + keyword.substr(1)); break;
+      case 6: result.push_back(keyword + "_" + std::to_string(i % 100)); break;
+      default: result.emplace_back(identifiers[i % std::size(identifiers)]); break;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * @brief Runs @p fn `runs` times and returns the fastest time, in seconds
+ * @param fn The function, returns something that depends on its work so it isn't optimized out
+ * @param sink Where the results are accumulated
+ */
+template <class F> static double fastest(F fn, std::size_t &sink) {
+  auto best = 1e30;
+
+  for (auto i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+
+    sink += fn();
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    best = std::min(best, elapsed.count());
+  }
+
+  return best;
+}
+
+int main(int argc, char **argv) {
+  auto count = std::size_t{1} << 22;
+
+  if (argc == 2) {
+    count = std::strtoull(argv[1], nullptr, 10);
+  } else if (argc > 2) {
+    std::fprintf(stderr, "usage: %s [number of words]\n", argv[0]);
+
+    return 2;
+  }
+
+  auto table = spellings();
+  auto keywords = std::vector<std::string_view>{};
+  auto map = std::unordered_map<std::string_view, token::kind>{};
+
+  for (auto [str, type] : table) {
+    map.emplace(str, type);
+
+    // symbols never reach the lookup from an identifier, only words are used to build the input
+    if (std::isalpha(static_cast<unsigned char>(str.front()))) {
+      keywords.push_back(str);
+    }
+  }
+
+  auto storage = generate(keywords, count);
+  auto words = std::vector<std::string_view>(storage.begin(), storage.end());
+
+  auto with_map = [&](std::string_view word) {
+    auto it = map.find(word);
+
+    return (it == map.end()) ? token::kind::unknown : it->second;
+  };
+
+  for (auto word : words) {
+    if (util::kind_from_string(word) != with_map(word)
+        || util::is_kind(word) != (map.count(word) != 0)) {
+      std::fprintf(stderr, "lookups disagree on '%.*s'\n", static_cast<int>(word.size()), word.data());
+
+      return 1;
+    }
+  }
+
+  auto sink = std::size_t{0};
+
+  auto lookup = [&](auto fn) {
+    return [&words, fn] {
+      auto total = std::size_t{0};
+
+      for (auto word : words) {
+        total += static_cast<std::size_t>(fn(word));
+      }
+
+      return total;
+    };
+  };
+
+  auto hashed = fastest(lookup(util::kind_from_string), sink);
+  auto mapped = fastest(lookup(with_map), sink);
+  auto checked = fastest(lookup(util::is_kind), sink);
+  auto per_word = [&](double seconds) { return seconds * 1e9 / static_cast<double>(words.size()); };
+
+  std::printf("%zu words, %zu spellings\n\n", words.size(), table.size());
+  std::printf("%-28s %6.2f ns per lookup\n", "std::unordered_map", per_word(mapped));
+  std::printf("%-28s %6.2f ns per lookup (%.1fx)\n",
+      "util::kind_from_string",
+      per_word(hashed),
+      mapped / hashed);
+  std::printf("%-28s %6.2f ns per lookup\n", "util::is_kind", per_word(checked));
+
+  // printed so none of the work can be thrown away
+  std::printf("\n(checksum %zu)\n", sink);
+}
@@ -0,0 +1,276 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * bench/lexer_throughput.cc:
+ *   Measures how fast the lexer gets through comment- and indentation-heavy
+ *   sources, and how much the vectorized scanners gain over going byte by byte
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "core/lexer.hh"
+#include "errors/diagnostic.hh"
+#include "util/scanning.hh"
+#include "util/source_manager.hh"
+#include "util/thread_pool.hh"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using cascade::core::lexer;
+using cascade::errors::diagnostic_sink;
+using cascade::util::file_source;
+using cascade::util::source_manager;
+
+namespace util = cascade::util;
+
+/** @brief Number of times each measurement is repeated, the fastest run is reported */
+static constexpr int runs = 5;
+
+/**
+ * @brief Builds a source shaped like our generated code: long comment banners,
+ * deeply indented bodies and long line comments
+ * @param size The minimum size of the source
+ * @return The source
+ */
+static std::string generate(std::size_t size) {
+  auto banner = std::string(79, '-') + "\n";
+  auto indent = std::string(24, ' ');
+  auto result = std::string{};
+
+  result.reserve(size + 1024);
+
+  for (auto i = 0; result.size() < size; ++i) {
+    result += banner;
+    result += "-- generated from schema entry " + std::to_string(i) + "\n";
+    result += banner;
+    result += "-* block comment describing the function\n   over a few lines\n *-\n";
+    result += "fn f" + std::to_string(i) + "(a: i32, b: i32): i32 {\n";
+    result += indent + "let x = a * " + std::to_string(i) + ";\n";
+    result += indent + "-- explains what the next line does in some detail\n";
+    result += indent + "ret x + b;\n";
+    result += "}\n\n";
+  }
+
+  return result;
+}
+
+/**
+ * @brief Builds a source that's mostly identifiers, so interning them is a big
+ * part of lexing it
+ * @param size The minimum size of the source
+ * @return The source
+ */
+static std::string identifiers(std::size_t size) {
+  static constexpr const char *names[] = {
+      "value", "buffer", "index", "result", "node", "count", "source", "offset",
+  };
+
+  auto result = std::string{};
+
+  result.reserve(size + 1024);
+
+  for (auto i = 0u; result.size() < size; ++i) {
+    auto name = [i](unsigned n) { return names[(i + n) % 8] + std::to_string((i * n) % 64); };
+
+    result += "let " + name(1) + " = " + name(2) + " + " + name(3) + " * " + name(5) + ";\n";
+  }
+
+  return result;
+}
+
+/**
+ * @brief Runs @p fn `runs` times and returns the fastest time, in seconds
+ * @param fn The function, returns something that depends on its work so it isn't optimized out
+ * @param sink Where the results are accumulated
+ */
+template <class F> static double fastest(F fn, std::size_t &sink) {
+  auto best = 1e30;
+
+  for (auto i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+
+    sink += fn();
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    best = std::min(best, elapsed.count());
+  }
+
+  return best;
+}
+
+/**
+ * @brief Finds every offset the lexer would call a scanner from
+ * @param source The source
+ * @param starts Whether a scan starts at an offset, given the source and the offset
+ * @return The offsets
+ */
+template <class F> static std::vector<std::size_t> starts_in(std::string_view source, F starts) {
+  auto result = std::vector<std::size_t>{};
+
+  for (auto pos = std::size_t{0}; pos < source.size(); ++pos) {
+    if (starts(source, pos)) {
+      result.push_back(pos);
+    }
+  }
+
+  return result;
+}
+
+/** @brief Calls @p scan from every offset in @p starts, summing the results */
+template <class F>
+static std::size_t scan_from(std::string_view source,
+    const std::vector<std::size_t> &starts,
+    F scan) {
+  auto total = std::size_t{0};
+
+  for (auto pos : starts) {
+    total += scan(source, pos);
+  }
+
+  return total;
+}
+
+int main(int argc, char **argv) {
+  auto size = std::size_t{32} << 20;
+
+  if (argc == 2) {
+    size = std::strtoull(argv[1], nullptr, 10) << 20;
+  } else if (argc > 2) {
+    std::fprintf(stderr, "usage: %s [size in MiB]\n", argv[0]);
+
+    return 2;
+  }
+
+  auto text = generate(size);
+  auto file = source_manager::instance().add(file_source("bench.cas", text));
+  auto source = source_manager::instance().source(file);
+  auto sink = std::size_t{0};
+
+  std::printf("%zu bytes of source\n\n", source.size());
+
+  auto lex = [file] {
+    auto diagnostics = diagnostic_sink{file};
+
+    return lexer{file, diagnostics}.lex().size();
+  };
+
+  auto seconds = fastest(lex, sink);
+
+  std::printf("lexer::lex(): %.1f MB/s\n", static_cast<double>(source.size()) / seconds / 1e6);
+
+  // what the lexer did before the scanners existed, one byte at a time
+  auto bytewise_whitespace = [](std::string_view src, std::size_t pos) {
+    while (pos < src.size() && std::isspace(static_cast<unsigned char>(src[pos]))) {
+      ++pos;
+    }
+
+    return pos;
+  };
+
+  auto bytewise_newline = [](std::string_view src, std::size_t pos) {
+    while (pos < src.size() && src[pos] != '\n') {
+      ++pos;
+    }
+
+    return pos;
+  };
+
+  auto bytewise_block_end = [](std::string_view src, std::size_t pos) {
+    while (pos + 1 < src.size() && !(src[pos] == '*' && src[pos + 1] == '-')) {
+      ++pos;
+    }
+
+    return (pos + 1 < src.size()) ? pos : std::string_view::npos;
+  };
+
+  auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+
+  // whitespace is skipped from the start of each run, comments from just after their opener
+  auto whitespace = starts_in(source, [&](std::string_view src, std::size_t pos) {
+    return is_space(src[pos]) && (pos == 0 || !is_space(src[pos - 1]));
+  });
+
+  auto line_comments = starts_in(source, [](std::string_view src, std::size_t pos) {
+    return src.substr(pos, 2) == "--" && (pos == 0 || src[pos - 1] != '-');
+  });
+
+  auto block_comments = starts_in(source, [](std::string_view src, std::size_t pos) {
+    return src.substr(pos, 2) == "-*";
+  });
+
+  auto compare = [&](const char *what,
+                     const std::vector<std::size_t> &starts,
+                     auto before,
+                     auto after) {
+    auto slow = fastest([&] { return scan_from(source, starts, before); }, sink);
+    auto fast = fastest([&] { return scan_from(source, starts, after); }, sink);
+
+    std::printf("%-24s %8.2f ms byte by byte, %8.2f ms vectorized (%.1fx)\n",
+        what,
+        slow * 1e3,
+        fast * 1e3,
+        slow / fast);
+  };
+
+  std::printf("\n");
+  compare("skip_whitespace", whitespace, bytewise_whitespace, util::skip_whitespace);
+  compare("find_newline", line_comments, bytewise_newline, util::find_newline);
+  compare("find_block_comment_end",
+      block_comments,
+      bytewise_block_end,
+      util::find_block_comment_end);
+
+  // every identifier is interned, so this is also how well the interner scales
+  auto names = source_manager::instance().add(file_source("names.cas", identifiers(size)));
+  auto hardware = std::max(std::thread::hardware_concurrency(), 1u);
+
+  std::printf("\nlexer::lex(pool), identifier-heavy source:\n");
+
+  auto counts = std::vector<unsigned>{};
+
+  for (auto threads = 1u; threads < hardware; threads *= 2) {
+    counts.push_back(threads);
+  }
+
+  counts.push_back(hardware);
+
+  for (auto threads : counts) {
+    auto pool = util::thread_pool{threads};
+
+    auto parallel = [names, &pool] {
+      auto diagnostics = diagnostic_sink{names};
+
+      return lexer{names, diagnostics}.lex(pool).size();
+    };
+
+    auto elapsed = fastest(parallel, sink);
+    auto bytes = static_cast<double>(source_manager::instance().source(names).size());
+
+    std::printf("%4u thread(s) %8.1f MB/s\n", threads, bytes / elapsed / 1e6);
+  }
+
+  // printed so none of the work can be thrown away
+  std::printf("\n(checksum %zu)\n", sink);
+}
@@ -30,17 +30,33 @@
 #include "detail/nodes.hh"
 #include "detail/statements.hh"
 #include "detail/types.hh"
+#include "util/arena.hh"
 #include "util/mixins.hh"
 
 namespace cascade::ast {
+  /**
+   * @brief The AST for a single file
+   * @details Owns the arena every node in the file was allocated in, destroying
+   * the program releases the whole tree at once
+   */
   class program : util::noncopyable {
-    std::vector<std::unique_ptr<declaration>> m_decls;
+    util::arena m_nodes;
+    list<ptr<declaration>> m_decls;
 
   public:
-    explicit program(std::vector<std::unique_ptr<declaration>> &&decls)
-        : m_decls(std::move(decls)) {}
+    /**
+     * @brief Creates a program
+     * @param nodes The arena every node (and list) in @p decls was allocated in
+     * @param decls The top-level declarations
+     */
+    explicit program(util::arena nodes, list<ptr<declaration>> decls)
+        : m_nodes(std::move(nodes))
+        , m_decls(decls) {}
 
-    [[nodiscard]] std::vector<std::unique_ptr<declaration>> &decls() { return m_decls; }
+    [[nodiscard]] list<ptr<declaration>> decls() const { return m_decls; }
+
+    /** @brief Returns the arena the nodes are in, for adding to the tree after it's built */
+    [[nodiscard]] util::arena &nodes() { return m_nodes; }
   };
 
   template <class T> T node::accept(visitor<T> &visitor) {
@@ -103,6 +119,8 @@ namespace cascade::ast {
         return reinterpret_cast<mut &>(*this).visit_accept(visitor);
       case kind::statement_ret:
         return reinterpret_cast<ret &>(*this).visit_accept(visitor);
+      case kind::statement_loop:
+        return reinterpret_cast<loop &>(*this).visit_accept(visitor);
       case kind::type:
       case kind::type_implied:
       case kind::type_void:
@@ -27,13 +27,15 @@
 #include "ast/detail/expressions.hh"
 #include "ast/detail/nodes.hh"
 #include "core/lexer.hh"
+#include <cassert>
+#include <cstdint>
 
 namespace cascade::ast {
   /** @brief Represents a `const` declaration */
   class const_decl : public declaration, public visitable<const_decl> {
-    std::string m_name;
-    std::unique_ptr<expression> m_initializer;
-    std::unique_ptr<type> m_type;
+    util::symbol m_name;
+    ptr<expression> m_initializer;
+    ptr<type> m_type;
 
   public:
     /**
@@ -44,16 +46,21 @@ namespace cascade::ast {
      * @param type The type of the declaration
      */
     explicit const_decl(core::source_info info,
-        std::string name,
-        std::unique_ptr<expression> init,
-        std::unique_ptr<type> type)
+        util::symbol name,
+        ptr<expression> init,
+        ptr<type> type)
         : declaration(kind::declaration_const, std::move(info))
-        , m_name(std::move(name))
+        , m_name(name)
         , m_initializer(std::move(init))
         , m_type(std::move(type)) {}
 
     /** @brief Gets the name of the declaration */
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    /** @brief Gets the interned name */
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
 
     /** @brief Gets the expression that initializes the declaration */
     [[nodiscard]] expression &initializer() const { return *m_initializer; }
@@ -64,9 +71,9 @@ namespace cascade::ast {
 
   /** @brief Represents a `static` declaration */
   class static_decl : public declaration, public visitable<static_decl> {
-    std::string m_name;
-    std::unique_ptr<expression> m_initializer;
-    std::unique_ptr<type> m_type;
+    util::symbol m_name;
+    ptr<expression> m_initializer;
+    ptr<type> m_type;
 
   public:
     /**
@@ -77,16 +84,21 @@ namespace cascade::ast {
      * @param type The type of the declaration
      */
     explicit static_decl(core::source_info info,
-        std::string name,
-        std::unique_ptr<expression> init,
-        std::unique_ptr<type> type)
+        util::symbol name,
+        ptr<expression> init,
+        ptr<type> type)
         : declaration(kind::declaration_static, std::move(info))
-        , m_name(std::move(name))
+        , m_name(name)
         , m_initializer(std::move(init))
         , m_type(std::move(type)) {}
 
     /** @brief Gets the name of the declaration */
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    /** @brief Gets the interned name */
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
 
     /** @brief Gets the expression that initializes the declaration */
     [[nodiscard]] expression &initializer() const { return *m_initializer; }
@@ -97,28 +109,46 @@ namespace cascade::ast {
 
   /** @brief Represents a single argument declaration for a function */
   class argument : public declaration, public visitable<argument> {
-    std::string m_name;
-    std::unique_ptr<type> m_type;
+    util::symbol m_name;
+    ptr<type> m_type;
 
   public:
-    explicit argument(core::source_info info, std::string name, std::unique_ptr<type> type)
+    explicit argument(core::source_info info, util::symbol name, ptr<type> type)
         : declaration(kind::declaration_argument, std::move(info))
-        , m_name(std::move(name))
+        , m_name(name)
         , m_type(std::move(type)) {}
 
     /** @brief Returns the name of the argument */
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    /** @brief Gets the interned name */
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
 
     /** @brief Returns a pointer to the argument's type signature */
     [[nodiscard]] type &type() const { return *m_type; }
   };
 
+  /** @brief A range of indices into the tokens of a file, `end` is one past the last */
+  struct token_range {
+    std::uint32_t begin;
+
+    std::uint32_t end;
+  };
+
   /** @brief Represents a function */
   class fn : public declaration, public visitable<fn> {
-    std::string m_name;
-    std::vector<argument> m_args;
-    std::unique_ptr<type> m_return_type;
-    std::unique_ptr<expression> m_block;
+    util::symbol m_name;
+    list<argument> m_args;
+    ptr<type> m_return_type;
+    ptr<expression> m_block;
+
+    /** @brief The tokens of the body (braces included) if it was skipped by `core::skim` */
+    token_range m_body_tokens = {0, 0};
+
+    /** @brief Whether the skipped body was parsed and the parser couldn't recover */
+    bool m_body_failed = false;
 
   public:
     /**
@@ -129,32 +159,73 @@ namespace cascade::ast {
      * @param block The body of the function
      */
     explicit fn(core::source_info info,
-        std::string name,
-        std::vector<argument> args,
-        std::unique_ptr<type> type,
-        std::unique_ptr<expression> block)
+        util::symbol name,
+        list<argument> args,
+        ptr<type> type,
+        ptr<expression> block)
         : declaration(kind::declaration_fn, std::move(info))
-        , m_name(std::move(name))
+        , m_name(name)
         , m_args(std::move(args))
         , m_return_type(std::move(type))
         , m_block(std::move(block)) {}
 
+    /**
+     * @brief Creates a function whose body hasn't been parsed
+     * @param info The source info for the whole function
+     * @param name The name of the function
+     * @param args List of arguments and their type signatures
+     * @param body_tokens The tokens of the body, see `core::skimmed_program`
+     */
+    explicit fn(core::source_info info,
+        util::symbol name,
+        list<argument> args,
+        ptr<type> type,
+        token_range body_tokens)
+        : declaration(kind::declaration_fn, std::move(info))
+        , m_name(name)
+        , m_args(std::move(args))
+        , m_return_type(std::move(type))
+        , m_body_tokens(body_tokens) {}
+
     /** @brief Returns the name of the argument */
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    /** @brief Gets the interned name */
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
 
     /** @brief Returns a reference to the arguments */
-    [[nodiscard]] std::vector<argument> &args() { return m_args; }
+    [[nodiscard]] list<argument> args() const { return m_args; }
 
     /** @brief Returns a pointer to the argument's type signature */
     [[nodiscard]] type &type() const { return *m_return_type; }
 
-    /** @brief Returns a pointer to the body of the fn */
-    [[nodiscard]] expression &body() const { return *m_block; }
+    /** @brief Returns a pointer to the body of the fn, it must have been parsed */
+    [[nodiscard]] expression &body() const {
+      assert(m_block && "the body of a skimmed fn needs to be parsed first");
+      return *m_block;
+    }
+
+    /** @brief Returns whether the body was skipped and hasn't been parsed yet */
+    [[nodiscard]] bool skimmed() const { return !m_block; }
+
+    /** @brief Returns the tokens of a skipped body, braces included */
+    [[nodiscard]] token_range body_tokens() const { return m_body_tokens; }
+
+    /** @brief Fills in the body of a skimmed fn once it's been parsed */
+    void set_body(ptr<expression> block) { m_block = block; }
+
+    /** @brief Returns whether parsing the skipped body failed, it stays `skimmed()` */
+    [[nodiscard]] bool body_failed() const { return m_body_failed; }
+
+    /** @brief Marks the skipped body as unparseable so it isn't parsed again */
+    void set_body_failed() { m_body_failed = true; }
   };
 
   /** @brief Represents a module declaration for a file */
   class module_decl : public declaration, public visitable<module_decl> {
-    std::string m_name;
+    util::symbol m_name;
 
   public:
     /**
@@ -162,12 +233,17 @@ namespace cascade::ast {
      * @param info The source info
      * @param name The full module path
      */
-    explicit module_decl(core::source_info info, std::string name)
+    explicit module_decl(core::source_info info, util::symbol name)
         : declaration(kind::declaration_module, std::move(info))
-        , m_name(std::move(name)) {}
+        , m_name(name) {}
 
     /** @brief Returns the module name */
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    /** @brief Gets the interned name */
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
   };
 
   /** @brief Represents a module declaration for a file */
@@ -204,7 +280,7 @@ namespace cascade::ast {
 
   /** @brief Represents an exported entity */
   class export_decl : public declaration, public visitable<export_decl> {
-    std::unique_ptr<declaration> m_exported;
+    ptr<declaration> m_exported;
 
   public:
     /**
@@ -212,7 +288,7 @@ namespace cascade::ast {
      * @param info The source information
      * @param exported The entity being exported
      */
-    explicit export_decl(core::source_info info, std::unique_ptr<declaration> exported)
+    explicit export_decl(core::source_info info, ptr<declaration> exported)
         : declaration(kind::declaration_export, std::move(info))
         , m_exported(std::move(exported)) {}
 
@@ -221,8 +297,8 @@ namespace cascade::ast {
   };
 
   class type_decl : public declaration, public visitable<type_decl> {
-    std::unique_ptr<type> m_type;
-    std::string m_name;
+    ptr<type> m_type;
+    util::symbol m_name;
 
   public:
     /**
@@ -231,16 +307,21 @@ namespace cascade::ast {
      * @param type The type being aliased
      * @param name The name of the alias
      */
-    explicit type_decl(core::source_info info, std::unique_ptr<type> type, std::string name)
+    explicit type_decl(core::source_info info, ptr<type> type, util::symbol name)
         : declaration(kind::declaration_type, std::move(info))
         , m_type(std::move(type))
-        , m_name(std::move(name)) {}
+        , m_name(name) {}
 
     /** @brief Returns a pointer to the item being exported */
     [[nodiscard]] type &type() const { return *m_type; }
 
     /** @brief Returns a string_view to the alias given to the type */
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    /** @brief Gets the interned name */
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
   };
 } // namespace cascade::ast
 
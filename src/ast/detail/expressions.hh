@@ -30,43 +30,47 @@
 
 namespace cascade::ast {
   class identifier : public expression, public visitable<identifier> {
-    std::string m_name;
+    util::symbol m_name;
 
   public:
-    explicit identifier(core::source_info info, std::string_view name)
+    explicit identifier(core::source_info info, util::symbol name)
         : expression(kind::identifier, std::move(info))
-        , m_name(std::string{name}) {}
+        , m_name(name) {}
 
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
   };
 
   class call : public expression, public visitable<call> {
-    std::unique_ptr<expression> m_callee;
-    std::vector<std::unique_ptr<expression>> m_args;
+    ptr<expression> m_callee;
+    list<ptr<expression>> m_args;
 
   public:
     explicit call(core::source_info info,
-        std::unique_ptr<expression> callee,
-        std::vector<std::unique_ptr<expression>> args)
+        ptr<expression> callee,
+        list<ptr<expression>> args)
         : expression(kind::expression_call, std::move(info))
         , m_callee(std::move(callee))
         , m_args(std::move(args)) {}
 
     [[nodiscard]] expression &callee() const { return *m_callee; }
 
-    [[nodiscard]] const std::vector<std::unique_ptr<expression>> &args() const { return m_args; }
+    [[nodiscard]] list<ptr<expression>> args() const { return m_args; }
   };
 
   class binary : public expression, public visitable<binary> {
     core::token::kind m_op;
-    std::unique_ptr<expression> m_lhs;
-    std::unique_ptr<expression> m_rhs;
+    ptr<expression> m_lhs;
+    ptr<expression> m_rhs;
 
   public:
     explicit binary(core::source_info info,
         core::token::kind op,
-        std::unique_ptr<expression> lhs,
-        std::unique_ptr<expression> rhs)
+        ptr<expression> lhs,
+        ptr<expression> rhs)
         : expression(kind::expression_binary, std::move(info))
         , m_op(op)
         , m_lhs(std::move(lhs))
@@ -81,10 +85,10 @@ namespace cascade::ast {
 
   class unary : public expression, public visitable<unary> {
     core::token::kind m_op;
-    std::unique_ptr<expression> m_rhs;
+    ptr<expression> m_rhs;
 
   public:
-    explicit unary(core::source_info info, core::token::kind op, std::unique_ptr<expression> rhs)
+    explicit unary(core::source_info info, core::token::kind op, ptr<expression> rhs)
         : expression(kind::expression_unary, std::move(info))
         , m_op(op)
         , m_rhs(std::move(rhs)) {}
@@ -95,30 +99,34 @@ namespace cascade::ast {
   };
 
   class field_access : public expression, public visitable<field_access> {
-    std::unique_ptr<expression> m_accessed;
-    std::string m_field;
+    ptr<expression> m_accessed;
+    util::symbol m_field;
 
   public:
     explicit field_access(core::source_info info,
-        std::unique_ptr<expression> accessed,
-        std::string field)
+        ptr<expression> accessed,
+        util::symbol field)
         : expression(kind::expression_field_access, std::move(info))
         , m_accessed(std::move(accessed))
-        , m_field(std::move(field)) {}
+        , m_field(field) {}
 
     [[nodiscard]] expression &accessed() const { return *m_accessed; }
 
-    [[nodiscard]] std::string_view field_name() const { return m_field; }
+    [[nodiscard]] std::string_view field_name() const {
+      return util::interner::instance().lookup(m_field);
+    }
+
+    [[nodiscard]] util::symbol field_id() const { return m_field; }
   };
 
   class index : public expression, public visitable<index> {
-    std::unique_ptr<expression> m_array;
-    std::unique_ptr<expression> m_index;
+    ptr<expression> m_array;
+    ptr<expression> m_index;
 
   public:
     explicit index(core::source_info info,
-        std::unique_ptr<expression> array,
-        std::unique_ptr<expression> idx)
+        ptr<expression> array,
+        ptr<expression> idx)
         : expression(kind::expression_index, std::move(info))
         , m_array(std::move(array))
         , m_index(std::move(idx)) {}
@@ -129,15 +137,15 @@ namespace cascade::ast {
   };
 
   class if_else : public expression, public visitable<if_else> {
-    std::unique_ptr<expression> m_condition;
-    std::unique_ptr<expression> m_true;
-    std::optional<std::unique_ptr<expression>> m_false;
+    ptr<expression> m_condition;
+    ptr<expression> m_true;
+    std::optional<ptr<expression>> m_false;
 
   public:
     explicit if_else(core::source_info info,
-        std::unique_ptr<expression> cond,
-        std::unique_ptr<expression> true_clause,
-        std::optional<std::unique_ptr<expression>> else_clause = std::nullopt)
+        ptr<expression> cond,
+        ptr<expression> true_clause,
+        std::optional<ptr<expression>> else_clause = std::nullopt)
         : expression(kind::expression_if_else, std::move(info))
         , m_condition(std::move(cond))
         , m_true(std::move(true_clause))
@@ -157,21 +165,19 @@ namespace cascade::ast {
   };
 
   class block : public expression, public visitable<block> {
-    std::vector<std::unique_ptr<statement>> m_statements;
+    list<ptr<statement>> m_statements;
 
-    std::unique_ptr<type> m_return_type;
+    ptr<type> m_return_type;
 
   public:
     explicit block(core::source_info info,
-        std::vector<std::unique_ptr<statement>> stmts,
-        std::unique_ptr<type> type)
+        list<ptr<statement>> stmts,
+        ptr<type> type)
         : expression(kind::expression_block, std::move(info))
         , m_statements(std::move(stmts))
         , m_return_type(std::move(type)) {}
 
-    [[nodiscard]] const std::vector<std::unique_ptr<statement>> &statements() const {
-      return m_statements;
-    }
+    [[nodiscard]] list<ptr<statement>> statements() const { return m_statements; }
 
     [[nodiscard]] type &type() const { return *m_return_type; }
   };
@@ -179,23 +185,27 @@ namespace cascade::ast {
   class struct_init : public expression, public visitable<struct_init> {
   public:
     struct pair {
-      std::string field_name;
-      std::unique_ptr<expression> value;
+      util::symbol field_name;
+      ptr<expression> value;
     };
 
   private:
-    std::string m_struct_name;
-    std::vector<pair> m_init;
+    util::symbol m_struct_name;
+    list<pair> m_init;
 
   public:
-    explicit struct_init(core::source_info info, std::string name, std::vector<pair> inits)
+    explicit struct_init(core::source_info info, util::symbol name, list<pair> inits)
         : expression(kind::expression_struct, std::move(info))
-        , m_struct_name(std::move(name))
+        , m_struct_name(name)
         , m_init(std::move(inits)) {}
 
-    [[nodiscard]] const std::vector<pair> &pairs() const { return m_init; }
+    [[nodiscard]] list<pair> pairs() const { return m_init; }
+
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_struct_name);
+    }
 
-    [[nodiscard]] std::string_view name() const { return m_struct_name; }
+    [[nodiscard]] util::symbol name_id() const { return m_struct_name; }
   };
 } // namespace cascade::ast
 
@@ -82,17 +82,17 @@ namespace cascade::ast {
   };
 
   class string_literal : public literal, public visitable<string_literal> {
-    std::string m_value;
+    std::string_view m_value;
 
   public:
     /**
      * @brief Creates a new string literal
      * @param info The source info
-     * @param str Pointer to the literal string in the source
+     * @param str Pointer to the literal string in the source, sources outlive every AST
      */
     explicit string_literal(core::source_info info, std::string_view str)
         : literal(kind::literal_string, std::move(info))
-        , m_value(std::string{str}) {}
+        , m_value(str) {}
 
     [[nodiscard]] virtual bool is(literal_type type) const {
       return type == literal_type::lit_string;
@@ -102,41 +102,57 @@ namespace cascade::ast {
   };
 
   class int_literal : public literal, public visitable<int_literal> {
-    int m_value;
+    std::uint64_t m_value;
+
+    core::token::literal_suffix m_suffix;
 
   public:
     /**
      * @brief Creates a new int literal
      * @param info The source info
      * @param n The value of the literal
+     * @param suffix The width suffix the literal was written with
      */
-    explicit int_literal(core::source_info info, int n)
+    explicit int_literal(core::source_info info,
+        std::uint64_t n,
+        core::token::literal_suffix suffix = core::token::literal_suffix::none)
         : literal(kind::literal_number, std::move(info))
-        , m_value(n) {}
+        , m_value(n)
+        , m_suffix(suffix) {}
 
     [[nodiscard]] virtual bool is(literal_type type) const { return type == literal_type::lit_int; }
 
-    [[nodiscard]] int value() const { return m_value; }
+    [[nodiscard]] std::uint64_t value() const { return m_value; }
+
+    [[nodiscard]] core::token::literal_suffix suffix() const { return m_suffix; }
   };
 
   class float_literal : public literal, public visitable<float_literal> {
-    float m_value;
+    double m_value;
+
+    core::token::literal_suffix m_suffix;
 
   public:
     /**
      * @brief Creates a new float literal
      * @param info The source info
-     * @param n The value of the literal
+     * @param n The value of the literal, already rounded to f32 if it isn't an f64 literal
+     * @param suffix The width suffix the literal was written with
      */
-    explicit float_literal(core::source_info info, float n)
+    explicit float_literal(core::source_info info,
+        double n,
+        core::token::literal_suffix suffix = core::token::literal_suffix::none)
         : literal(kind::literal_float, std::move(info))
-        , m_value(n) {}
+        , m_value(n)
+        , m_suffix(suffix) {}
 
     [[nodiscard]] virtual bool is(literal_type type) const {
       return type == literal_type::lit_float;
     }
 
-    [[nodiscard]] float value() const { return m_value; }
+    [[nodiscard]] double value() const { return m_value; }
+
+    [[nodiscard]] core::token::literal_suffix suffix() const { return m_suffix; }
   };
 
   class bool_literal : public literal, public visitable<bool_literal> {
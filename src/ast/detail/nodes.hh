@@ -26,9 +26,16 @@
 
 #include "ast/visitor.hh"
 #include "core/lexer.hh"
+#include "util/arena.hh"
 #include <variant>
 
 namespace cascade::ast {
+  /** @brief Handle to a node, every node is owned by the arena of the `program` it's in */
+  template <class T> using ptr = util::arena_ptr<T>;
+
+  /** @brief A list of children, stored in the same arena as the node */
+  template <class T> using list = util::span<T>;
+
   /** @brief A type of node */
   enum class kind {
     literal_char,
@@ -62,6 +69,7 @@ namespace cascade::ast {
     statement_let,
     statement_mut,
     statement_ret,
+    statement_loop,
   };
 
   /** @brief Abstract base node type */
@@ -130,7 +138,9 @@ namespace cascade::ast {
     /** @brief Returns if the node is a statement */
     [[nodiscard]] virtual bool is_statement() const = 0;
 
-    virtual ~node(){};
+  protected:
+    // nodes are never destroyed through a base pointer, the arena destroys them by their real type
+    ~node() = default;
   };
 
   /** @brief "visitable" mixin for the AST types */
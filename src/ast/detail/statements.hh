@@ -30,10 +30,10 @@
 namespace cascade::ast {
   /** @brief Simply an expression in place of a statement */
   class expression_statement : public statement, public visitable<expression_statement> {
-    std::unique_ptr<expression> m_expr;
+    ptr<expression> m_expr;
 
   public:
-    explicit expression_statement(core::source_info info, std::unique_ptr<expression> expr)
+    explicit expression_statement(core::source_info info, ptr<expression> expr)
         : statement(kind::statement_expression, std::move(info))
         , m_expr(std::move(expr)) {}
 
@@ -41,54 +41,62 @@ namespace cascade::ast {
   };
 
   class let : public statement, public visitable<let> {
-    std::unique_ptr<expression> m_initializer;
-    std::unique_ptr<type> m_type;
-    std::string m_name;
+    ptr<expression> m_initializer;
+    ptr<type> m_type;
+    util::symbol m_name;
 
   public:
     explicit let(core::source_info info,
-        std::unique_ptr<expression> init,
-        std::unique_ptr<type> type,
-        std::string_view name)
+        ptr<expression> init,
+        ptr<type> type,
+        util::symbol name)
         : statement(kind::statement_let, std::move(info))
         , m_initializer(std::move(init))
         , m_type(std::move(type))
-        , m_name(std::string{name}) {}
+        , m_name(name) {}
 
     [[nodiscard]] expression &initializer() const { return *m_initializer; }
 
     [[nodiscard]] type &type() const { return *m_type; }
 
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
   };
 
   class mut : public statement, public visitable<mut> {
-    std::unique_ptr<expression> m_initializer;
-    std::unique_ptr<type> m_type;
-    std::string m_name;
+    ptr<expression> m_initializer;
+    ptr<type> m_type;
+    util::symbol m_name;
 
   public:
     explicit mut(core::source_info info,
-        std::unique_ptr<expression> init,
-        std::unique_ptr<type> type,
-        std::string_view name)
+        ptr<expression> init,
+        ptr<type> type,
+        util::symbol name)
         : statement(kind::statement_mut, std::move(info))
         , m_initializer(std::move(init))
         , m_type(std::move(type))
-        , m_name(std::string{name}) {}
+        , m_name(name) {}
 
     [[nodiscard]] expression &initializer() const { return *m_initializer; }
 
     [[nodiscard]] type &type() const { return *m_type; }
 
-    [[nodiscard]] std::string_view name() const { return m_name; }
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(m_name);
+    }
+
+    [[nodiscard]] util::symbol name_id() const { return m_name; }
   };
 
   class ret : public statement, public visitable<ret> {
-    std::optional<std::unique_ptr<expression>> m_return_value;
+    std::optional<ptr<expression>> m_return_value;
 
   public:
-    explicit ret(core::source_info info, std::optional<std::unique_ptr<expression>> ret_val)
+    explicit ret(core::source_info info, std::optional<ptr<expression>> ret_val)
         : statement(kind::statement_ret, std::move(info))
         , m_return_value(std::move(ret_val)) {}
 
@@ -102,14 +110,14 @@ namespace cascade::ast {
   };
 
   class loop : public statement, public visitable<loop> {
-    std::optional<std::unique_ptr<expression>> m_condition;
-    std::unique_ptr<expression> m_body;
+    std::optional<ptr<expression>> m_condition;
+    ptr<expression> m_body;
 
   public:
     explicit loop(core::source_info info,
-        std::optional<std::unique_ptr<expression>> condition,
-        std::unique_ptr<expression> body)
-        : statement(kind::statement_ret, std::move(info))
+        std::optional<ptr<expression>> condition,
+        ptr<expression> body)
+        : statement(kind::statement_loop, std::move(info))
         , m_condition(std::move(condition))
         , m_body(std::move(body)) {}
 
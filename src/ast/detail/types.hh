@@ -26,6 +26,7 @@
 
 #include "ast/detail/nodes.hh"
 #include "core/lexer.hh"
+#include "util/interner.hh"
 #include <cassert>
 #include <deque>
 #include <memory>
@@ -64,7 +65,7 @@ namespace cascade::ast {
      * @brief Represents either the precision of the builtin (if m_type ends as a builtin)
      * or the name of a userdef
      */
-    std::variant<std::size_t, std::string> m_data;
+    std::variant<std::size_t, util::strong_symbol> m_data;
 
   public:
     /**
@@ -80,11 +81,17 @@ namespace cascade::ast {
       m_data.emplace<std::size_t>(precision);
     }
 
-    type_data(std::deque<type_modifiers> modifs, type_base base, std::string name)
+    /**
+     * @brief Creates a user-defined type
+     * @param modifs The modifiers for the type
+     * @param base The base type, `user_defined`
+     * @param name The name of the type
+     */
+    type_data(std::deque<type_modifiers> modifs, type_base base, util::strong_symbol name)
         : m_modifiers(std::move(modifs))
         , m_base(base)
         , m_data() {
-      m_data.emplace<std::string>(std::move(name));
+      m_data.emplace<util::strong_symbol>(name);
     }
 
     /** @brief Returns a mutable reference to the type modifiers */
@@ -94,7 +101,7 @@ namespace cascade::ast {
     [[nodiscard]] type_base &base() { return m_base; }
 
     /** @brief Returns a mutable reference to the raw data variant */
-    [[nodiscard]] std::variant<std::size_t, std::string> &data() { return m_data; }
+    [[nodiscard]] std::variant<std::size_t, util::strong_symbol> &data() { return m_data; }
 
     /** @brief Returns a const reference to the type modifiers */
     [[nodiscard]] const std::deque<type_modifiers> &modifiers() const { return m_modifiers; }
@@ -103,13 +110,18 @@ namespace cascade::ast {
     [[nodiscard]] const type_base &base() const { return m_base; }
 
     /** @brief Returns a const reference to the raw data variant */
-    [[nodiscard]] const std::variant<std::size_t, std::string> &data() const { return m_data; }
+    [[nodiscard]] const std::variant<std::size_t, util::strong_symbol> &data() const { return m_data; }
 
     /** @brief Gets the data as a size_t */
     [[nodiscard]] std::size_t precision() const { return std::get<std::size_t>(m_data); }
 
-    /** @brief Gets the data as an std::string */
-    [[nodiscard]] std::string name() const { return std::get<std::string>(m_data); }
+    /** @brief Gets the data as the symbol of a userdef's name */
+    [[nodiscard]] util::symbol name_id() const { return std::get<util::strong_symbol>(m_data).id; }
+
+    /** @brief Gets the name of a userdef, resolved through the interner */
+    [[nodiscard]] std::string_view name() const {
+      return util::interner::instance().lookup(name_id());
+    }
 
     /**
      * @brief Performs memberwise equality on two type_data objects
@@ -222,9 +234,9 @@ namespace cascade::ast {
      * @param mods Any modifiers on the type (e.g &mut, *, [])
      * @param name The name of the userdefined type
      */
-    explicit type(core::source_info info, std::deque<type_modifiers> mods, std::string name)
+    explicit type(core::source_info info, std::deque<type_modifiers> mods, util::symbol name)
         : node(kind::type, std::move(info))
-        , m_type(std::move(mods), type_base::user_defined, std::move(name)) {}
+        , m_type(std::move(mods), type_base::user_defined, util::strong_symbol{name}) {}
 
     [[nodiscard]] virtual bool is_expression() const final { return false; }
 
@@ -0,0 +1,566 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * ast/flat.cc:
+ *   Implements flattening ASTs and turning flat ones back into nodes
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "ast/flat.hh"
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+using namespace cascade;
+using namespace ast;
+
+static_assert(sizeof(flat_node) == 12, "flat_node should stay 12 bytes");
+
+template <class T> static std::uint64_t bits_of(T value) {
+  static_assert(sizeof(T) == sizeof(std::uint64_t));
+
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  return bits;
+}
+
+static double double_of(std::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+namespace cascade::ast {
+  /** @brief Walks a tree of nodes and appends each one to a flat program */
+  class flattener : public visitor<node_ref> {
+    flat_program &m_flat;
+
+    /** @brief Refs that are about to be stored as a list, shared to avoid allocating */
+    std::vector<node_ref> m_pending;
+
+    /**
+     * @brief Adds a node, its children still need to be filled in
+     * @param node The node being added
+     * @param op The operator or suffix for the node
+     * @param lhs The first operand
+     * @return The ref for the new node
+     */
+    node_ref add(node &node, std::uint8_t op = 0, std::uint32_t lhs = 0) {
+      assert(node.info().file() == m_flat.m_file && "every node must be from the same file");
+
+      auto ref = static_cast<node_ref>(m_flat.m_nodes.size());
+
+      m_flat.m_nodes.push_back(
+          flat_node{static_cast<std::uint8_t>(node.raw_kind()), op, lhs, flat_program::none});
+      m_flat.m_info.push_back(
+          flat_info{static_cast<std::uint32_t>(node.info().position()),
+              static_cast<std::uint32_t>(node.info().length())});
+
+      return ref;
+    }
+
+    /** @brief Sets the operands of @p ref, the vector can be moved by adding children */
+    void set(node_ref ref, std::uint32_t lhs, std::uint32_t rhs) {
+      m_flat.m_nodes[ref].lhs = lhs;
+      m_flat.m_nodes[ref].rhs = rhs;
+    }
+
+    /** @brief Appends values to the extra table, returning the offset of the first */
+    std::uint32_t extra(std::initializer_list<std::uint32_t> values) {
+      auto at = static_cast<std::uint32_t>(m_flat.m_extra.size());
+
+      m_flat.m_extra.insert(m_flat.m_extra.end(), values);
+
+      return at;
+    }
+
+    /** @brief Stores the last @p count refs in `m_pending` as a list */
+    std::uint32_t list(std::size_t count) {
+      auto at = static_cast<std::uint32_t>(m_flat.m_extra.size());
+      auto first = m_pending.end() - static_cast<std::ptrdiff_t>(count);
+
+      m_flat.m_extra.push_back(static_cast<std::uint32_t>(count));
+      m_flat.m_extra.insert(m_flat.m_extra.end(), first, m_pending.end());
+      m_pending.erase(first, m_pending.end());
+
+      return at;
+    }
+
+    /** @brief Flattens an optional child */
+    node_ref optional(std::optional<std::reference_wrapper<expression>> child) {
+      return child ? child->get().accept(*this) : flat_program::none;
+    }
+
+  public:
+    explicit flattener(flat_program &flat) : m_flat(flat) {}
+
+    node_ref visit(type &ref) final {
+      auto self = add(ref, 0, static_cast<std::uint32_t>(m_flat.m_types.size()));
+
+      m_flat.m_types.push_back(ref.data());
+
+      return self;
+    }
+
+    node_ref visit(const_decl &ref) final {
+      auto self = add(ref);
+      auto init = ref.initializer().accept(*this);
+      auto type = ref.type().accept(*this);
+
+      set(self, init, extra({type, ref.name_id()}));
+
+      return self;
+    }
+
+    node_ref visit(static_decl &ref) final {
+      auto self = add(ref);
+      auto init = ref.initializer().accept(*this);
+      auto type = ref.type().accept(*this);
+
+      set(self, init, extra({type, ref.name_id()}));
+
+      return self;
+    }
+
+    node_ref visit(argument &ref) final {
+      auto self = add(ref);
+
+      set(self, ref.name_id(), ref.type().accept(*this));
+
+      return self;
+    }
+
+    node_ref visit(fn &ref) final {
+      auto self = add(ref);
+      auto type = ref.type().accept(*this);
+
+      for (auto &arg : ref.args()) {
+        m_pending.push_back(arg.accept(*this));
+      }
+
+      auto args = list(ref.args().size());
+      auto body = ref.skimmed() ? flat_program::none : ref.body().accept(*this);
+
+      set(self, extra({ref.name_id(), type, body}), args);
+
+      return self;
+    }
+
+    node_ref visit(module_decl &ref) final { return add(ref, 0, ref.name_id()); }
+
+    node_ref visit(import_decl &) final {
+      throw std::logic_error{"import declarations can't be flattened yet"};
+    }
+
+    node_ref visit(export_decl &ref) final {
+      auto self = add(ref);
+
+      set(self, ref.exported().accept(*this), flat_program::none);
+
+      return self;
+    }
+
+    node_ref visit(char_literal &ref) final {
+      return add(ref, 0, static_cast<unsigned char>(ref.value()));
+    }
+
+    node_ref visit(string_literal &ref) final {
+      auto self = add(ref, 0, static_cast<std::uint32_t>(m_flat.m_strings.size()));
+
+      m_flat.m_strings.push_back(ref.value());
+
+      return self;
+    }
+
+    node_ref visit(int_literal &ref) final {
+      auto self = add(ref,
+          static_cast<std::uint8_t>(ref.suffix()),
+          static_cast<std::uint32_t>(m_flat.m_numbers.size()));
+
+      m_flat.m_numbers.push_back(ref.value());
+
+      return self;
+    }
+
+    node_ref visit(float_literal &ref) final {
+      auto self = add(ref,
+          static_cast<std::uint8_t>(ref.suffix()),
+          static_cast<std::uint32_t>(m_flat.m_numbers.size()));
+
+      m_flat.m_numbers.push_back(bits_of(ref.value()));
+
+      return self;
+    }
+
+    node_ref visit(bool_literal &ref) final { return add(ref, 0, ref.value()); }
+
+    node_ref visit(identifier &ref) final { return add(ref, 0, ref.name_id()); }
+
+    node_ref visit(call &ref) final {
+      auto self = add(ref);
+      auto callee = ref.callee().accept(*this);
+
+      for (auto &arg : ref.args()) {
+        m_pending.push_back(arg->accept(*this));
+      }
+
+      set(self, callee, list(ref.args().size()));
+
+      return self;
+    }
+
+    node_ref visit(binary &ref) final {
+      auto self = add(ref, static_cast<std::uint8_t>(ref.op()));
+      auto lhs = ref.lhs().accept(*this);
+      auto rhs = ref.rhs().accept(*this);
+
+      set(self, lhs, rhs);
+
+      return self;
+    }
+
+    node_ref visit(unary &ref) final {
+      auto self = add(ref, static_cast<std::uint8_t>(ref.op()));
+
+      set(self, ref.rhs().accept(*this), flat_program::none);
+
+      return self;
+    }
+
+    node_ref visit(field_access &ref) final {
+      auto self = add(ref);
+
+      set(self, ref.accessed().accept(*this), ref.field_id());
+
+      return self;
+    }
+
+    node_ref visit(index &ref) final {
+      auto self = add(ref);
+      auto array = ref.array().accept(*this);
+      auto idx = ref.idx().accept(*this);
+
+      set(self, array, idx);
+
+      return self;
+    }
+
+    node_ref visit(if_else &ref) final {
+      auto self = add(ref);
+      auto condition = ref.condition().accept(*this);
+      auto true_clause = ref.true_clause().accept(*this);
+      auto else_clause = optional(ref.else_clause());
+
+      set(self, condition, extra({true_clause, else_clause}));
+
+      return self;
+    }
+
+    node_ref visit(struct_init &ref) final {
+      auto self = add(ref);
+
+      for (auto &pair : ref.pairs()) {
+        m_pending.push_back(pair.field_name);
+        m_pending.push_back(pair.value->accept(*this));
+      }
+
+      set(self, ref.name_id(), list(ref.pairs().size() * 2));
+
+      return self;
+    }
+
+    node_ref visit(block &ref) final {
+      auto self = add(ref);
+
+      for (auto &stmt : ref.statements()) {
+        m_pending.push_back(stmt->accept(*this));
+      }
+
+      auto statements = list(ref.statements().size());
+
+      set(self, statements, ref.type().accept(*this));
+
+      return self;
+    }
+
+    node_ref visit(expression_statement &ref) final {
+      auto self = add(ref);
+
+      set(self, ref.expr().accept(*this), flat_program::none);
+
+      return self;
+    }
+
+    node_ref visit(let &ref) final {
+      auto self = add(ref);
+      auto init = ref.initializer().accept(*this);
+      auto type = ref.type().accept(*this);
+
+      set(self, init, extra({type, ref.name_id()}));
+
+      return self;
+    }
+
+    node_ref visit(mut &ref) final {
+      auto self = add(ref);
+      auto init = ref.initializer().accept(*this);
+      auto type = ref.type().accept(*this);
+
+      set(self, init, extra({type, ref.name_id()}));
+
+      return self;
+    }
+
+    node_ref visit(ret &ref) final {
+      auto self = add(ref);
+
+      set(self, optional(ref.return_value()), flat_program::none);
+
+      return self;
+    }
+
+    node_ref visit(loop &ref) final {
+      auto self = add(ref);
+      auto condition = optional(ref.condition());
+      auto body = ref.body().accept(*this);
+
+      set(self, condition, body);
+
+      return self;
+    }
+
+    node_ref visit(type_decl &ref) final {
+      auto self = add(ref);
+
+      set(self, ref.type().accept(*this), ref.name_id());
+
+      return self;
+    }
+
+    /** @brief Flattens @p root on its own, as if it were the only declaration */
+    void run(node &root) {
+      m_flat.m_file = root.info().file();
+      m_pending.push_back(root.accept(*this));
+      m_flat.m_decls = list(1);
+    }
+
+    /** @brief Flattens every declaration in @p prog */
+    void run(program &prog) {
+      if (!prog.decls().empty()) {
+        m_flat.m_file = prog.decls()[0]->info().file();
+      }
+
+      for (auto &decl : prog.decls()) {
+        m_pending.push_back(decl->accept(*this));
+      }
+
+      m_flat.m_decls = list(prog.decls().size());
+    }
+  };
+} // namespace cascade::ast
+
+/** @brief Rebuilds nodes out of a flat program */
+class expander {
+  const flat_program &m_flat;
+  util::arena &m_nodes;
+
+public:
+  explicit expander(const flat_program &flat, util::arena &nodes)
+      : m_flat(flat)
+      , m_nodes(nodes) {}
+
+  /** @brief Rebuilds @p ref as a @p T, it has to actually be one */
+  template <class T> ptr<T> as(node_ref ref) {
+    return ptr<T>(static_cast<T *>(expand(ref).get()));
+  }
+
+  /** @brief Rebuilds an optional child */
+  std::optional<ptr<expression>> optional(node_ref ref) {
+    return (ref == flat_program::none) ? std::nullopt : std::make_optional(as<expression>(ref));
+  }
+
+  /** @brief Rebuilds the list starting at @p at */
+  template <class T> list<ptr<T>> children(std::uint32_t at) {
+    std::vector<ptr<T>> nodes;
+
+    for (auto child : m_flat.list(at)) {
+      nodes.push_back(as<T>(child));
+    }
+
+    return m_nodes.make_span(std::move(nodes));
+  }
+
+  ptr<node> expand(node_ref ref) {
+    auto &node = m_flat[ref];
+    auto info = m_flat.info(ref);
+    auto op = static_cast<core::token::kind>(node.op);
+    auto suffix = static_cast<core::token::literal_suffix>(node.op);
+
+    switch (node.type()) {
+      case kind::literal_char:
+        return m_nodes.make<char_literal>(info, static_cast<char>(node.lhs));
+      case kind::literal_string:
+        return m_nodes.make<string_literal>(info, m_flat.string(node.lhs));
+      case kind::literal_number:
+        return m_nodes.make<int_literal>(info, m_flat.number(node.lhs), suffix);
+      case kind::literal_bool:
+        return m_nodes.make<bool_literal>(info, node.lhs != 0);
+      case kind::literal_float:
+        return m_nodes.make<float_literal>(info, double_of(m_flat.number(node.lhs)), suffix);
+      case kind::identifier:
+        return m_nodes.make<identifier>(info, node.lhs);
+      case kind::type: {
+        auto &data = m_flat.type(node.lhs);
+
+        if (data.is(type::type_base::user_defined)) {
+          return m_nodes.make<type>(info, data.modifiers(), data.name_id());
+        }
+
+        return m_nodes.make<type>(info, data.modifiers(), data.base(), data.precision());
+      }
+      case kind::type_implied:
+        return m_nodes.make<implied>(info);
+      case kind::type_void:
+        return m_nodes.make<void_type>(info);
+      case kind::declaration_const:
+        return m_nodes.make<const_decl>(info,
+            m_flat.extra(node.rhs + 1),
+            as<expression>(node.lhs),
+            as<type>(m_flat.extra(node.rhs)));
+      case kind::declaration_static:
+        return m_nodes.make<static_decl>(info,
+            m_flat.extra(node.rhs + 1),
+            as<expression>(node.lhs),
+            as<type>(m_flat.extra(node.rhs)));
+      case kind::declaration_fn: {
+        std::vector<argument> args;
+
+        if (m_flat.extra(node.lhs + 2) == flat_program::none) {
+          throw std::logic_error{"skimmed fns can't be unflattened"};
+        }
+
+        // arguments are stored by value, not as handles
+        for (auto arg : m_flat.list(node.rhs)) {
+          args.emplace_back(m_flat.info(arg), m_flat[arg].lhs, as<type>(m_flat[arg].rhs));
+        }
+
+        return m_nodes.make<fn>(info,
+            m_flat.extra(node.lhs),
+            m_nodes.make_span(std::move(args)),
+            as<type>(m_flat.extra(node.lhs + 1)),
+            as<expression>(m_flat.extra(node.lhs + 2)));
+      }
+      case kind::declaration_argument:
+        return m_nodes.make<argument>(info, node.lhs, as<type>(node.rhs));
+      case kind::declaration_module:
+        return m_nodes.make<module_decl>(info, node.lhs);
+      case kind::declaration_export:
+        return m_nodes.make<export_decl>(info, as<declaration>(node.lhs));
+      case kind::declaration_type:
+        return m_nodes.make<type_decl>(info, as<type>(node.lhs), node.rhs);
+      case kind::expression_call:
+        return m_nodes.make<call>(info, as<expression>(node.lhs), children<expression>(node.rhs));
+      case kind::expression_binary:
+        return m_nodes.make<binary>(info, op, as<expression>(node.lhs), as<expression>(node.rhs));
+      case kind::expression_unary:
+        return m_nodes.make<unary>(info, op, as<expression>(node.lhs));
+      case kind::expression_field_access:
+        return m_nodes.make<field_access>(info, as<expression>(node.lhs), node.rhs);
+      case kind::expression_index:
+        return m_nodes.make<ast::index>(info, as<expression>(node.lhs), as<expression>(node.rhs));
+      case kind::expression_if_else:
+        return m_nodes.make<if_else>(info,
+            as<expression>(node.lhs),
+            as<expression>(m_flat.extra(node.rhs)),
+            optional(m_flat.extra(node.rhs + 1)));
+      case kind::expression_block:
+        return m_nodes.make<block>(info, children<statement>(node.lhs), as<type>(node.rhs));
+      case kind::expression_struct: {
+        std::vector<struct_init::pair> pairs;
+        auto fields = m_flat.list(node.rhs);
+
+        for (std::size_t i = 0; i < fields.size(); i += 2) {
+          pairs.push_back(struct_init::pair{fields[i], as<expression>(fields[i + 1])});
+        }
+
+        return m_nodes.make<struct_init>(info, node.lhs, m_nodes.make_span(std::move(pairs)));
+      }
+      case kind::statement_expression:
+        return m_nodes.make<expression_statement>(info, as<expression>(node.lhs));
+      case kind::statement_let:
+        return m_nodes.make<let>(info,
+            as<expression>(node.lhs),
+            as<type>(m_flat.extra(node.rhs)),
+            m_flat.extra(node.rhs + 1));
+      case kind::statement_mut:
+        return m_nodes.make<mut>(info,
+            as<expression>(node.lhs),
+            as<type>(m_flat.extra(node.rhs)),
+            m_flat.extra(node.rhs + 1));
+      case kind::statement_ret:
+        return m_nodes.make<ret>(info, optional(node.lhs));
+      case kind::statement_loop:
+        return m_nodes.make<loop>(info, optional(node.lhs), as<expression>(node.rhs));
+      case kind::declaration_struct:
+      case kind::declaration_import:
+      case kind::expression_array:
+        break;
+    }
+
+    throw std::logic_error{"unexpected node kind in a flat program"};
+  }
+};
+
+std::size_t flat_program::bytes() const {
+  return sizeof(*this) + m_nodes.capacity() * sizeof(flat_node)
+         + m_info.capacity() * sizeof(flat_info) + m_extra.capacity() * sizeof(std::uint32_t)
+         + m_types.capacity() * sizeof(type_data) + m_numbers.capacity() * sizeof(std::uint64_t)
+         + m_strings.capacity() * sizeof(std::string_view);
+}
+
+flat_program ast::flatten(program &prog) {
+  flat_program flat;
+
+  flattener(flat).run(prog);
+
+  return flat;
+}
+
+flat_program ast::flatten(node &root) {
+  flat_program flat;
+
+  flattener(flat).run(root);
+
+  return flat;
+}
+
+program ast::unflatten(const flat_program &flat) {
+  util::arena nodes;
+  expander rebuild(flat, nodes);
+  std::vector<ptr<declaration>> decls;
+
+  for (auto decl : flat.decls()) {
+    decls.push_back(rebuild.as<declaration>(decl));
+  }
+
+  auto decl_list = nodes.make_span(std::move(decls));
+
+  return program(std::move(nodes), decl_list);
+}
@@ -0,0 +1,640 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * ast/flat.hh:
+ *   Defines a flat, index-based form of the AST
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_AST_FLAT_HH
+#define CASCADE_AST_FLAT_HH
+
+#include "ast/ast.hh"
+#include "util/arena.hh"
+#include "util/interner.hh"
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace cascade::ast {
+  /** @brief Refers to a node in a `flat_program` by its index */
+  using node_ref = std::uint32_t;
+
+  /**
+   * @brief A single node in a `flat_program`
+   * @details What `lhs` and `rhs` hold depends on the kind, "extra" means an
+   * offset into the program's extra table, "list" means an offset of a count
+   * followed by that many refs:
+   *
+   *     literal_char/bool          lhs = the value
+   *     literal_string             lhs = index into `string()`
+   *     literal_number/float       lhs = index into `number()`, op = the suffix
+   *     identifier                 lhs = the symbol
+   *     type/type_implied/void     lhs = index into `type()`
+   *     declaration_const/static   lhs = initializer, rhs = extra [type, name]
+   *     declaration_fn             lhs = extra [name, return type, body or none], rhs = list of args
+   *     declaration_argument       lhs = name, rhs = type
+   *     declaration_module         lhs = name
+   *     declaration_export         lhs = the exported declaration
+   *     declaration_type           lhs = type, rhs = name
+   *     expression_call            lhs = callee, rhs = list of args
+   *     expression_binary          lhs, rhs = the operands, op = the operator
+   *     expression_unary           lhs = the operand, op = the operator
+   *     expression_field_access    lhs = the accessed expression, rhs = the field name
+   *     expression_index           lhs = the array, rhs = the index
+   *     expression_if_else         lhs = condition, rhs = extra [true clause, else clause or none]
+   *     expression_block           lhs = list of statements, rhs = type
+   *     expression_struct          lhs = name, rhs = list of field name/value pairs
+   *     statement_expression       lhs = the expression
+   *     statement_let/mut          lhs = initializer, rhs = extra [type, name]
+   *     statement_ret              lhs = the value or none
+   *     statement_loop             lhs = condition or none, rhs = body
+   */
+  struct flat_node {
+    /** @brief The `ast::kind` of the node */
+    std::uint8_t tag;
+
+    /** @brief The operator or literal suffix, if the node has one */
+    std::uint8_t op;
+
+    std::uint32_t lhs;
+
+    std::uint32_t rhs;
+
+    [[nodiscard]] kind type() const { return static_cast<kind>(tag); }
+  };
+
+  /** @brief Where a node is in its file, the file is the same for the whole program */
+  struct flat_info {
+    std::uint32_t position;
+
+    std::uint32_t length;
+  };
+
+  /**
+   * @brief An AST stored in a handful of flat arrays instead of a tree of objects
+   * @details Nodes are in pre-order (parents come before their children) and
+   * refer to each other by 32-bit index. Source info is kept in a side table
+   * indexed the same way, so passes that don't care about positions never load
+   * it. Built from a `program` with `flatten`, passes run over it as a `flat::visitor`
+   */
+  class flat_program {
+    std::vector<flat_node> m_nodes;
+    std::vector<flat_info> m_info;
+    std::vector<std::uint32_t> m_extra;
+    std::vector<type_data> m_types;
+    std::vector<std::uint64_t> m_numbers;
+    std::vector<std::string_view> m_strings;
+
+    /** @brief Offset of the list of top-level declarations in `m_extra` */
+    std::uint32_t m_decls = 0;
+
+    util::file_id m_file = 0;
+
+    friend class flattener;
+
+  public:
+    /** @brief Marks an optional child that isn't there */
+    static constexpr node_ref none = ~node_ref{0};
+
+    /** @brief Returns the node @p ref refers to */
+    [[nodiscard]] const flat_node &operator[](node_ref ref) const { return m_nodes[ref]; }
+
+    /** @brief Returns the source info for the node @p ref refers to */
+    [[nodiscard]] core::source_info info(node_ref ref) const {
+      return core::source_info(m_info[ref].position, m_info[ref].length, m_file);
+    }
+
+    /** @brief Returns the value at offset @p at in the extra table */
+    [[nodiscard]] std::uint32_t extra(std::uint32_t at) const { return m_extra[at]; }
+
+    /** @brief Returns the list that starts at offset @p at in the extra table */
+    [[nodiscard]] util::span<const node_ref> list(std::uint32_t at) const {
+      return util::span<const node_ref>(m_extra.data() + at + 1, m_extra[at]);
+    }
+
+    /** @brief Returns the top-level declarations */
+    [[nodiscard]] util::span<const node_ref> decls() const { return list(m_decls); }
+
+    /** @brief Returns the type stored at @p index */
+    [[nodiscard]] const type_data &type(std::uint32_t index) const { return m_types[index]; }
+
+    /** @brief Returns the bits of the number literal stored at @p index */
+    [[nodiscard]] std::uint64_t number(std::uint32_t index) const { return m_numbers[index]; }
+
+    /** @brief Returns the string literal stored at @p index */
+    [[nodiscard]] std::string_view string(std::uint32_t index) const { return m_strings[index]; }
+
+    /** @brief Returns the number of nodes */
+    [[nodiscard]] std::size_t size() const { return m_nodes.size(); }
+
+    /** @brief Returns roughly how many bytes the program takes up */
+    [[nodiscard]] std::size_t bytes() const;
+  };
+
+  /**
+   * @brief Flattens a program
+   * @param prog The program, every node must be from the same file
+   * @return The flat form of @p prog
+   */
+  flat_program flatten(program &prog);
+
+  /**
+   * @brief Flattens a single node and everything under it
+   * @param root The node, it ends up as the only entry in `decls()`
+   * @return The flat form of @p root
+   */
+  flat_program flatten(node &root);
+
+  /**
+   * @brief Rebuilds the whole tree of nodes from a flat program
+   * @details The inverse of `flatten`, the result is the same tree that was flattened.
+   * It costs as much memory as the tree did in the first place, passes that only
+   * read the AST are meant to be a `flat::visitor` instead
+   * @param flat The flat program, it can't have any skimmed fns
+   * @return A program with a fresh arena
+   */
+  program unflatten(const flat_program &flat);
+} // namespace cascade::ast
+
+namespace cascade::ast::flat {
+  template <class T> class visitor;
+
+  /**
+   * @brief A node of a flat program, seen through its index
+   * @details Every kind of node has a view with the same name as the tree node,
+   * and the same accessors where they make sense. Children are views too. Views
+   * are two words, they're passed by value and nothing is built to make one,
+   * every accessor reads straight out of the flat program's arrays
+   */
+  class view {
+  protected:
+    const flat_program *m_flat;
+
+    node_ref m_ref;
+
+    /** @brief Returns the node being viewed */
+    [[nodiscard]] const flat_node &node() const { return (*m_flat)[m_ref]; }
+
+    /** @brief Returns a view of another node in the same program */
+    template <class T = view> [[nodiscard]] T at(node_ref ref) const { return T(*m_flat, ref); }
+
+    /** @brief Returns a view of another node, or nothing if @p ref is `none` */
+    [[nodiscard]] std::optional<view> optional(node_ref ref) const {
+      return (ref == flat_program::none) ? std::nullopt : std::make_optional(at(ref));
+    }
+
+    /** @brief Resolves a symbol through the interner */
+    [[nodiscard]] static std::string_view name_of(util::symbol sym) {
+      return util::interner::instance().lookup(sym);
+    }
+
+  public:
+    explicit view(const flat_program &flat, node_ref ref) : m_flat(&flat), m_ref(ref) {}
+
+    /** @brief Returns the index of the node */
+    [[nodiscard]] node_ref ref() const { return m_ref; }
+
+    /** @brief Returns the kind of the node */
+    [[nodiscard]] kind raw_kind() const { return node().type(); }
+
+    /** @brief Returns where the node is in its file */
+    [[nodiscard]] core::source_info info() const { return m_flat->info(m_ref); }
+
+    /**
+     * @brief Runs a visitor on the node, dispatching on its kind
+     * @param visitor The visitor
+     * @return What the visitor returned
+     */
+    template <class T> T accept(visitor<T> &visitor) const;
+  };
+
+  /** @brief A list of nodes in a flat program, each one seen as a @p T */
+  template <class T> class view_list {
+    const flat_program *m_flat;
+
+    util::span<const node_ref> m_refs;
+
+  public:
+    class iterator {
+      const flat_program *m_flat;
+
+      const node_ref *m_at;
+
+    public:
+      explicit iterator(const flat_program *flat, const node_ref *at) : m_flat(flat), m_at(at) {}
+
+      T operator*() const { return T(*m_flat, *m_at); }
+
+      iterator &operator++() {
+        ++m_at;
+
+        return *this;
+      }
+
+      bool operator!=(const iterator &other) const { return m_at != other.m_at; }
+    };
+
+    explicit view_list(const flat_program &flat, util::span<const node_ref> refs)
+        : m_flat(&flat)
+        , m_refs(refs) {}
+
+    [[nodiscard]] iterator begin() const { return iterator(m_flat, m_refs.begin()); }
+
+    [[nodiscard]] iterator end() const { return iterator(m_flat, m_refs.end()); }
+
+    [[nodiscard]] std::size_t size() const { return m_refs.size(); }
+
+    [[nodiscard]] bool empty() const { return m_refs.empty(); }
+
+    [[nodiscard]] T operator[](std::size_t i) const { return T(*m_flat, m_refs[i]); }
+  };
+
+  /** @brief A type, any of `type`, `type_implied` and `type_void` */
+  class type : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] const type_data &data() const { return m_flat->type(node().lhs); }
+  };
+
+  /** @brief Anything laid out as an initializer, a type and a name */
+  class binding : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view initializer() const { return at(node().lhs); }
+
+    [[nodiscard]] flat::type type() const { return at<flat::type>(m_flat->extra(node().rhs)); }
+
+    [[nodiscard]] util::symbol name_id() const { return m_flat->extra(node().rhs + 1); }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+  };
+
+  class const_decl : public binding {
+  public:
+    using binding::binding;
+  };
+
+  class static_decl : public binding {
+  public:
+    using binding::binding;
+  };
+
+  class let : public binding {
+  public:
+    using binding::binding;
+  };
+
+  class mut : public binding {
+  public:
+    using binding::binding;
+  };
+
+  class argument : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] util::symbol name_id() const { return node().lhs; }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+
+    [[nodiscard]] flat::type type() const { return at<flat::type>(node().rhs); }
+  };
+
+  class fn : public view {
+    [[nodiscard]] node_ref body_ref() const { return m_flat->extra(node().lhs + 2); }
+
+  public:
+    using view::view;
+
+    [[nodiscard]] util::symbol name_id() const { return m_flat->extra(node().lhs); }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+
+    [[nodiscard]] view_list<argument> args() const {
+      return view_list<argument>(*m_flat, m_flat->list(node().rhs));
+    }
+
+    [[nodiscard]] flat::type type() const { return at<flat::type>(m_flat->extra(node().lhs + 1)); }
+
+    /** @brief Returns whether the fn was skimmed, a skimmed fn has no body */
+    [[nodiscard]] bool skimmed() const { return body_ref() == flat_program::none; }
+
+    [[nodiscard]] view body() const { return at(body_ref()); }
+  };
+
+  class module_decl : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] util::symbol name_id() const { return node().lhs; }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+  };
+
+  /** @brief Never visited, imports can't be flattened yet */
+  class import_decl : public view {
+  public:
+    using view::view;
+  };
+
+  class export_decl : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view exported() const { return at(node().lhs); }
+  };
+
+  class char_literal : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] char value() const { return static_cast<char>(node().lhs); }
+  };
+
+  class string_literal : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] std::string_view value() const { return m_flat->string(node().lhs); }
+  };
+
+  class int_literal : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] std::uint64_t value() const { return m_flat->number(node().lhs); }
+
+    [[nodiscard]] core::token::literal_suffix suffix() const {
+      return static_cast<core::token::literal_suffix>(node().op);
+    }
+  };
+
+  class float_literal : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] double value() const {
+      auto bits = m_flat->number(node().lhs);
+      double value;
+
+      std::memcpy(&value, &bits, sizeof(value));
+
+      return value;
+    }
+
+    [[nodiscard]] core::token::literal_suffix suffix() const {
+      return static_cast<core::token::literal_suffix>(node().op);
+    }
+  };
+
+  class bool_literal : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] bool value() const { return node().lhs != 0; }
+  };
+
+  class identifier : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] util::symbol name_id() const { return node().lhs; }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+  };
+
+  class call : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view callee() const { return at(node().lhs); }
+
+    [[nodiscard]] view_list<view> args() const {
+      return view_list<view>(*m_flat, m_flat->list(node().rhs));
+    }
+  };
+
+  class binary : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] core::token::kind op() const { return static_cast<core::token::kind>(node().op); }
+
+    [[nodiscard]] view lhs() const { return at(node().lhs); }
+
+    [[nodiscard]] view rhs() const { return at(node().rhs); }
+  };
+
+  class unary : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] core::token::kind op() const { return static_cast<core::token::kind>(node().op); }
+
+    [[nodiscard]] view rhs() const { return at(node().lhs); }
+  };
+
+  class field_access : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view accessed() const { return at(node().lhs); }
+
+    [[nodiscard]] util::symbol field_id() const { return node().rhs; }
+
+    [[nodiscard]] std::string_view field_name() const { return name_of(field_id()); }
+  };
+
+  class index : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view array() const { return at(node().lhs); }
+
+    [[nodiscard]] view idx() const { return at(node().rhs); }
+  };
+
+  class if_else : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view condition() const { return at(node().lhs); }
+
+    [[nodiscard]] view true_clause() const { return at(m_flat->extra(node().rhs)); }
+
+    [[nodiscard]] std::optional<view> else_clause() const {
+      return optional(m_flat->extra(node().rhs + 1));
+    }
+  };
+
+  class struct_init : public view {
+    [[nodiscard]] util::span<const node_ref> fields() const { return m_flat->list(node().rhs); }
+
+  public:
+    using view::view;
+
+    [[nodiscard]] util::symbol name_id() const { return node().lhs; }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+
+    /** @brief Returns the number of field initializers */
+    [[nodiscard]] std::size_t size() const { return fields().size() / 2; }
+
+    /** @brief Returns the name of the @p i th field initialized */
+    [[nodiscard]] util::symbol field_id(std::size_t i) const { return fields()[i * 2]; }
+
+    /** @brief Returns the value the @p i th field is initialized with */
+    [[nodiscard]] view value(std::size_t i) const { return at(fields()[i * 2 + 1]); }
+  };
+
+  class block : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view_list<view> statements() const {
+      return view_list<view>(*m_flat, m_flat->list(node().lhs));
+    }
+
+    [[nodiscard]] flat::type type() const { return at<flat::type>(node().rhs); }
+  };
+
+  class expression_statement : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] view expr() const { return at(node().lhs); }
+  };
+
+  class ret : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] std::optional<view> return_value() const { return optional(node().lhs); }
+  };
+
+  class loop : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] std::optional<view> condition() const { return optional(node().lhs); }
+
+    [[nodiscard]] view body() const { return at(node().rhs); }
+  };
+
+  class type_decl : public view {
+  public:
+    using view::view;
+
+    [[nodiscard]] flat::type type() const { return at<flat::type>(node().lhs); }
+
+    [[nodiscard]] util::symbol name_id() const { return node().rhs; }
+
+    [[nodiscard]] std::string_view name() const { return name_of(name_id()); }
+  };
+
+  /** @brief Abstract visitor for flat programs, each node is visited as its view */
+  template <class T> class visitor {
+  public:
+#define VISIT(type) virtual T visit(type) = 0
+
+    CASCADE_VISIT_TYPES
+
+#undef VISIT
+    virtual ~visitor() {}
+  };
+
+  template <class T> T view::accept(visitor<T> &visitor) const {
+    switch (raw_kind()) {
+      case kind::literal_char:
+        return visitor.visit(char_literal(*m_flat, m_ref));
+      case kind::literal_string:
+        return visitor.visit(string_literal(*m_flat, m_ref));
+      case kind::literal_number:
+        return visitor.visit(int_literal(*m_flat, m_ref));
+      case kind::literal_bool:
+        return visitor.visit(bool_literal(*m_flat, m_ref));
+      case kind::literal_float:
+        return visitor.visit(float_literal(*m_flat, m_ref));
+      case kind::identifier:
+        return visitor.visit(identifier(*m_flat, m_ref));
+      case kind::declaration_const:
+        return visitor.visit(const_decl(*m_flat, m_ref));
+      case kind::declaration_static:
+        return visitor.visit(static_decl(*m_flat, m_ref));
+      case kind::declaration_fn:
+        return visitor.visit(fn(*m_flat, m_ref));
+      case kind::declaration_module:
+        return visitor.visit(module_decl(*m_flat, m_ref));
+      case kind::declaration_export:
+        return visitor.visit(export_decl(*m_flat, m_ref));
+      case kind::declaration_argument:
+        return visitor.visit(argument(*m_flat, m_ref));
+      case kind::declaration_type:
+        return visitor.visit(type_decl(*m_flat, m_ref));
+      case kind::expression_call:
+        return visitor.visit(call(*m_flat, m_ref));
+      case kind::expression_binary:
+        return visitor.visit(binary(*m_flat, m_ref));
+      case kind::expression_unary:
+        return visitor.visit(unary(*m_flat, m_ref));
+      case kind::expression_field_access:
+        return visitor.visit(field_access(*m_flat, m_ref));
+      case kind::expression_index:
+        return visitor.visit(index(*m_flat, m_ref));
+      case kind::expression_if_else:
+        return visitor.visit(if_else(*m_flat, m_ref));
+      case kind::expression_block:
+        return visitor.visit(block(*m_flat, m_ref));
+      case kind::expression_struct:
+        return visitor.visit(struct_init(*m_flat, m_ref));
+      case kind::statement_expression:
+        return visitor.visit(expression_statement(*m_flat, m_ref));
+      case kind::statement_let:
+        return visitor.visit(let(*m_flat, m_ref));
+      case kind::statement_mut:
+        return visitor.visit(mut(*m_flat, m_ref));
+      case kind::statement_ret:
+        return visitor.visit(ret(*m_flat, m_ref));
+      case kind::statement_loop:
+        return visitor.visit(loop(*m_flat, m_ref));
+      case kind::type:
+      case kind::type_implied:
+      case kind::type_void:
+        return visitor.visit(flat::type(*m_flat, m_ref));
+      case kind::declaration_struct:
+      case kind::declaration_import:
+      case kind::expression_array:
+        break;
+    }
+
+    throw std::logic_error{"unexpected node kind in a flat program"};
+  }
+
+  /** @brief Returns the top-level declarations of @p flat as views */
+  inline view_list<view> decls(const flat_program &flat) {
+    return view_list<view>(flat, flat.decls());
+  }
+} // namespace cascade::ast::flat
+
+#endif
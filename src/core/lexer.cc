@@ -22,21 +22,32 @@
  *---------------------------------------------------------------------------*/
 
 #include "core/lexer.hh"
-#include "errors/error.hh"
+#include "errors/diagnostic.hh"
 #include "util/keywords.hh"
+#include "util/scanning.hh"
+#include "util/thread_pool.hh"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
 #include <optional>
+#include <string>
 #include <type_traits>
-#include <unordered_map>
+#include <utility>
 
 using namespace cascade;
 using namespace core;
 using ec = errors::error_code;
 
-namespace fs = std::filesystem;
-
-// symbols that are only ever single char
-static std::unordered_map<std::string_view, token::kind> single_char_symbols{
+// every symbol the lexer knows about. longer symbols win over their prefixes,
+// e.g. `<<=` is lexed instead of `<<` followed by `=`
+static constexpr std::pair<std::string_view, token::kind> symbols[] = {
     {"[", token::kind::symbol_openbracket},
     {"]", token::kind::symbol_closebracket},
     {"@", token::kind::symbol_at},
@@ -48,10 +59,6 @@ static std::unordered_map<std::string_view, token::kind> single_char_symbols{
     {";", token::kind::symbol_semicolon},
     {",", token::kind::symbol_comma},
     {"~", token::kind::symbol_tilde},
-};
-
-// symbols that either are 2 characters, or start with the same character as a 2 char one
-static std::unordered_map<std::string_view, token::kind> one_or_two_char_symbols{
     {"=", token::kind::symbol_equal},
     {":", token::kind::symbol_colon},
     {"::", token::kind::symbol_coloncolon},
@@ -83,21 +90,435 @@ static std::unordered_map<std::string_view, token::kind> one_or_two_char_symbols
     {"+=", token::kind::symbol_plusequal},
 };
 
+/** @brief One state of the symbol matcher, i.e. one prefix of at least one symbol */
+struct symbol_state {
+  /** @brief The symbol the prefix is on its own, or unknown if it isn't one (`!`) */
+  token::kind kind = token::kind::unknown;
+
+  /** @brief Number of characters that continue the prefix */
+  std::uint8_t edge_count = 0;
+
+  /** @brief The characters that continue the prefix */
+  std::array<char, 2> edge_chars{};
+
+  /** @brief The state each of those characters leads to */
+  std::array<std::uint8_t, 2> edge_targets{};
+};
+
+/** @brief A trie of every symbol, indexed by the first byte and then walked one char at a time */
+struct symbol_table {
+  /** @brief State for each possible first byte, 0 if no symbol starts with it */
+  std::array<std::uint8_t, 256> first{};
+
+  /** @brief Every state, 0 is reserved as the "no state" marker */
+  std::array<symbol_state, 48> states{};
+
+  /** @brief Number of states in use */
+  std::uint8_t state_count = 1;
+
+  /** @brief Set if the states/edges above were too small for `symbols` */
+  bool overflowed = false;
+};
+
+/**
+ * @brief Builds the symbol trie out of `symbols`
+ * @return The trie
+ */
+static constexpr symbol_table build_symbol_table() {
+  symbol_table table;
+
+  for (auto &symbol : symbols) {
+    auto spelling = symbol.first;
+    auto &first = table.first[static_cast<unsigned char>(spelling[0])];
+
+    if (first == 0) {
+      first = table.state_count++;
+    }
+
+    auto state = first;
+
+    for (std::size_t i = 1; i < spelling.size() && !table.overflowed; ++i) {
+      auto &current = table.states[state];
+      auto next = std::uint8_t{0};
+
+      for (std::uint8_t edge = 0; edge < current.edge_count; ++edge) {
+        if (current.edge_chars[edge] == spelling[i]) {
+          next = current.edge_targets[edge];
+        }
+      }
+
+      if (next == 0) {
+        if (current.edge_count == current.edge_chars.size()
+            || table.state_count == table.states.size()) {
+          table.overflowed = true;
+          break;
+        }
+
+        next = table.state_count++;
+        current.edge_chars[current.edge_count] = spelling[i];
+        current.edge_targets[current.edge_count] = next;
+        ++current.edge_count;
+      }
+
+      state = next;
+    }
+
+    table.states[state].kind = symbol.second;
+  }
+
+  return table;
+}
+
+static constexpr auto symbol_trie = build_symbol_table();
+
+static_assert(!symbol_trie.overflowed, "symbol_table needs more states or edges per state");
+
+/** @brief What the lexer does once the DFA stops in a state */
+enum class dfa_action : std::uint8_t {
+  /** @brief Not an accepting state */
+  none,
+  /** @brief Whitespace, skipped in bulk */
+  whitespace,
+  /** @brief `--`, the rest of the comment is skipped in bulk */
+  line_comment,
+  /** @brief `-*`, the rest of the comment is skipped in bulk */
+  block_comment,
+  /** @brief A keyword or an identifier */
+  identifier,
+  /** @brief A number literal, decoded after the fact */
+  number,
+  /** @brief A string/char literal or a symbol, the kind is in the state */
+  simple,
+};
+
+/** @brief Character classes every byte is mapped to before it's fed to the DFA */
+enum char_class : std::uint8_t {
+  cls_other,
+  cls_space,
+  cls_zero,
+  cls_one,
+  cls_digit,        // 2-9
+  cls_b,            // b/B, a hex digit and the binary prefix
+  cls_x,            // x/X
+  cls_e,            // e/E, a hex digit and the exponent
+  cls_hex,          // the rest of the hex digit letters
+  cls_letter,       // every other letter
+  cls_underscore,   // _
+  cls_quote,        // "
+  cls_apostrophe,   // '
+  cls_backslash,    // backslash
+  cls_first_symbol, // each char used in `symbols` gets its own class starting here
+};
+
+/** @brief States that don't come out of `symbols` */
+enum dfa_state : std::uint8_t {
+  st_dead,
+  st_start,
+  st_whitespace,
+  st_line_comment,
+  st_block_comment,
+  st_identifier,
+  st_zero,
+  st_decimal,
+  st_fraction,
+  st_exponent_e,
+  st_exponent_sign,
+  st_exponent,
+  st_tail, // letters/digits stuck onto the end of a number, the suffix
+  st_hex_prefix,
+  st_hex,
+  st_binary_prefix,
+  st_binary,
+  st_string,
+  st_string_escape,
+  st_string_end,
+  st_char,
+  st_char_escape,
+  st_char_end,
+  st_first_symbol, // the symbol trie goes from here on
+};
+
+/** @brief The lexer's DFA, character classes plus a state-transition table */
+struct dfa_table {
+  /** @brief The class of each byte */
+  std::array<std::uint8_t, 256> classes{};
+
+  /** @brief `next[state][class]` is the state to go to, `st_dead` if there isn't one */
+  std::array<std::array<std::uint8_t, 40>, 80> next{};
+
+  /** @brief What to do when the DFA stops in each state */
+  std::array<dfa_action, 80> actions{};
+
+  /** @brief The token kind each `simple` state produces */
+  std::array<token::kind, 80> kinds{};
+
+  /** @brief Number of classes in use */
+  std::uint8_t class_count = cls_first_symbol;
+
+  /** @brief Number of states in use */
+  std::uint8_t state_count = st_first_symbol;
+
+  /** @brief Set if the arrays above were too small for `symbols` */
+  bool overflowed = false;
+
+  /** @brief Adds an edge from @p from to @p to on every class in @p on */
+  constexpr void edges(std::uint8_t from, std::initializer_list<std::uint8_t> on, std::uint8_t to) {
+    for (auto cls : on) {
+      next[from][cls] = to;
+    }
+  }
+
+  /** @brief Adds an edge from @p from to @p to on every class */
+  constexpr void edges_all(std::uint8_t from, std::uint8_t to) {
+    for (std::uint8_t cls = 0; cls < class_count; ++cls) {
+      next[from][cls] = to;
+    }
+  }
+
+  /** @brief Marks @p state as accepting */
+  constexpr void accept(std::uint8_t state,
+      dfa_action action,
+      token::kind kind = token::kind::unknown) {
+    actions[state] = action;
+    kinds[state] = kind;
+  }
+
+  /** @brief Gets the class of @p c */
+  [[nodiscard]] constexpr std::uint8_t of(char c) const {
+    return classes[static_cast<unsigned char>(c)];
+  }
+};
+
+/**
+ * @brief Builds the lexer DFA
+ * @details Only the first few characters of whitespace and comments go through the
+ * DFA, once it knows what it's looking at the rest is skipped with the SIMD scanners.
+ * @return The DFA
+ */
+static constexpr dfa_table build_dfa() {
+  dfa_table dfa;
+
+  for (auto c = 'a'; c <= 'z'; ++c) {
+    dfa.classes[static_cast<unsigned char>(c)] = cls_letter;
+    dfa.classes[static_cast<unsigned char>(c - 'a' + 'A')] = cls_letter;
+  }
+
+  for (auto c : {'a', 'c', 'd', 'f', 'A', 'C', 'D', 'F'}) {
+    dfa.classes[static_cast<unsigned char>(c)] = cls_hex;
+  }
+
+  for (auto c = '2'; c <= '9'; ++c) {
+    dfa.classes[static_cast<unsigned char>(c)] = cls_digit;
+  }
+
+  for (auto c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+    dfa.classes[static_cast<unsigned char>(c)] = cls_space;
+  }
+
+  dfa.classes['0'] = cls_zero;
+  dfa.classes['1'] = cls_one;
+  dfa.classes['b'] = dfa.classes['B'] = cls_b;
+  dfa.classes['x'] = dfa.classes['X'] = cls_x;
+  dfa.classes['e'] = dfa.classes['E'] = cls_e;
+  dfa.classes['_'] = cls_underscore;
+  dfa.classes['"'] = cls_quote;
+  dfa.classes['\''] = cls_apostrophe;
+  dfa.classes['\\'] = cls_backslash;
+
+  for (auto &symbol : symbols) {
+    for (auto c : symbol.first) {
+      auto &cls = dfa.classes[static_cast<unsigned char>(c)];
+
+      if (cls == cls_other) {
+        cls = dfa.class_count++;
+      }
+    }
+  }
+
+  if (dfa.class_count > dfa.next[0].size()) {
+    dfa.overflowed = true;
+
+    return dfa;
+  }
+
+  auto digits = {std::uint8_t{cls_zero}, std::uint8_t{cls_one}, std::uint8_t{cls_digit}};
+  auto letters = {std::uint8_t{cls_b},
+      std::uint8_t{cls_x},
+      std::uint8_t{cls_e},
+      std::uint8_t{cls_hex},
+      std::uint8_t{cls_letter}};
+  auto sign = {dfa.of('+'), dfa.of('-')};
+
+  dfa.edges(st_start, {cls_space}, st_whitespace);
+  dfa.accept(st_whitespace, dfa_action::whitespace);
+
+  // identifiers
+  dfa.edges(st_start, letters, st_identifier);
+  dfa.edges(st_start, {cls_underscore}, st_identifier);
+  dfa.edges(st_identifier, letters, st_identifier);
+  dfa.edges(st_identifier, digits, st_identifier);
+  dfa.edges(st_identifier, {cls_underscore}, st_identifier);
+  dfa.accept(st_identifier, dfa_action::identifier);
+
+  // numbers. anything alphanumeric at the end becomes the suffix, and `1e` is a `1` with
+  // a suffix unless there are digits after the `e` (and the sign)
+  dfa.edges(st_start, {cls_zero}, st_zero);
+  dfa.edges(st_start, {cls_one, cls_digit}, st_decimal);
+
+  for (auto state : {st_zero, st_decimal}) {
+    dfa.edges(state, letters, st_tail);
+    dfa.edges(state, digits, st_decimal);
+    dfa.edges(state, {cls_underscore}, st_decimal);
+    dfa.edges(state, {dfa.of('.')}, st_fraction);
+    dfa.edges(state, {cls_e}, st_exponent_e);
+  }
+
+  dfa.edges(st_zero, {cls_x}, st_hex_prefix);
+  dfa.edges(st_zero, {cls_b}, st_binary_prefix);
+
+  dfa.edges(st_fraction, letters, st_tail);
+  dfa.edges(st_fraction, digits, st_fraction);
+  dfa.edges(st_fraction, {cls_underscore}, st_fraction);
+  dfa.edges(st_fraction, {cls_e}, st_exponent_e);
+
+  dfa.edges(st_exponent_e, letters, st_tail);
+  dfa.edges(st_exponent_e, {cls_underscore}, st_tail);
+  dfa.edges(st_exponent_e, digits, st_exponent);
+  dfa.edges(st_exponent_e, sign, st_exponent_sign);
+  dfa.edges(st_exponent_sign, digits, st_exponent);
+
+  dfa.edges(st_exponent, letters, st_tail);
+  dfa.edges(st_exponent, digits, st_exponent);
+  dfa.edges(st_exponent, {cls_underscore}, st_exponent);
+
+  dfa.edges(st_tail, letters, st_tail);
+  dfa.edges(st_tail, digits, st_tail);
+  dfa.edges(st_tail, {cls_underscore}, st_tail);
+
+  for (auto state : {st_hex_prefix, st_hex}) {
+    dfa.edges(state, {cls_x, cls_letter}, st_tail);
+    dfa.edges(state, digits, st_hex);
+    dfa.edges(state, {cls_b, cls_e, cls_hex, cls_underscore}, st_hex);
+  }
+
+  for (auto state : {st_binary_prefix, st_binary}) {
+    dfa.edges(state, letters, st_tail);
+    dfa.edges(state, {cls_digit}, st_tail);
+    dfa.edges(state, {cls_zero, cls_one, cls_underscore}, st_binary);
+  }
+
+  for (auto state : {st_zero,
+           st_decimal,
+           st_fraction,
+           st_exponent_e,
+           st_exponent,
+           st_tail,
+           st_hex_prefix,
+           st_hex,
+           st_binary_prefix,
+           st_binary}) {
+    dfa.accept(state, dfa_action::number);
+  }
+
+  // string/char literals, only the delimiter can be escaped. anything that doesn't make
+  // it to the closing delimiter doesn't accept, that's how unterminated ones are found
+  dfa.edges(st_start, {cls_quote}, st_string);
+  dfa.edges_all(st_string, st_string);
+  dfa.edges(st_string, {cls_backslash}, st_string_escape);
+  dfa.edges(st_string, {cls_quote}, st_string_end);
+  dfa.edges_all(st_string_escape, st_string);
+  dfa.edges(st_string_escape, {cls_backslash}, st_string_escape);
+  dfa.accept(st_string_end, dfa_action::simple, token::kind::literal_string);
+
+  dfa.edges(st_start, {cls_apostrophe}, st_char);
+  dfa.edges_all(st_char, st_char);
+  dfa.edges(st_char, {cls_backslash}, st_char_escape);
+  dfa.edges(st_char, {cls_apostrophe}, st_char_end);
+  dfa.edges_all(st_char_escape, st_char);
+  dfa.edges(st_char_escape, {cls_backslash}, st_char_escape);
+  dfa.accept(st_char_end, dfa_action::simple, token::kind::literal_char);
+
+  // every symbol, as a trie hanging off of the start state
+  for (auto &symbol : symbols) {
+    auto state = std::uint8_t{st_start};
+
+    for (auto c : symbol.first) {
+      auto &next = dfa.next[state][dfa.of(c)];
+
+      if (next == st_dead) {
+        if (dfa.state_count == dfa.next.size()) {
+          dfa.overflowed = true;
+
+          return dfa;
+        }
+
+        next = dfa.state_count++;
+      }
+
+      state = next;
+    }
+
+    dfa.accept(state, dfa_action::simple, symbol.second);
+  }
+
+  // the symbols that start something else
+  auto hyphen = dfa.next[st_start][dfa.of('-')];
+  auto dot = dfa.next[st_start][dfa.of('.')];
+
+  dfa.edges(hyphen, {dfa.of('-')}, st_line_comment);
+  dfa.edges(hyphen, {dfa.of('*')}, st_block_comment);
+  dfa.accept(st_line_comment, dfa_action::line_comment);
+  dfa.accept(st_block_comment, dfa_action::block_comment);
+  dfa.edges(dot, digits, st_fraction);
+
+  return dfa;
+}
+
+static constexpr auto lexer_dfa = build_dfa();
+
+static_assert(!lexer_dfa.overflowed, "dfa_table needs more states or classes");
+
+/**
+ * @brief Finds the longest symbol that begins at @p pos
+ * @param source The source being lexed
+ * @param pos The position to match at
+ * @return The kind and length of the symbol, the length is 0 if there isn't one
+ */
+static std::pair<token::kind, std::size_t> match_symbol(std::string_view source, std::size_t pos) {
+  auto result = std::pair{token::kind::unknown, std::size_t{0}};
+  auto state = symbol_trie.first[static_cast<unsigned char>(source[pos])];
+
+  for (auto i = pos + 1; state != 0; ++i) {
+    auto &current = symbol_trie.states[state];
+
+    // maximal munch, remember the longest prefix that's actually a symbol
+    if (current.kind != token::kind::unknown) {
+      result = {current.kind, i - pos};
+    }
+
+    auto next = std::uint8_t{0};
+
+    for (std::uint8_t edge = 0; i < source.size() && edge < current.edge_count; ++edge) {
+      if (current.edge_chars[edge] == source[i]) {
+        next = current.edge_targets[edge];
+      }
+    }
+
+    state = next;
+  }
+
+  return result;
+}
+
 source_info source_info::from(const source_info &original, std::size_t new_len) {
-  return source_info(original.position(),
-      original.line(),
-      original.column(),
-      new_len,
-      original.path());
+  return source_info(original.position(), new_len, original.file());
 }
 
 source_info source_info::from(const source_info &one, const source_info &two) {
   return source_info(one.position(),
-      one.line(),
-      one.column(),
       // needs to include any spaces between the two source_infos
       (two.position() - one.position()) + two.length(),
-      one.path());
+      one.file());
 }
 
 bool token::is_literal() const {
@@ -136,37 +557,333 @@ bool token::is_assignment() const {
          || type() == kind::symbol_plusequal;
 }
 
+token token::from_integer(std::size_t pos,
+    std::string_view raw,
+    util::file_id file,
+    std::uint64_t value,
+    literal_suffix suffix) {
+  auto tok = token(pos, kind::literal_number, raw, file);
+  tok.m_payload = value;
+  tok.m_suffix = suffix;
+
+  return tok;
+}
+
+token token::from_float(std::size_t pos,
+    std::string_view raw,
+    util::file_id file,
+    double value,
+    literal_suffix suffix) {
+  auto tok = token(pos, kind::literal_float, raw, file);
+  std::memcpy(&tok.m_payload, &value, sizeof(value));
+  tok.m_suffix = suffix;
+
+  return tok;
+}
+
+double token::floating() const {
+  double value;
+  std::memcpy(&value, &m_payload, sizeof(value));
+
+  return value;
+}
+
+token_buffer::token_buffer(util::file_id file)
+    : token_buffer(file, util::source_manager::instance().source(file)) {}
+
+token_buffer::token_buffer(util::file_id file, std::string_view source)
+    : m_file(file)
+    , m_source(source) {}
+
+void token_buffer::push_back(const token &tok) {
+  assert(tok.file() == m_file && "token is from a different file than the buffer");
+
+  m_kinds.push_back(tok.m_type);
+  m_suffixes.push_back(tok.m_suffix);
+  m_offsets.push_back(static_cast<std::uint32_t>(tok.position()));
+  m_lengths.push_back(static_cast<std::uint32_t>(tok.length()));
+  m_payloads.push_back(tok.m_payload);
+}
+
+void token_buffer::append(const token_buffer &other) {
+  assert(other.m_file == m_file && "buffers are for different files");
+
+  m_kinds.insert(m_kinds.end(), other.m_kinds.begin(), other.m_kinds.end());
+  m_suffixes.insert(m_suffixes.end(), other.m_suffixes.begin(), other.m_suffixes.end());
+  m_offsets.insert(m_offsets.end(), other.m_offsets.begin(), other.m_offsets.end());
+  m_lengths.insert(m_lengths.end(), other.m_lengths.begin(), other.m_lengths.end());
+  m_payloads.insert(m_payloads.end(), other.m_payloads.begin(), other.m_payloads.end());
+}
+
+/**
+ * @brief Replaces [begin, end) of @p into with everything in @p from
+ * @details Overwrites as much as it can, so the tail of @p into is only moved
+ * when the number of elements changes
+ */
+template <typename T>
+static void splice(std::vector<T> &into,
+    std::size_t begin,
+    std::size_t end,
+    const std::vector<T> &from) {
+  auto common = std::min(end - begin, from.size());
+  auto from_common = from.begin() + static_cast<std::ptrdiff_t>(common);
+
+  std::copy(from.begin(), from_common, into.begin() + static_cast<std::ptrdiff_t>(begin));
+
+  if (from.size() > common) {
+    into.insert(into.begin() + static_cast<std::ptrdiff_t>(end), from_common, from.end());
+  } else {
+    into.erase(into.begin() + static_cast<std::ptrdiff_t>(begin + common),
+        into.begin() + static_cast<std::ptrdiff_t>(end));
+  }
+}
+
+void token_buffer::patch(std::string_view source,
+    std::size_t begin,
+    std::size_t end,
+    const token_buffer &replacement,
+    std::int64_t shift) {
+  assert(replacement.m_file == m_file && "buffers are for different files");
+  assert(begin <= end && end <= size() && "range is out of bounds");
+
+  splice(m_kinds, begin, end, replacement.m_kinds);
+  splice(m_suffixes, begin, end, replacement.m_suffixes);
+  splice(m_offsets, begin, end, replacement.m_offsets);
+  splice(m_lengths, begin, end, replacement.m_lengths);
+  splice(m_payloads, begin, end, replacement.m_payloads);
+
+  // unsigned overflow wraps, so this moves offsets back for a negative shift too
+  auto delta = static_cast<std::uint32_t>(shift);
+
+  for (auto i = begin + replacement.size(); i < m_offsets.size(); ++i) {
+    m_offsets[i] += delta;
+  }
+
+  m_source = source;
+}
+
+void token_buffer::reserve(std::size_t count) {
+  m_kinds.reserve(count);
+  m_suffixes.reserve(count);
+  m_offsets.reserve(count);
+  m_lengths.reserve(count);
+  m_payloads.reserve(count);
+}
+
+token token_buffer::operator[](std::size_t index) const {
+  auto tok = token(m_offsets[index],
+      m_kinds[index],
+      m_source.substr(m_offsets[index], m_lengths[index]),
+      m_file);
+  tok.m_suffix = m_suffixes[index];
+  tok.m_payload = m_payloads[index];
+
+  return tok;
+}
+
+/**
+ * @brief Gets the value of a digit in any base up to 16
+ * @param c The character
+ * @return The digit's value, or 16 if @p c isn't a digit
+ */
+static unsigned digit_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return static_cast<unsigned>(c - '0');
+  }
+
+  if (c >= 'a' && c <= 'f') {
+    return static_cast<unsigned>(c - 'a' + 10);
+  }
+
+  if (c >= 'A' && c <= 'F') {
+    return static_cast<unsigned>(c - 'A' + 10);
+  }
+
+  return 16;
+}
+
+/** @brief Limits for the exact fast path of `decode_float`, these depend on the type */
+template <class T> struct float_limits;
+
+template <> struct float_limits<float> {
+  // 2^24, and the largest power of ten that a float holds exactly
+  static constexpr std::uint64_t max_mantissa = std::uint64_t{1} << 24;
+  static constexpr std::int64_t max_exponent = 10;
+  static constexpr float powers[] =
+      {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+  static float parse(const char *str) { return std::strtof(str, nullptr); }
+};
+
+template <> struct float_limits<double> {
+  // 2^53, and the largest power of ten that a double holds exactly
+  static constexpr std::uint64_t max_mantissa = std::uint64_t{1} << 53;
+  static constexpr std::int64_t max_exponent = 22;
+  static constexpr double powers[] = {1e0,
+      1e1,
+      1e2,
+      1e3,
+      1e4,
+      1e5,
+      1e6,
+      1e7,
+      1e8,
+      1e9,
+      1e10,
+      1e11,
+      1e12,
+      1e13,
+      1e14,
+      1e15,
+      1e16,
+      1e17,
+      1e18,
+      1e19,
+      1e20,
+      1e21,
+      1e22};
+
+  static double parse(const char *str) { return std::strtod(str, nullptr); }
+};
+
+/**
+ * @brief Turns an already scanned decimal float literal into a correctly rounded value
+ * @details When the mantissa and the power of ten are both exact in @p T, one multiply
+ * or divide rounds correctly (Clinger's fast path). Anything else goes through strtod,
+ * which needs the text without any `_`s in it.
+ * @param digits The text of the literal, without the suffix
+ * @param mantissa The digits of the literal as an integer, ignoring the '.'
+ * @param exponent The power of ten @p mantissa needs to be scaled by
+ * @param exact Whether @p mantissa holds every digit
+ * @return The value
+ */
+template <class T>
+static T decode_float(std::string_view digits,
+    std::uint64_t mantissa,
+    std::int64_t exponent,
+    bool exact) {
+  using limits = float_limits<T>;
+
+  if (exact && mantissa <= limits::max_mantissa && exponent >= -limits::max_exponent
+      && exponent <= limits::max_exponent) {
+    auto value = static_cast<T>(mantissa);
+
+    return (exponent < 0) ? value / limits::powers[-exponent] : value * limits::powers[exponent];
+  }
+
+  char buffer[64];
+  std::string heap;
+  auto out = buffer;
+
+  // literals this long are rare enough to not care about the allocation
+  if (digits.size() >= sizeof(buffer)) {
+    heap.resize(digits.size() + 1);
+    out = heap.data();
+  }
+
+  auto length = std::size_t{0};
+
+  for (auto c : digits) {
+    if (c != '_') {
+      out[length++] = c;
+    }
+  }
+
+  out[length] = '\0';
+
+  return limits::parse(out);
+}
+
+/** @brief Equivalent to `std::isspace` in the "C" locale */
+static bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+/** @brief Equivalent to `std::isdigit` in the "C" locale, safe for bytes past 0x7F */
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+/** @brief Equivalent to `std::isalpha` in the "C" locale, safe for bytes past 0x7F */
+static bool is_alpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+/**
+ * @brief Finds offsets that a source can be split at, where lexing each piece on
+ * its own gives the same result as lexing the whole thing
+ * @details Every split point is whitespace that isn't inside of a string/char literal
+ * or a comment, so it can't be in the middle of a token. This needs to follow the
+ * same rules as the lexer for where literals and comments begin and end.
+ * @param source The source to split
+ * @param begin The offset to start at
+ * @param chunk_size The minimum distance between two split points
+ * @return @p begin, every split point and the size of @p source, in order
+ */
+static std::vector<std::size_t> find_split_points(std::string_view source,
+    std::size_t begin,
+    std::size_t chunk_size) {
+  std::vector<std::size_t> bounds{begin};
+  auto target = begin + chunk_size;
+  auto pos = begin;
+
+  // anything under 2 chunks can't be split
+  if (source.size() < target + chunk_size) {
+    bounds.push_back(source.size());
+
+    return bounds;
+  }
+
+  while (pos < source.size()) {
+    auto c = source[pos];
+    auto next = (pos + 1 < source.size()) ? source[pos + 1] : '\0';
+
+    if (c == '"' || c == '\'') {
+      ++pos;
+
+      while (pos < source.size() && source[pos] != c) {
+        // same escaping rule as consume_stringlike, only the delimiter can be escaped
+        auto escaped = source[pos] == '\\' && pos + 1 < source.size() && source[pos + 1] == c;
+
+        pos += escaped ? 2 : 1;
+      }
+
+      ++pos;
+    } else if (c == '-' && next == '-') {
+      // the newline ending the comment is eaten by it, the next position is fine though
+      pos = util::find_newline(source, pos + 2) + 1;
+    } else if (c == '-' && next == '*') {
+      auto end = util::find_block_comment_end(source, pos + 2);
+
+      pos = (end == std::string_view::npos) ? source.size() : end + 2;
+    } else {
+      if (pos >= target && is_space(c) && source.size() - pos >= chunk_size) {
+        bounds.push_back(pos);
+        target = pos + chunk_size;
+      }
+
+      ++pos;
+    }
+  }
+
+  bounds.push_back(source.size());
+
+  return bounds;
+}
+
 /** @brief Implementation of the internal `impl` type */
 class lexer::impl {
   /** @brief string_view to the source code */
   std::string_view m_source;
 
-  /** @brief The current path being lexed */
-  fs::path m_path;
+  /** @brief The file being lexed */
+  util::file_id m_file;
 
   /** @brief The current position in the source */
   std::size_t m_pos = 0;
 
-  /** @brief The current line */
-  std::size_t m_line = 1;
-
-  /** @brief The current column */
-  std::size_t m_col = 1;
-
   /** @brief Used whenever a multi-char token is being consumed */
   std::size_t m_starting_pos = 0;
 
-  /** @brief Used whenever a multi-char token is being consumed */
-  std::size_t m_starting_line = 1;
-
-  /** @brief Used whenever a multi-char token is being consumed */
-  std::size_t m_starting_col = 1;
-
-  /** @brief Iterator to m_source */
-  std::string_view::const_iterator m_it;
+  /** @brief Where errors are reported to */
+  errors::diagnostic_sink *m_diagnostics;
 
-  /** @brief The function to call with registered errors */
-  lexer::register_fn m_register;
+  /** @brief Which of `next_dfa` and `next_legacy` is used */
+  lexer_engine m_engine;
 
   /** @brief Updates the m_starting_* fields with the current lexer state */
   void update_starting();
@@ -180,12 +897,12 @@ class lexer::impl {
   [[nodiscard]] token create_token(token::kind kind, std::string_view raw) const;
 
   /**
-   * @brief Creates and registers an error
+   * @brief Reports an error
    * @param code The error code
-   * @param tok The error-causing token
+   * @param raw The offending text, must be a view into `m_source`
    * @param note A helpful "note" message
    */
-  void create_error(ec code, token tok, std::string note = "");
+  void create_error(ec code, std::string_view raw, std::string_view note = "");
 
   /**
    * @brief Returns the next character, or EOF
@@ -211,12 +928,26 @@ class lexer::impl {
    */
   [[nodiscard]] std::optional<token> consume_digits();
 
+  /**
+   * @brief Decodes a number literal that's already been scanned
+   * @param raw The whole literal, including any suffix
+   * @return The token, or nothing if it was invalid (the error is already reported)
+   */
+  [[nodiscard]] std::optional<token> number_token(std::string_view raw);
+
   /**
    * @brief Consumes a keyword or an identifier
    * @return A token for the id/keyword
    */
   [[nodiscard]] std::optional<token> consume_identifier();
 
+  /**
+   * @brief Creates the token for a keyword or an identifier that's already been scanned
+   * @param raw The keyword/identifier
+   * @return The token
+   */
+  [[nodiscard]] token identifier_token(std::string_view raw) const;
+
   /**
    * @brief Consumes a string literal
    * @return The string literal as a token
@@ -242,7 +973,7 @@ class lexer::impl {
       auto code = (C == '"') ? ec::unterminated_str : ec::unterminated_char;
       auto source = m_source.substr(m_starting_pos, m_pos - m_starting_pos);
 
-      create_error(code, create_token(kind, source));
+      create_error(code, source);
 
       return std::nullopt;
     }
@@ -259,112 +990,498 @@ class lexer::impl {
    */
   char consume(int n = 1);
 
+  /**
+   * @brief Jumps forward to @p pos
+   * @param pos The offset to move to, must be >= the current position
+   */
+  void advance_to(std::size_t pos);
+
 public:
-  impl(std::string_view src, fs::path path, register_fn func)
-      : m_source(src)
-      , m_path(path)
-      , m_it(m_source.begin())
-      , m_register(func) {}
+  impl(util::file_id file,
+      errors::diagnostic_sink &diagnostics,
+      std::size_t begin,
+      std::size_t end,
+      lexer_engine engine)
+      : impl(util::source_manager::instance().source(file),
+            file,
+            diagnostics,
+            begin,
+            end,
+            engine) {}
+
+  impl(std::string_view source,
+      util::file_id file,
+      errors::diagnostic_sink &diagnostics,
+      std::size_t begin,
+      std::size_t end,
+      lexer_engine engine)
+      : m_source(source.substr(0, end))
+      , m_file(file)
+      , m_pos(begin)
+      , m_starting_pos(begin)
+      , m_diagnostics(&diagnostics)
+      , m_engine(engine) {
+    assert(diagnostics.file() == file && "diagnostics are for a different file");
+  }
+
+  std::optional<token> next();
+
+  /**
+   * @brief Lexes the next token with the DFA
+   * @return The token, or nothing at the end
+   */
+  std::optional<token> next_dfa();
+
+  /**
+   * @brief Lexes the next token with the hand-written lexer, the DFA is checked against it
+   * @return The token, or nothing at the end
+   */
+  std::optional<token> next_legacy();
 
-  std::vector<token> lex();
+  lexer::return_type lex();
+
+  lexer::return_type lex(util::thread_pool &pool, std::size_t chunk_size);
 };
 
-lexer::lexer(std::string_view source, fs::path path, register_fn register_func)
-    : m_impl(std::make_unique<lexer::impl>(source, path, register_func)) {}
+lexer::lexer(util::file_id file, errors::diagnostic_sink &diagnostics, lexer_engine engine)
+    : lexer(file, diagnostics, 0, std::string_view::npos, engine) {}
+
+lexer::lexer(util::file_id file,
+    errors::diagnostic_sink &diagnostics,
+    std::size_t begin,
+    std::size_t end,
+    lexer_engine engine)
+    : m_impl(std::make_unique<lexer::impl>(file, diagnostics, begin, end, engine)) {}
+
+lexer::lexer(lexer &&) noexcept = default;
+
+lexer &lexer::operator=(lexer &&) noexcept = default;
 
 lexer::~lexer() = default;
 
-std::vector<token> lexer::lex() {
-  // at the moment it just needs to call the impl parse()
-  return m_impl->lex();
+std::string text_edit::apply(std::string_view source) const {
+  auto result = std::string(source.substr(0, offset));
+
+  result.append(inserted);
+  result.append(source.substr(offset + removed));
+
+  return result;
 }
 
-char lexer::impl::peek() const { return m_it == m_source.end() ? EOF : m_it[1]; }
+std::optional<token> lexer::next() { return m_impl->next(); }
+
+lexer::return_type lexer::lex() { return m_impl->lex(); }
 
-char lexer::impl::current() const {
-  // no checks needed, if it's past the end it needs to crash at this point
-  return *m_it;
+lexer::return_type lexer::lex(util::thread_pool &pool, std::size_t chunk_size) {
+  return m_impl->lex(pool, chunk_size);
 }
 
-bool lexer::impl::is_at_end() const {
-  // current() won't return EOF, EOF isn't actually in the source string
-  // peek() returns it if the current() is past the end
-  return peek() == EOF;
+void lexer::relex(return_type &tokens,
+    std::string_view edited,
+    const text_edit &edit,
+    errors::diagnostic_sink &diagnostics) {
+  // the lexer can look at most 2 characters past the end of a token before it gives up
+  // on making it longer (`1e+` is `1e` and `+`), anything closer than that to the edit
+  // could have come out differently
+  constexpr auto lookahead = std::size_t{2};
+
+  assert(edited.size() == tokens.source().size() - edit.removed + edit.inserted.size()
+         && "edited source doesn't match the edit");
+
+  // tokens never overlap, so the token ends are sorted and the stable ones are a prefix
+  auto stable = std::size_t{0};
+
+  for (auto count = tokens.size(); count > 0;) {
+    auto half = count / 2;
+    auto middle = stable + half;
+
+    if (tokens.offset(middle) + tokens.length(middle) + lookahead <= edit.offset) {
+      stable = middle + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+
+  auto restart = (stable == 0) ? 0 : tokens.offset(stable - 1) + tokens.length(stable - 1);
+  auto shift = static_cast<std::int64_t>(edit.inserted.size())
+               - static_cast<std::int64_t>(edit.removed);
+  auto edit_end = edit.offset + edit.inserted.size();
+
+  // the first token that starts after the edit, in the old positions
+  auto old = stable;
+
+  while (old < tokens.size() && tokens.offset(old) < edit.offset + edit.removed) {
+    ++old;
+  }
+
+  return_type relexed(tokens.file(), edited);
+  auto relexer = impl(edited,
+      tokens.file(),
+      diagnostics,
+      restart,
+      std::string_view::npos,
+      lexer_engine::dfa);
+
+  while (auto tok = relexer.next()) {
+    // past the edit, the text is identical to before. a token that starts at the same
+    // place as an old one means the lexer is back in sync, everything after it is the same
+    if (tok->position() >= edit_end) {
+      while (old < tokens.size()
+             && static_cast<std::int64_t>(tokens.offset(old)) + shift
+                    < static_cast<std::int64_t>(tok->position())) {
+        ++old;
+      }
+
+      if (old < tokens.size()
+          && static_cast<std::int64_t>(tokens.offset(old)) + shift
+                 == static_cast<std::int64_t>(tok->position())
+          && tokens.kind(old) == tok->type() && tokens.length(old) == tok->length()) {
+        tokens.patch(edited, stable, old, relexed, shift);
+
+        return;
+      }
+    }
+
+    relexed.push_back(tok.value());
+  }
+
+  tokens.patch(edited, stable, tokens.size(), relexed, shift);
 }
 
+char lexer::impl::peek() const {
+  // '\0' never matches anything the lexer looks for, so it works as a "nothing here"
+  return (m_pos + 1 < m_source.size()) ? m_source[m_pos + 1] : '\0';
+}
+
+char lexer::impl::current() const { return is_at_end() ? '\0' : m_source[m_pos]; }
+
+bool lexer::impl::is_at_end() const { return m_pos >= m_source.size(); }
+
 token lexer::impl::create_token(token::kind kind, std::string_view raw) const {
-  return token(m_starting_pos, m_starting_line, m_starting_col, kind, raw, m_path);
+  return token(m_starting_pos, kind, raw, m_file);
 }
 
-void lexer::impl::create_error(ec code, token tok, std::string note) {
-  m_register(errors::error::from(code, tok, note));
+void lexer::impl::create_error(ec code, std::string_view raw, std::string_view note) {
+  auto offset = static_cast<std::size_t>(raw.data() - m_source.data());
+
+  m_diagnostics->report(code, offset, raw.size(), note);
 }
 
 void lexer::impl::update_starting() {
   m_starting_pos = m_pos;
-  m_starting_line = m_line;
-  m_starting_col = m_col;
 }
 
 char lexer::impl::consume(int n) {
-  for (auto i = 0; i < n; ++i) {
-    switch (current()) {
-      case '\n':
-        ++m_line;
-        m_col = 1;
-        break;
-      default:
-        ++m_col;
-        break;
-    }
+  m_pos += static_cast<std::size_t>(n);
 
-    ++m_pos;
-    ++m_it;
-  }
+  return current();
+}
 
-  return *m_it;
+void lexer::impl::advance_to(std::size_t pos) {
+  assert(pos >= m_pos && "advance_to() can only move forwards");
+
+  m_pos = pos;
 }
 
 std::optional<token> lexer::impl::consume_digits() {
-  while (!is_at_end() && (std::isdigit(current()) || current() == '.')) {
+  auto radix = 10u;
+
+  if (current() == '0' && (peek() == 'x' || peek() == 'X')) {
+    radix = 16;
+    consume(2);
+  } else if (current() == '0' && (peek() == 'b' || peek() == 'B')) {
+    radix = 2;
+    consume(2);
+  }
+
+  while (current() == '_' || digit_value(current()) < radix) {
     consume();
   }
 
-  if (std::isalpha(current())) {
-    auto result = consume_identifier();
+  if (radix == 10 && current() == '.') {
+    consume();
 
-    create_error(ec::unexpected_tok, result.value(), "Did you leave out a space?");
+    while (current() == '_' || is_digit(current())) {
+      consume();
+    }
+  }
+
+  auto has_exponent_digits = is_digit(peek())
+                             || ((peek() == '+' || peek() == '-') && m_pos + 2 < m_source.size()
+                                 && is_digit(m_source[m_pos + 2]));
+
+  if (radix == 10 && (current() == 'e' || current() == 'E') && has_exponent_digits) {
+    consume(2);
+
+    while (current() == '_' || is_digit(current())) {
+      consume();
+    }
+  }
+
+  // anything stuck onto the end of the digits is either a suffix or a mistake
+  while (is_alpha(current()) || is_digit(current()) || current() == '_') {
+    consume();
+  }
+
+  return number_token(m_source.substr(m_starting_pos, m_pos - m_starting_pos));
+}
+
+std::optional<token> lexer::impl::number_token(std::string_view raw) {
+  constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+  auto at = [raw](std::size_t i) { return (i < raw.size()) ? raw[i] : '\0'; };
+  auto radix = 10u;
+  auto i = std::size_t{0};
+
+  if (at(0) == '0' && (at(1) == 'x' || at(1) == 'X')) {
+    radix = 16;
+    i = 2;
+  } else if (at(0) == '0' && (at(1) == 'b' || at(1) == 'B')) {
+    radix = 2;
+    i = 2;
+  }
+
+  std::uint64_t value = 0;
+  std::int64_t exponent = 0;
+  auto overflowed = false;
+  auto is_float = false;
+  auto digit_count = 0;
+
+  // once a digit doesn't fit, every digit after it is dropped. integers report that,
+  // floats just need to scale by the dropped digits and go through the slow path
+  auto accumulate = [&](unsigned digit) {
+    overflowed = overflowed || value > (max - digit) / radix;
+
+    if (!overflowed) {
+      value = value * radix + digit;
+    }
+
+    ++digit_count;
+
+    return !overflowed;
+  };
+
+  for (; at(i) == '_' || digit_value(at(i)) < radix; ++i) {
+    if (at(i) != '_' && !accumulate(digit_value(at(i)))) {
+      ++exponent;
+    }
+  }
+
+  if (radix == 10 && at(i) == '.') {
+    is_float = true;
+
+    for (++i; at(i) == '_' || is_digit(at(i)); ++i) {
+      if (at(i) != '_' && accumulate(digit_value(at(i)))) {
+        --exponent;
+      }
+    }
+  }
+
+  // the literal only has an exponent if there are digits after the `e`, `1e` is
+  // a `1` with a (bad) suffix
+  auto has_exponent_digits = is_digit(at(i + 1))
+                             || ((at(i + 1) == '+' || at(i + 1) == '-') && is_digit(at(i + 2)));
+
+  if (radix == 10 && (at(i) == 'e' || at(i) == 'E') && has_exponent_digits) {
+    is_float = true;
+    auto negative = at(++i) == '-';
+    auto written = std::int64_t{0};
+
+    if (at(i) == '+' || at(i) == '-') {
+      ++i;
+    }
+
+    for (; at(i) == '_' || is_digit(at(i)); ++i) {
+      // anything this big is inf/0 no matter what, it just can't overflow
+      if (at(i) != '_' && written < 100000) {
+        written = written * 10 + (at(i) - '0');
+      }
+    }
+
+    exponent += negative ? -written : written;
+  }
+
+  auto digits = raw.substr(0, i);
+  auto written_suffix = raw.substr(i);
+  auto suffix = token::literal_suffix::none;
+
+  if (!written_suffix.empty()) {
+    auto result = util::suffix_from_string(written_suffix);
+
+    if (!result) {
+      auto note = (radix == 2 && is_digit(written_suffix.front()))
+                      ? "Binary literals can only contain '0' and '1'."
+                      : "Did you leave out a space?";
+
+      create_error(ec::unexpected_tok, raw, note);
+
+      return std::nullopt;
+    }
+
+    suffix = result.value();
+  }
+
+  auto float_suffix = suffix == token::literal_suffix::f32 || suffix == token::literal_suffix::f64;
+
+  if (digit_count == 0) {
+    create_error(ec::unexpected_tok, raw, "Expected digits after the base prefix.");
+
+    return std::nullopt;
+  }
+
+  if (radix != 10 && float_suffix) {
+    create_error(ec::unexpected_tok, raw, "Hex and binary literals can't have a float suffix.");
+
+    return std::nullopt;
+  }
+
+  if (is_float && suffix != token::literal_suffix::none && !float_suffix) {
+    create_error(ec::unexpected_tok, raw, "Float literals can only have an 'f32' or 'f64' suffix.");
 
     return std::nullopt;
   }
 
-  auto raw = m_source.substr(m_starting_pos, m_pos - m_starting_pos);
-  auto lit_type = (raw.find('.') != std::string_view::npos) ? token::kind::literal_float
-                                                            : token::kind::literal_number;
+  if (is_float || float_suffix) {
+    // f32 literals are rounded straight to float, rounding to double first could be off by one
+    auto result = (suffix == token::literal_suffix::f64)
+                      ? decode_float<double>(digits, value, exponent, !overflowed)
+                      : decode_float<float>(digits, value, exponent, !overflowed);
+
+    return token::from_float(m_starting_pos, raw, m_file, result, suffix);
+  }
+
+  if (overflowed) {
+    create_error(ec::number_literal_too_large,
+        raw,
+        "Number literals can't be larger than 64 bits.");
+
+    // the error is already out, the parser shouldn't report another one
+    value = 0;
+  }
 
-  return create_token(lit_type, raw);
+  return token::from_integer(m_starting_pos, raw, m_file, value, suffix);
 }
 
 std::optional<token> lexer::impl::consume_identifier() {
-  while (!is_at_end() && (std::isalpha(current()) || std::isdigit(current()) || current() == '_')) {
+  while (!is_at_end() && (is_alpha(current()) || is_digit(current()) || current() == '_')) {
     consume();
   }
 
-  auto full = m_source.substr(m_starting_pos, m_pos - m_starting_pos);
+  return identifier_token(m_source.substr(m_starting_pos, m_pos - m_starting_pos));
+}
+
+token lexer::impl::identifier_token(std::string_view raw) const {
+  if (util::is_kind(raw)) {
+    return create_token(util::kind_from_string(raw), raw);
+  }
 
-  return create_token(util::is_kind(full) ? util::kind_from_string(full) : token::kind::identifier,
-      full);
+  return token(m_starting_pos,
+      token::kind::identifier,
+      raw,
+      m_file,
+      util::interner::instance().intern(raw));
 }
 
-lexer::return_type lexer::impl::lex() {
-  lexer::return_type tokens;
+std::optional<token> lexer::impl::next() {
+  return (m_engine == lexer_engine::dfa) ? next_dfa() : next_legacy();
+}
 
+std::optional<token> lexer::impl::next_dfa() {
   while (!is_at_end()) {
-    // chew through any whitespace
-    if (std::isspace(current())) {
-      do {
-        consume();
-      } while (std::isspace(current()));
+    update_starting();
+
+    auto state = std::uint8_t{st_start};
+    auto accepted = std::uint8_t{st_dead};
+    auto end = m_pos;
+
+    // maximal munch, run until the DFA dies and use the last accepting state it went through
+    for (auto i = m_pos; i < m_source.size(); ++i) {
+      state = lexer_dfa.next[state][lexer_dfa.of(m_source[i])];
+
+      if (state == st_dead) {
+        break;
+      }
+
+      if (lexer_dfa.actions[state] != dfa_action::none) {
+        accepted = state;
+        end = i + 1;
+      }
+    }
+
+    auto raw = m_source.substr(m_starting_pos, end - m_starting_pos);
+
+    switch (lexer_dfa.actions[accepted]) {
+      case dfa_action::whitespace:
+        advance_to(util::skip_whitespace(m_source, end));
+        break;
+
+      case dfa_action::line_comment:
+        advance_to(util::find_newline(m_source, end));
+
+        if (!is_at_end()) {
+          consume();
+        }
+
+        break;
+
+      case dfa_action::block_comment: {
+        auto comment_end = util::find_block_comment_end(m_source, end);
+
+        if (comment_end == std::string_view::npos) {
+          create_error(ec::unterminated_block_comment,
+              raw,
+              "did you leave out '*-' to end the comment?");
+          advance_to(m_source.size());
+        } else {
+          advance_to(comment_end + 2);
+        }
+
+        break;
+      }
+
+      case dfa_action::identifier:
+        advance_to(end);
+
+        return identifier_token(raw);
+
+      case dfa_action::number:
+        advance_to(end);
+
+        if (auto result = number_token(raw); result) {
+          return result;
+        }
+
+        break;
+
+      case dfa_action::simple:
+        advance_to(end);
+
+        return create_token(lexer_dfa.kinds[accepted], raw);
+
+      case dfa_action::none:
+        // only string/char literals can go on without accepting, that means they never ended
+        if (current() == '"' || current() == '\'') {
+          auto code = (current() == '"') ? ec::unterminated_str : ec::unterminated_char;
+
+          create_error(code, m_source.substr(m_starting_pos));
+          advance_to(m_source.size());
+        } else {
+          create_error(ec::unknown_char, m_source.substr(m_pos, 1));
+          consume();
+        }
+
+        break;
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<token> lexer::impl::next_legacy() {
+  while (!is_at_end()) {
+    // chew through any whitespace, this is done in bulk rather than going char by char
+    if (is_space(current())) {
+      advance_to(util::skip_whitespace(m_source, m_pos));
 
       // it may or may not be at the end of the file, so the loop needs to restart to check
       continue;
@@ -376,10 +1493,7 @@ lexer::return_type lexer::impl::lex() {
     // handle line comments
     if (current() == '-' && peek() == '-') {
       consume(2);
-
-      while (!is_at_end() && current() != '\n') {
-        consume();
-      }
+      advance_to(util::find_newline(m_source, m_pos));
 
       if (is_at_end()) {
         continue;
@@ -391,13 +1505,12 @@ lexer::return_type lexer::impl::lex() {
     else if (current() == '-' && peek() == '*') {
       consume(2);
 
-      while (!is_at_end() && !(current() == '*' && peek() == '-')) {
-        consume();
-      }
+      auto end = util::find_block_comment_end(m_source, m_pos);
+      advance_to((end == std::string_view::npos) ? m_source.size() : end);
 
       if (is_at_end()) {
         create_error(ec::unterminated_block_comment,
-            create_token(token::kind::error, m_source.substr(m_starting_pos, 2)),
+            m_source.substr(m_starting_pos, 2),
             "did you leave out '*-' to end the comment?");
       } else {
         consume(2);
@@ -405,90 +1518,122 @@ lexer::return_type lexer::impl::lex() {
     }
 
     // handle digit literals
-    else if (std::isdigit(current())) {
+    else if (is_digit(current())) {
       if (auto result = consume_digits(); result) {
-        tokens.emplace_back(std::move(result.value()));
+        return result;
       }
     }
 
     // handle keywords / identifiers
-    else if (std::isalpha(current()) || current() == '_') {
-      tokens.emplace_back(consume_identifier().value());
+    else if (is_alpha(current()) || current() == '_') {
+      return consume_identifier();
     }
 
-    else if (current() == '.' && std::isdigit(peek())) {
+    else if (current() == '.' && is_digit(peek())) {
       if (auto result = consume_digits(); result) {
-        tokens.emplace_back(std::move(result.value()));
-      }
-    }
-
-    else if (current() == '<' && peek() == '<') {
-      consume(2);
-
-      if (!is_at_end() && current() == '=') {
-        consume();
-
-        tokens.emplace_back(
-            create_token(token::kind::symbol_ltltequal, m_source.substr(m_starting_pos, 3)));
-      } else {
-        tokens.emplace_back(
-            create_token(token::kind::symbol_ltlt, m_source.substr(m_starting_pos, 2)));
+        return result;
       }
     }
 
-    else if (current() == '>' && peek() == '>') {
-      consume(2);
-
-      if (!is_at_end() && current() == '=') {
-        consume();
+    // handle every kind of symbol in one go
+    else if (auto [kind, length] = match_symbol(m_source, m_pos); length != 0) {
+      consume(static_cast<int>(length));
 
-        tokens.emplace_back(
-            create_token(token::kind::symbol_gtgtequal, m_source.substr(m_starting_pos, 3)));
-      } else {
-        tokens.emplace_back(
-            create_token(token::kind::symbol_gtgt, m_source.substr(m_starting_pos, 2)));
-      }
-    }
-
-    else if (auto single_char_search = single_char_symbols.find(std::string{current()});
-             single_char_search != single_char_symbols.end()) {
-      tokens.emplace_back(create_token(single_char_search->second, m_source.substr(m_pos, 1)));
-      consume();
-    }
-
-    // could be a symbol with 2 characters
-    else if (auto twoc_search_1 = one_or_two_char_symbols.find(std::string{current(), peek()});
-             twoc_search_1 != one_or_two_char_symbols.end()) {
-      tokens.emplace_back(create_token(twoc_search_1->second, m_source.substr(m_pos, 2)));
-      consume(2);
-    }
-
-    // could be a 1 char symbol that starts with the same symbol as a 2 char
-    else if (auto twoc_search_2 = one_or_two_char_symbols.find(std::string{current()});
-             twoc_search_2 != one_or_two_char_symbols.end()) {
-      tokens.emplace_back(create_token(twoc_search_2->second, m_source.substr(m_pos, 1)));
-      consume();
+      return create_token(kind, m_source.substr(m_starting_pos, length));
     }
 
     // handle string literals
     else if (current() == '"') {
       if (auto result = consume_stringlike<'"'>(); result) {
-        tokens.emplace_back(std::move(result.value()));
+        return result;
       }
     }
 
     // handle char literals
     else if (current() == '\'') {
       if (auto result = consume_stringlike<'\''>(); result) {
-        tokens.emplace_back(std::move(result.value()));
+        return result;
       }
     }
 
     else {
-      create_error(ec::unknown_char, create_token(token::kind::unknown, m_source.substr(m_pos, 1)));
+      create_error(ec::unknown_char, m_source.substr(m_pos, 1));
       consume();
     }
   }
 
+  return std::nullopt;
+}
+
+lexer::return_type lexer::impl::lex() {
+  lexer::return_type tokens(m_file, m_source);
+
+  while (auto tok = next()) {
+    tokens.push_back(tok.value());
+  }
+
+  return tokens;
+}
+
+lexer::return_type lexer::impl::lex(util::thread_pool &pool, std::size_t chunk_size) {
+  auto bounds = find_split_points(m_source, m_pos, chunk_size);
+
+  // not worth handing off to other threads
+  if (bounds.size() <= 2) {
+    return lex();
+  }
+
+  struct chunk_result {
+    lexer::return_type tokens;
+    errors::diagnostic_sink diagnostics;
+  };
+
+  auto source = m_source;
+  auto file = m_file;
+  auto limit = m_diagnostics->limit();
+  auto engine = m_engine;
+
+  auto lex_chunk = [source, file, limit, engine](std::size_t begin, std::size_t end) {
+    // errors are kept until every chunk is done, so they're reported in order
+    chunk_result result{lexer::return_type(file, source), errors::diagnostic_sink(file, limit)};
+
+    result.tokens = impl(source, file, result.diagnostics, begin, end, engine).lex();
+
+    return result;
+  };
+
+  std::vector<std::future<chunk_result>> rest;
+
+  for (std::size_t i = 1; i + 1 < bounds.size(); ++i) {
+    auto begin = bounds[i];
+    auto end = bounds[i + 1];
+
+    rest.emplace_back(pool.submit([lex_chunk, begin, end] { return lex_chunk(begin, end); }));
+  }
+
+  std::vector<chunk_result> chunks;
+  chunks.emplace_back(lex_chunk(bounds[0], bounds[1]));
+
+  for (auto &future : rest) {
+    pool.wait(future);
+    chunks.emplace_back(future.get());
+  }
+
+  auto total = std::size_t{0};
+
+  for (auto &chunk : chunks) {
+    total += chunk.tokens.size();
+  }
+
+  lexer::return_type tokens(m_file, m_source);
+  tokens.reserve(total);
+
+  for (auto &chunk : chunks) {
+    tokens.append(chunk.tokens);
+    m_diagnostics->append(chunk.diagnostics);
+  }
+
+  m_pos = m_source.size();
+
   return tokens;
 }
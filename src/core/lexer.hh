@@ -24,35 +24,39 @@
 #ifndef CASCADE_CORE_LEXER_HH
 #define CASCADE_CORE_LEXER_HH
 
+#include "util/interner.hh"
+#include "util/source_manager.hh"
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <vector>
 
 namespace cascade::errors {
+  class diagnostic_sink;
   class error;
 }
 
+namespace cascade::util {
+  class thread_pool;
+}
+
 namespace cascade::core {
   /** @brief Information that links a token/node to the original source */
   class source_info {
     /** @brief The offset the object begins at in the source code */
-    std::size_t m_position;
-
-    /** @brief The line the object is on */
-    std::size_t m_line;
-
-    /** @brief The column the object is on */
-    std::size_t m_col;
+    std::uint32_t m_position;
 
     /** @brief The length of the object */
-    std::size_t m_length;
+    std::uint32_t m_length;
 
-    /** @brief The path of the file */
-    std::filesystem::path m_path;
+    /** @brief The file the object is in, see util::source_manager */
+    util::file_id m_file;
 
   public:
     /**
@@ -71,38 +75,42 @@ namespace cascade::core {
      */
     static source_info from(const source_info &one, const source_info &two);
 
-    explicit source_info(std::size_t pos,
-        std::size_t line,
-        std::size_t col,
-        std::size_t len,
-        std::filesystem::path path)
-        : m_position{pos}
-        , m_line{line}
-        , m_col{col}
-        , m_length{len}
-        , m_path(std::move(path)) {}
+    explicit source_info(std::size_t pos, std::size_t len, util::file_id file)
+        : m_position{static_cast<std::uint32_t>(pos)}
+        , m_length{static_cast<std::uint32_t>(len)}
+        , m_file{file} {}
 
     /** @brief Returns the token's offset in the source */
     [[nodiscard]] std::size_t position() const { return m_position; }
 
-    /** @brief Returns the line the token appears on */
-    [[nodiscard]] std::size_t line() const { return m_line; }
+    /** @brief Returns the line the token appears on, this is looked up in the source_manager */
+    [[nodiscard]] std::size_t line() const { return location().line; }
 
-    /** @brief Returns the column of the token */
-    [[nodiscard]] std::size_t column() const { return m_col; }
+    /** @brief Returns the column of the token, this is looked up in the source_manager */
+    [[nodiscard]] std::size_t column() const { return location().column; }
+
+    /** @brief Returns the line and column of the token at once */
+    [[nodiscard]] util::source_location location() const {
+      return util::source_manager::instance().location(m_file, m_position);
+    }
 
     /** @brief Returns the number of characters in the token */
     [[nodiscard]] std::size_t length() const { return m_length; }
 
-    /** @brief Returns the file the token came from */
-    [[nodiscard]] const std::filesystem::path &path() const { return m_path; }
+    /** @brief Returns the ID of the file the token came from */
+    [[nodiscard]] util::file_id file() const { return m_file; }
+
+    /** @brief Returns the path of the file the token came from */
+    [[nodiscard]] const std::filesystem::path &path() const {
+      return util::source_manager::instance().path(m_file);
+    }
   };
 
   /** @brief Represents a single lexical token */
   class token {
   public:
     /** @brief Represents the "what kind of" token it is */
-    enum class kind : unsigned {
+    enum class kind : std::uint8_t {
       /** @brief An "unknown" token, almost always an error */
       unknown = std::numeric_limits<std::underlying_type_t<kind>>::min(),
       /** @brief A detected error */
@@ -259,6 +267,21 @@ namespace cascade::core {
       symbol_tilde,
     };
 
+    /** @brief The width suffix written after a number literal, e.g `u8` in `255u8` */
+    enum class literal_suffix : std::uint8_t {
+      none,
+      i8,
+      i16,
+      i32,
+      i64,
+      u8,
+      u16,
+      u32,
+      u64,
+      f32,
+      f64,
+    };
+
   private:
     /** @brief Source info for the token */
     source_info m_info;
@@ -266,29 +289,69 @@ namespace cascade::core {
     /** @brief The type of the token */
     kind m_type;
 
+    /** @brief The suffix of a number literal, `none` for everything else */
+    literal_suffix m_suffix = literal_suffix::none;
+
+    /**
+     * @brief Decoded value of the token. The interned symbol for identifiers,
+     * the integer for number literals and the bits of a double for float literals
+     */
+    std::uint64_t m_payload;
+
     /** @brief Pointer to the raw token */
     std::string_view m_raw;
 
+    friend class token_buffer;
+
   public:
     /**
      * @brief Creates a token
      * @param pos The position in the source string the token begins
-     * @param line The line the token is on
-     * @param col The column the token is on
      * @param type The type of token it is
      * @param raw The raw token
-     * @param path The path of the file
+     * @param file The file the token is in
+     * @param sym The interned identifier, if the token is one
      */
     token(std::size_t pos,
-        std::size_t line,
-        std::size_t col,
         kind type,
         std::string_view raw,
-        std::filesystem::path path)
-        : m_info(pos, line, col, raw.size(), std::move(path))
+        util::file_id file,
+        util::symbol sym = util::interner::empty)
+        : m_info(pos, raw.size(), file)
         , m_type(type)
+        , m_payload(sym)
         , m_raw(std::move(raw)) {}
 
+    /**
+     * @brief Creates a number literal token with its value already decoded
+     * @param pos The position in the source string the token begins
+     * @param raw The raw token
+     * @param file The file the token is in
+     * @param value The value of the literal
+     * @param suffix The literal's suffix
+     * @return A `literal_number` token
+     */
+    static token from_integer(std::size_t pos,
+        std::string_view raw,
+        util::file_id file,
+        std::uint64_t value,
+        literal_suffix suffix);
+
+    /**
+     * @brief Creates a float literal token with its value already decoded
+     * @param pos The position in the source string the token begins
+     * @param raw The raw token
+     * @param file The file the token is in
+     * @param value The value of the literal
+     * @param suffix The literal's suffix
+     * @return A `literal_float` token
+     */
+    static token from_float(std::size_t pos,
+        std::string_view raw,
+        util::file_id file,
+        double value,
+        literal_suffix suffix);
+
     /** @brief Returns a reference to the token's source info */
     [[nodiscard]] const source_info &info() const { return m_info; }
 
@@ -329,6 +392,36 @@ namespace cascade::core {
      */
     [[nodiscard]] kind type() const { return m_type; }
 
+    /**
+     * @brief Returns the interned identifier, only meaningful for identifiers
+     * @return The token's symbol
+     */
+    [[nodiscard]] util::symbol symbol() const { return static_cast<util::symbol>(m_payload); }
+
+    /**
+     * @brief Returns the decoded value of a number literal
+     * @return The literal's value
+     */
+    [[nodiscard]] std::uint64_t integer() const { return m_payload; }
+
+    /**
+     * @brief Returns the decoded value of a float literal
+     * @return The literal's value
+     */
+    [[nodiscard]] double floating() const;
+
+    /**
+     * @brief Returns the suffix of a number/float literal
+     * @return The suffix, `none` if there wasn't one
+     */
+    [[nodiscard]] literal_suffix suffix() const { return m_suffix; }
+
+    /**
+     * @brief Returns the ID of the file the token is in
+     * @return The token's file
+     */
+    [[nodiscard]] util::file_id file() const { return m_info.file(); }
+
     /**
      * @brief Returns the path of the token
      * @return The token's path
@@ -378,6 +471,144 @@ namespace cascade::core {
     [[nodiscard]] bool is_assignment() const;
   };
 
+  /**
+   * @brief A list of tokens from one file, stored as parallel arrays
+   * @details Each token takes 18 bytes instead of the 40 a `token` does, and
+   * the kinds are packed together so scanning them (e.g. to skip to the next
+   * statement) touches one cache line per 64 tokens. Tokens are handed out
+   * by value, `raw()` is rebuilt from the file's source.
+   */
+  class token_buffer {
+    /** @brief The file every token is in */
+    util::file_id m_file;
+
+    /** @brief The source of `m_file` */
+    std::string_view m_source;
+
+    /** @brief The kind of each token */
+    std::vector<token::kind> m_kinds;
+
+    /** @brief The literal suffix of each token */
+    std::vector<token::literal_suffix> m_suffixes;
+
+    /** @brief The offset each token begins at */
+    std::vector<std::uint32_t> m_offsets;
+
+    /** @brief The length of each token */
+    std::vector<std::uint32_t> m_lengths;
+
+    /** @brief The decoded value of each token, see `token::m_payload` */
+    std::vector<std::uint64_t> m_payloads;
+
+  public:
+    /**
+     * @brief Creates an empty buffer
+     * @param file The file the tokens will be from
+     */
+    explicit token_buffer(util::file_id file);
+
+    /**
+     * @brief Creates an empty buffer for a source that isn't the one in the source_manager
+     * @param file The file the tokens will be from
+     * @param source The source of @p file, must outlive the buffer
+     */
+    explicit token_buffer(util::file_id file, std::string_view source);
+
+    /**
+     * @brief Adds a token to the end
+     * @param tok The token, must be from the same file as the buffer
+     */
+    void push_back(const token &tok);
+
+    /**
+     * @brief Moves every token from @p other onto the end
+     * @param other A buffer for the same file, with tokens that come after these
+     */
+    void append(const token_buffer &other);
+
+    /**
+     * @brief Patches the buffer in place after its file was edited
+     * @details The tokens in [begin, end) are replaced with the ones in @p replacement,
+     * and every token after them is moved by @p shift. Nothing is reallocated unless
+     * the buffer grows, and nothing before @p begin is touched.
+     * @param source The edited source, must outlive the buffer
+     * @param begin The index of the first token to replace
+     * @param end One past the index of the last token to replace
+     * @param replacement The new tokens, with offsets into @p source
+     * @param shift How far to move each token after @p end
+     */
+    void patch(std::string_view source,
+        std::size_t begin,
+        std::size_t end,
+        const token_buffer &replacement,
+        std::int64_t shift);
+
+    /**
+     * @brief Makes space for @p count tokens
+     * @param count The number of tokens
+     */
+    void reserve(std::size_t count);
+
+    /** @brief Returns the number of tokens */
+    [[nodiscard]] std::size_t size() const { return m_kinds.size(); }
+
+    /** @brief Returns whether there aren't any tokens */
+    [[nodiscard]] bool empty() const { return m_kinds.empty(); }
+
+    /** @brief Returns the kind of the token at @p index, without building the token */
+    [[nodiscard]] token::kind kind(std::size_t index) const { return m_kinds[index]; }
+
+    /** @brief Returns the kind of every token, in order */
+    [[nodiscard]] const std::vector<token::kind> &kinds() const { return m_kinds; }
+
+    /** @brief Returns the offset the token at @p index begins at, without building the token */
+    [[nodiscard]] std::size_t offset(std::size_t index) const { return m_offsets[index]; }
+
+    /** @brief Returns the length of the token at @p index, without building the token */
+    [[nodiscard]] std::size_t length(std::size_t index) const { return m_lengths[index]; }
+
+    /** @brief Returns the file the tokens are from */
+    [[nodiscard]] util::file_id file() const { return m_file; }
+
+    /** @brief Returns the source the tokens are views into */
+    [[nodiscard]] std::string_view source() const { return m_source; }
+
+    /**
+     * @brief Builds the token at @p index
+     * @param index The index of the token
+     * @return The token
+     */
+    [[nodiscard]] token operator[](std::size_t index) const;
+  };
+
+  /** @brief A change to a file, `removed` bytes at `offset` were replaced with `inserted` */
+  struct text_edit {
+    /** @brief Where the edit begins */
+    std::size_t offset;
+
+    /** @brief Number of bytes of the old source that were replaced */
+    std::size_t removed;
+
+    /** @brief What they were replaced with */
+    std::string_view inserted;
+
+    /**
+     * @brief Applies the edit to a copy of @p source
+     * @param source The source before the edit
+     * @return The source after the edit
+     */
+    [[nodiscard]] std::string apply(std::string_view source) const;
+  };
+
+  /** @brief How a `lexer` recognizes tokens, both give exactly the same tokens and errors */
+  enum class lexer_engine {
+    /** @brief The table-driven DFA */
+    dfa,
+
+    /** @brief The hand-written lexer the DFA replaced, kept to test the DFA against */
+    legacy,
+  };
+
   /*
    ####################################################################
    *
@@ -397,26 +628,87 @@ namespace cascade::core {
     std::unique_ptr<impl> m_impl;
 
   public:
-    using register_fn = std::function<void(std::unique_ptr<errors::error>)>;
-
-    using return_type = std::vector<token>;
+    using return_type = token_buffer;
 
     /**
      * @brief Creates the lexer
-     * @param source The source code
-     * @param file_path The path of the file being lexed
-     * @param register_error A function that's called any time an error is created
-     * by the lexer. The error is passed into the function.
+     * @param file The file to lex, the source is looked up in the source_manager
+     * @param diagnostics Where errors are reported to, must be for @p file and outlive the lexer
+     * @param engine How tokens are recognized
      */
-    explicit lexer(std::string_view source,
-        std::filesystem::path file_path,
-        register_fn register_error);
+    explicit lexer(util::file_id file,
+        errors::diagnostic_sink &diagnostics,
+        lexer_engine engine = lexer_engine::dfa);
+
+    /**
+     * @brief Creates a lexer that only lexes part of a file
+     * @details Positions in the tokens are still relative to the start of the file.
+     * @p begin and @p end need to be on token boundaries, or the tokens will be wrong
+     * @param file The file to lex
+     * @param diagnostics Where errors are reported to, must be for @p file and outlive the lexer
+     * @param begin The offset to start lexing at
+     * @param end The offset to stop lexing at, the lexer acts like the file ends there
+     * @param engine How tokens are recognized
+     */
+    explicit lexer(util::file_id file,
+        errors::diagnostic_sink &diagnostics,
+        std::size_t begin,
+        std::size_t end,
+        lexer_engine engine = lexer_engine::dfa);
+
+    /** @brief Implemented as default */
+    lexer(lexer &&) noexcept;
+
+    /** @brief Implemented as default */
+    lexer &operator=(lexer &&) noexcept;
+
+    /**
+     * @brief (lazily) lexes the next token out of the source string
+     * @return The next token, or std::nullopt once the source is exhausted
+     */
+    std::optional<token> next();
 
     /**
      * @brief (eagerly) lexes the source string given
      * @return A list of tokens
      */
-    std::vector<token> lex();
+    return_type lex();
+
+    /**
+     * @brief (eagerly) lexes the source string given, splitting it up between
+     * the threads in @p pool
+     * @details The result (tokens and the order errors are reported in) is
+     * identical to `lex()`. Errors are reported on the calling thread.
+     * @param pool The pool to lex on
+     * @param chunk_size The minimum number of bytes each thread gets, sources
+     * smaller than two chunks are just lexed serially
+     * @return A list of tokens
+     */
+    return_type lex(util::thread_pool &pool, std::size_t chunk_size = 1 << 20);
+
+    /**
+     * @brief Updates the tokens of a file after an edit, only relexing the part of it
+     * that the edit could change
+     * @details Lexing restarts after the last token that the edit can't have changed,
+     * and stops as soon as it produces a token that also exists in @p tokens after the
+     * edit (same offset once shifted, kind and length). Only the tokens in between are
+     * replaced, the ones after them just have their offsets shifted. Errors are only
+     * reported for the part that was relexed, errors from the rest of the file are the
+     * same as before.
+     *
+     * The edited source is owned by the caller (e.g. an editor's buffer), nothing is
+     * registered with the source_manager. Line/column lookups on the tokens still go
+     * through the source_manager, so they're for the file as it was first registered.
+     * @param tokens The tokens of the whole file before the edit, updated in place.
+     * The old source isn't read, it can already be gone
+     * @param edited The source after the edit, must outlive @p tokens
+     * @param edit The edit that turned the old source into @p edited
+     * @param diagnostics Where errors are reported to, must be for `tokens.file()`
+     */
+    static void relex(return_type &tokens,
+        std::string_view edited,
+        const text_edit &edit,
+        errors::diagnostic_sink &diagnostics);
 
     /** @brief Implemented as default */
     ~lexer();
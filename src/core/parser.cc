@@ -26,11 +26,20 @@
 #include "ast/detail/expressions.hh"
 #include "ast/detail/literals.hh"
 #include "ast/detail/types.hh"
+#include "core/token_stream.hh"
+#include "util/arena.hh"
+#include "util/interner.hh"
+#include "util/keywords.hh"
 #include "util/logging.hh"
-#include <charconv>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <fmt/format.h>
+#include <initializer_list>
+#include <limits>
 #include <memory>
-#include <set>
+#include <optional>
 #include <string>
 
 using namespace cascade;
@@ -38,128 +47,211 @@ using namespace core;
 
 using register_fn = std::function<void(std::unique_ptr<errors::error>)>;
 using srcinfo = source_info;
-using node_ptr = std::unique_ptr<ast::node>;
-using expr_ptr = std::unique_ptr<ast::expression>;
-using stmt_ptr = std::unique_ptr<ast::statement>;
-using decl_ptr = std::unique_ptr<ast::declaration>;
-using type_ptr = std::unique_ptr<ast::type>;
+using node_ptr = ast::ptr<ast::node>;
+using expr_ptr = ast::ptr<ast::expression>;
+using stmt_ptr = ast::ptr<ast::statement>;
+using decl_ptr = ast::ptr<ast::declaration>;
+using type_ptr = ast::ptr<ast::type>;
 using kind = token::kind;
+using suffix = token::literal_suffix;
 using ec = errors::error_code;
 
-static std::set<std::string_view> builtin_words{
-    "i8",
-    "i16",
-    "i32",
-    "i64",
-    "u8",
-    "u16",
-    "u32",
-    "u64",
-    "f32",
-    "f64",
-    "bool",
-};
-
 static bool is_builtin(const token &identifier) {
   assert(identifier.is(kind::identifier) && "calling is_builtin on non-identifier!");
 
-  return builtin_words.find(identifier.raw()) != builtin_words.end();
+  return util::interner::instance().is_builtin(identifier.symbol());
 }
 
-struct error_sentinel {};
+/**
+ * @brief Gets the interned name for a token
+ * @details Identifiers are interned by the lexer, anything else (only ever seen
+ * after an error was reported) gets interned here
+ * @param tok The token
+ * @return The symbol for the token
+ */
+static util::symbol name_of(const token &tok) {
+  return tok.is(kind::identifier) ? tok.symbol() : util::interner::instance().intern(tok.raw());
+}
 
-class parser_impl {
-  lexer::return_type m_toks;
+/**
+ * @brief Gets the largest value an integer literal with a suffix can hold
+ * @param s The suffix, unsuffixed literals are `i32`
+ * @return The maximum value
+ */
+static std::uint64_t max_value(suffix s) {
+  switch (s) {
+    case suffix::i8:
+      return std::numeric_limits<std::int8_t>::max();
+    case suffix::i16:
+      return std::numeric_limits<std::int16_t>::max();
+    case suffix::i64:
+      return std::numeric_limits<std::int64_t>::max();
+    case suffix::u8:
+      return std::numeric_limits<std::uint8_t>::max();
+    case suffix::u16:
+      return std::numeric_limits<std::uint16_t>::max();
+    case suffix::u32:
+      return std::numeric_limits<std::uint32_t>::max();
+    case suffix::u64:
+      return std::numeric_limits<std::uint64_t>::max();
+    default:
+      return std::numeric_limits<std::int32_t>::max();
+  }
+}
 
-  std::size_t m_index;
+/** @brief How tightly an operator binds, higher levels bind tighter */
+enum precedence : std::uint8_t {
+  /** @brief Not an operator at all */
+  prec_none,
+  /** @brief `=`, `+=`, `<<=`, etc. The only right-associative level */
+  prec_assignment,
+  /** @brief `if ... then ... else ...`, only ever a prefix */
+  prec_if,
+  prec_or,
+  prec_xor,
+  prec_and,
+  /** @brief `not`, only ever a prefix */
+  prec_not,
+  prec_equality,
+  prec_relational,
+  prec_bitwise_or,
+  prec_bitwise_xor,
+  prec_bitwise_and,
+  prec_bitshift,
+  prec_additive,
+  prec_multiplicative,
+  /** @brief `-`, `~`, `*`, `#`, `@` and `clone` as prefixes */
+  prec_unary,
+};
 
-  register_fn m_report;
+/** @brief The precedence of every token kind, as a prefix and as an infix operator */
+struct precedence_table {
+  std::array<precedence, 256> prefix;
+  std::array<precedence, 256> infix;
+};
 
-public:
-  /**
-   * @brief Template for parsing a binary expression
-   * @param next_level A lambda / function pointer / functor that returns the next
-   * precedence level
-   * @param kinds The token types to check for inside the `while` loop
-   * @return An expression pointer
-   */
-  template <class HigherLevel, class... Kinds>
-  [[nodiscard]] expr_ptr parse_binary(HigherLevel next_level, Kinds... kinds) {
-    expr_ptr expr = next_level();
+/**
+ * @brief Builds the precedence table
+ * @return The table, anything not set is `prec_none`
+ */
+static constexpr precedence_table build_precedences() {
+  precedence_table table{};
 
-    while (!is_at_end() && current().is_one_of(kinds...)) {
-      auto op = consume();
-      expr_ptr rhs = next_level();
+  auto prefix = [&table](precedence level, std::initializer_list<kind> kinds) {
+    for (auto k : kinds) {
+      table.prefix[static_cast<std::size_t>(k)] = level;
+    }
+  };
 
-      expr = std::make_unique<ast::binary>(srcinfo::from(expr->info(), rhs->info()),
-          op.type(),
-          std::move(expr),
-          std::move(rhs));
+  auto infix = [&table](precedence level, std::initializer_list<kind> kinds) {
+    for (auto k : kinds) {
+      table.infix[static_cast<std::size_t>(k)] = level;
     }
+  };
+
+  prefix(prec_if, {kind::keyword_if});
+  prefix(prec_not, {kind::keyword_not});
+  prefix(prec_unary,
+      {kind::symbol_tilde,
+          kind::symbol_star,
+          kind::symbol_pound,
+          kind::symbol_at,
+          kind::symbol_hyphen,
+          kind::keyword_clone});
+
+  infix(prec_assignment,
+      {kind::symbol_equal,
+          kind::symbol_gtgtequal,
+          kind::symbol_ltltequal,
+          kind::symbol_poundequal,
+          kind::symbol_pipeequal,
+          kind::symbol_caretequal,
+          kind::symbol_percentequal,
+          kind::symbol_forwardslashequal,
+          kind::symbol_starequal,
+          kind::symbol_hyphenequal,
+          kind::symbol_plusequal});
+  infix(prec_or, {kind::keyword_or});
+  infix(prec_xor, {kind::keyword_xor});
+  infix(prec_and, {kind::keyword_and});
+  infix(prec_equality, {kind::symbol_equalequal, kind::symbol_bangequal});
+  infix(prec_relational, {kind::symbol_gt, kind::symbol_geq, kind::symbol_lt, kind::symbol_leq});
+  infix(prec_bitwise_or, {kind::symbol_pipe});
+  infix(prec_bitwise_xor, {kind::symbol_caret});
+  infix(prec_bitwise_and, {kind::symbol_pound});
+  infix(prec_bitshift, {kind::symbol_gtgt, kind::symbol_ltlt});
+  infix(prec_additive, {kind::symbol_plus, kind::symbol_hyphen});
+  infix(prec_multiplicative, {kind::symbol_star, kind::symbol_forwardslash, kind::symbol_percent});
+
+  return table;
+}
 
-    return expr;
-  }
+/** @brief Every token kind's precedence, built at compile time */
+static constexpr auto precedences = build_precedences();
+
+static precedence prefix_precedence(kind k) {
+  return precedences.prefix[static_cast<std::size_t>(k)];
+}
+
+static precedence infix_precedence(kind k) {
+  return precedences.infix[static_cast<std::size_t>(k)];
+}
+
+class parser_impl {
+  token_stream m_toks;
+
+  register_fn m_report;
+
+  /** @brief Every node is allocated in here, it belongs to whatever owns the program */
+  util::arena &m_nodes;
+
+  /** @brief Whether fn bodies are skipped instead of parsed, see `core::skim` */
+  bool m_skim;
 
   /**
-   * @brief Template for parsing a unary expression
-   * @param curr_lvl Function that returns the current precedence level
-   * @param next_lvl Function that returns the next precedence level
-   * @param kinds The kinds to check against in current().is_one_of
-   * @return An expression pointer
+   * @brief Set between an error being reported and the parser recovering from it
+   * @details Errors don't unwind, every parse method returns an empty pointer (the
+   * poison value) as soon as anything it called sets this, and `block()` and `parse()`
+   * resynchronize and clear it. Nothing else gets reported while it's set
    */
-  template <class CurrentLevel, class HigherLevel, class... Kinds>
-  [[nodiscard]] expr_ptr parse_unary(CurrentLevel curr_lvl, HigherLevel next_lvl, Kinds... kinds) {
-    if (!is_at_end() && current().is_one_of(kinds...)) {
-      auto op = consume();
-      expr_ptr rhs = curr_lvl();
-
-      return std::make_unique<ast::unary>(srcinfo::from(op.info(), rhs->info()),
-          op.type(),
-          std::move(rhs));
-    }
+  mutable bool m_panicking = false;
 
-    return next_lvl();
-  }
+  /** @brief Stands in for the current token once every token has been consumed */
+  mutable std::optional<token> m_end;
 
+public:
   // utility methods
   [[nodiscard]] const token &previous() const;
   [[nodiscard]] const token &current() const;
-  [[nodiscard]] const token &current_nothrow() const noexcept;
   [[nodiscard]] const token &next() const;
   [[nodiscard]] bool is_at_end() const;
 
   // actions
   token consume();
   void synchronize();
-  void check_end(std::string note = "");
-  void check_semi(std::string note = "");
+  void recover();
+  [[nodiscard]] bool check_semi(std::string note = "");
 
-  // error reporting
-  [[noreturn]] void report_error(ec code, core::token tok, std::string note = "") const;
-  [[noreturn]] void report_error(ec code, node_ptr node, std::string note = "") const;
-  void report_nothrow(ec code, core::token tok, std::string note = "") const noexcept;
-  void report_nothrow(ec code, node_ptr node, std::string note = "") const noexcept;
+  // error reporting. report_error enters panic mode and returns the poison value for
+  // convenience, report_and_continue reports without entering panic mode
+  std::nullptr_t report_error(ec code, core::token tok, std::string note = "") const;
+  std::nullptr_t report_error(ec code, node_ptr node, std::string note = "") const;
+  void report_and_continue(ec code, core::token tok, std::string note = "") const noexcept;
+  void report_and_continue(ec code, node_ptr node, std::string note = "") const noexcept;
 
   // recursive-descent methods
   [[nodiscard]] expr_ptr block();
   [[nodiscard]] expr_ptr grouping();
   [[nodiscard]] expr_ptr primary();
   [[nodiscard]] expr_ptr call();
-  [[nodiscard]] expr_ptr unary();
-  [[nodiscard]] expr_ptr multiplication();
-  [[nodiscard]] expr_ptr addition();
-  [[nodiscard]] expr_ptr bitshift();
-  [[nodiscard]] expr_ptr bitwise_and();
-  [[nodiscard]] expr_ptr bitwise_xor();
-  [[nodiscard]] expr_ptr bitwise_or();
-  [[nodiscard]] expr_ptr relational();
-  [[nodiscard]] expr_ptr equality();
-  [[nodiscard]] expr_ptr logical_not();
-  [[nodiscard]] expr_ptr logical_and();
-  [[nodiscard]] expr_ptr logical_xor();
-  [[nodiscard]] expr_ptr logical_or();
   [[nodiscard]] expr_ptr if_then();
-  [[nodiscard]] expr_ptr assignment();
+
+  /**
+   * @brief Parses an expression made of operators that bind at least as tightly as @p min
+   * @param min The loosest operator the expression can contain
+   * @return An expression pointer
+   */
+  [[nodiscard]] expr_ptr expression(precedence min);
 
   // utility method for call parsing
   [[nodiscard]] expr_ptr finish_call(expr_ptr);
@@ -188,122 +280,141 @@ public:
   [[nodiscard]] stmt_ptr statement();
   [[nodiscard]] decl_ptr declaration();
 
-  explicit parser_impl(lexer::return_type tokens, register_fn report);
+  explicit parser_impl(token_stream tokens, register_fn report, util::arena &nodes, bool skim);
 
-  ast::program parse();
+  /** @brief Parses every declaration, the list is allocated in the arena */
+  ast::list<decl_ptr> parse();
 };
 
-parser_impl::parser_impl(lexer::return_type tokens, register_fn report)
+parser_impl::parser_impl(token_stream tokens, register_fn report, util::arena &nodes, bool skim)
     : m_toks(std::move(tokens))
-    , m_index{0}
-    , m_report(std::move(report)) {}
+    , m_report(std::move(report))
+    , m_nodes(nodes)
+    , m_skim(skim) {}
 
 token parser_impl::consume() {
-  assert(!is_at_end() && "program isn't at the end of the tokens and trying to consume()");
-  return m_toks[m_index++];
+  if (is_at_end()) {
+    // only reachable after running into the end was reported, see `current()`
+    assert(m_panicking && "trying to consume() past the end without reporting it");
+    return current();
+  }
+
+  return m_toks.consume();
 }
 
 const token &parser_impl::current() const {
   if (is_at_end()) {
     report_error(ec::unexpected_end_of_input, previous());
-  }
 
-  return m_toks[m_index];
-}
+    if (!m_end) {
+      // an empty `unknown` token after the last one, nothing in the grammar matches it
+      auto last = previous().info();
 
-const token &parser_impl::current_nothrow() const noexcept {
-  assert(!is_at_end() && "current_nothrow() isn't being called on end");
-  return m_toks[m_index];
-}
+      m_end.emplace(last.position() + last.length(), kind::unknown, "", last.file());
+    }
 
-const token &parser_impl::previous() const {
-  assert(m_index > 0 && "previous() isn't being called before consume()");
-  return m_toks[m_index - 1];
+    return *m_end;
+  }
+
+  return m_toks.current();
 }
 
+const token &parser_impl::previous() const { return m_toks.previous(); }
+
 const token &parser_impl::next() const {
-  assert(m_index + 1 < m_toks.size() && "next() isn't being called at second-to-last");
-  return m_toks[m_index + 1];
+  assert(m_toks.has_next() && "next() isn't being called at second-to-last");
+  return m_toks.next();
 }
 
-bool parser_impl::is_at_end() const { return m_index == m_toks.size(); }
+bool parser_impl::is_at_end() const { return m_toks.is_at_end(); }
 
 void parser_impl::synchronize() {
-  while (!is_at_end()) {
-    if (current().is(kind::symbol_semicolon)) {
-      consume();
-
-      return;
-    }
-
-    // clang-format off
-    if (current().is_one_of(
-      kind::keyword_if,     kind::keyword_else,      kind::keyword_then, 
-      kind::keyword_fn,     kind::keyword_let,       kind::keyword_mut,
-      kind::keyword_ret,    kind::keyword_import,    kind::keyword_export,
-      kind::keyword_module, kind::keyword_as,        kind::keyword_pub,
-      kind::keyword_assert, kind::symbol_closebrace, kind::symbol_closeparen,
-      kind::symbol_closebracket)) 
-    {
-      return;
-    }
-    // clang-format on
-
+  // clang-format off
+  m_toks.skip_until({
+    kind::symbol_semicolon,
+    kind::keyword_if,     kind::keyword_else,      kind::keyword_then,
+    kind::keyword_fn,     kind::keyword_let,       kind::keyword_mut,
+    kind::keyword_ret,    kind::keyword_import,    kind::keyword_export,
+    kind::keyword_module, kind::keyword_as,        kind::keyword_pub,
+    kind::keyword_assert, kind::symbol_closebrace, kind::symbol_closeparen,
+    kind::symbol_closebracket});
+  // clang-format on
+
+  // the ';' ends the statement that had the error, so it gets skipped too
+  if (!is_at_end() && current().is(kind::symbol_semicolon)) {
     consume();
   }
 }
 
-void parser_impl::check_end(std::string note) {
-  if (is_at_end()) {
-    report_error(ec::unexpected_end_of_input, previous(), note);
-  }
+void parser_impl::recover() {
+  m_panicking = false;
+
+  synchronize();
 }
 
-void parser_impl::check_semi(std::string note) {
+bool parser_impl::check_semi(std::string note) {
   if (is_at_end()) {
     report_error(ec::unexpected_end_of_input, previous(), "Expected a ';'!");
+
+    return false;
   }
 
   if (current().is_not(kind::symbol_semicolon)) {
     report_error(ec::expected_semi, consume(), note);
+
+    return false;
   }
+
+  return true;
 }
 
-void parser_impl::report_error(ec code, core::token tok, std::string note) const {
-  m_report(std::make_unique<errors::token_error>(code,
-      tok,
-      note == "" ? std::nullopt : std::make_optional(note)));
+std::nullptr_t parser_impl::report_error(ec code, core::token tok, std::string note) const {
+  if (!m_panicking) {
+    m_report(std::make_unique<errors::token_error>(code,
+        tok,
+        note == "" ? std::nullopt : std::make_optional(note)));
 
-  throw error_sentinel{};
+    m_panicking = true;
+  }
+
+  return nullptr;
 }
 
-void parser_impl::report_error(ec code, node_ptr node, std::string note) const {
-  m_report(std::make_unique<errors::ast_error>(code,
-      std::move(node),
-      note == "" ? std::nullopt : std::make_optional(note)));
+std::nullptr_t parser_impl::report_error(ec code, node_ptr node, std::string note) const {
+  if (!m_panicking) {
+    m_report(std::make_unique<errors::ast_error>(code,
+        *node,
+        note == "" ? std::nullopt : std::make_optional(note)));
+
+    m_panicking = true;
+  }
 
-  throw error_sentinel{};
+  return nullptr;
 }
 
-void parser_impl::report_nothrow(ec code, core::token tok, std::string note) const noexcept {
+void parser_impl::report_and_continue(ec code, core::token tok, std::string note) const noexcept {
   m_report(std::make_unique<errors::token_error>(code,
       tok,
       note == "" ? std::nullopt : std::make_optional(note)));
 }
 
-void parser_impl::report_nothrow(ec code, node_ptr node, std::string note) const noexcept {
+void parser_impl::report_and_continue(ec code, node_ptr node, std::string note) const noexcept {
   m_report(std::make_unique<errors::ast_error>(code,
-      std::move(node),
+      *node,
       note == "" ? std::nullopt : std::make_optional(note)));
 }
 
 expr_ptr parser_impl::finish_call(expr_ptr callee) {
-  consume();
+  auto open = consume();
   std::vector<expr_ptr> args;
 
   while (!is_at_end() && current().is_not(kind::symbol_closeparen)) {
     args.emplace_back(expression());
 
+    if (m_panicking) {
+      return nullptr;
+    }
+
     if (current().is_one_of(kind::symbol_comma, kind::symbol_closeparen)) {
       if (current().is(kind::symbol_comma)) {
         consume();
@@ -313,14 +424,18 @@ expr_ptr parser_impl::finish_call(expr_ptr callee) {
     }
 
     // if previous two failed, and this catches theres an issue
-    report_error(ec::expected_comma, consume(), "Expected a ',' or a ')' after argument!");
+    return report_error(ec::expected_comma, consume(), "Expected a ',' or a ')' after argument!");
+  }
+
+  if (is_at_end()) {
+    return report_error(ec::unexpected_end_of_input, open, "Expected a ')' to close the call.");
   }
 
   auto close = consume();
 
-  return std::make_unique<ast::call>(srcinfo::from(callee->info(), close.info()),
+  return m_nodes.make<ast::call>(srcinfo::from(callee->info(), close.info()),
       std::move(callee),
-      std::move(args));
+      m_nodes.make_span(std::move(args)));
 }
 
 expr_ptr parser_impl::grouping() {
@@ -331,13 +446,17 @@ expr_ptr parser_impl::grouping() {
     // easy for the rest of the parser
     auto expr = expression();
 
+    if (m_panicking) {
+      return nullptr;
+    }
+
     if (current().is_not(kind::symbol_closeparen)) {
-      auto unexpected = expression();
+      [[maybe_unused]] auto unexpected = expression();
 
-      report_error(ec::unclosed_paren, begin, "Did you forget a ')'? ");
+      return report_error(ec::unclosed_paren, begin, "Did you forget a ')'? ");
     }
 
-    auto end = consume();
+    consume();
 
     return expr;
   }
@@ -346,12 +465,12 @@ expr_ptr parser_impl::grouping() {
     return block();
   }
 
-  report_error(ec::expected_expression, consume());
+  return report_error(ec::expected_expression, consume());
 }
 
 expr_ptr parser_impl::block() {
   if (current().is_not(kind::symbol_openbrace)) {
-    report_error(ec::expected_opening_brace, consume());
+    return report_error(ec::expected_opening_brace, consume());
   }
 
   auto start = consume();
@@ -359,63 +478,65 @@ expr_ptr parser_impl::block() {
   std::vector<stmt_ptr> statements;
 
   while (!is_at_end() && current().is_not(kind::symbol_closebrace)) {
-    try {
-      statements.emplace_back(statement());
-    } catch (error_sentinel &) {
-      synchronize();
+    auto stmt = statement();
+
+    if (m_panicking) {
+      recover();
+
+      continue;
     }
+
+    statements.emplace_back(std::move(stmt));
+  }
+
+  if (is_at_end()) {
+    return report_error(ec::unexpected_end_of_input, start, "Expected a '}' to close the block.");
   }
 
   auto close = consume();
 
-  return std::make_unique<ast::block>(srcinfo::from(start.info(), close.info()),
-      std::move(statements),
-      std::make_unique<ast::implied>(srcinfo::from(start.info(), 1)));
+  return m_nodes.make<ast::block>(srcinfo::from(start.info(), close.info()),
+      m_nodes.make_span(std::move(statements)),
+      m_nodes.make<ast::implied>(srcinfo::from(start.info(), 1)));
 }
 
 expr_ptr parser_impl::primary() {
   if (current().is(kind::literal_number)) {
     auto tok = consume();
-    auto number = 0;
 
-    auto [_, error_code] = std::from_chars(tok.raw().begin(), tok.raw().end(), number);
+    // the lexer already decoded the value, all that's left is checking it fits the type
+    if (tok.integer() > max_value(tok.suffix())) {
+      // unsuffixed literals get the default note about 'i32'
+      auto note = (tok.suffix() == suffix::none)
+                      ? std::string{}
+                      : fmt::format("The literal is of type '{}' and must fit inside that.",
+                          util::string_from_suffix(tok.suffix()));
 
-    if (error_code == std::errc::invalid_argument) {
-      throw std::invalid_argument(
-          fmt::format("bad argument to std::from_chars. token being parsed: '{}'", tok.raw()));
+      return report_error(ec::number_literal_too_large, std::move(tok), std::move(note));
     }
 
-    if (error_code == std::errc::result_out_of_range) {
-      report_error(ec::number_literal_too_large, std::move(tok));
-    }
-
-    return std::make_unique<ast::int_literal>(tok.info(), number);
+    return m_nodes.make<ast::int_literal>(tok.info(), tok.integer(), tok.suffix());
   }
 
   if (current().is(kind::literal_float)) {
     auto tok = consume();
 
-    try {
-      // std::from_chars on libstdc++ doesn't support floats/doubles
-      auto number = std::stof(std::string{tok.raw()});
-
-      return std::make_unique<ast::float_literal>(tok.info(), number);
-    } // stof can throw on a non-integer string
-    catch (std::invalid_argument &) {
-      throw std::invalid_argument(fmt::format("bad argument to std::stof. tok: '{}'", tok.raw()));
-    } // stof can throw if the string doesn't fit
-    catch (std::out_of_range &) {
-      report_error(ec::number_literal_too_large,
+    if (std::isinf(tok.floating())) {
+      auto type = (tok.suffix() == suffix::f64) ? "f64" : "f32";
+
+      return report_error(ec::number_literal_too_large,
           std::move(tok),
-          "float literals are of type 'f32' and must fit inside that");
+          fmt::format("float literals are of type '{}' and must fit inside that", type));
     }
+
+    return m_nodes.make<ast::float_literal>(tok.info(), tok.floating(), tok.suffix());
   }
 
   if (current().is(kind::literal_bool)) {
     auto tok = consume();
     auto value = tok.raw() == "true";
 
-    return std::make_unique<ast::bool_literal>(tok.info(), value);
+    return m_nodes.make<ast::bool_literal>(tok.info(), value);
   }
 
   if (current().is(kind::literal_char)) {
@@ -427,23 +548,23 @@ expr_ptr parser_impl::primary() {
     ss >> c;
 
     if (ss.rdbuf()->in_avail() != 0) {
-      report_error(ec::invalid_char_literal, std::move(tok));
+      return report_error(ec::invalid_char_literal, std::move(tok));
     }
 
-    return std::make_unique<ast::char_literal>(tok.info(), c);
+    return m_nodes.make<ast::char_literal>(tok.info(), c);
   }
 
   if (current().is(kind::literal_string)) {
     auto tok = consume();
     auto str = tok.raw().substr(1, tok.raw().size() - 2);
 
-    return std::make_unique<ast::string_literal>(tok.info(), std::move(str));
+    return m_nodes.make<ast::string_literal>(tok.info(), std::move(str));
   }
 
   if (current().is(kind::identifier)) {
     auto tok = consume();
 
-    return std::make_unique<ast::identifier>(tok.info(), std::string{tok.raw()});
+    return m_nodes.make<ast::identifier>(tok.info(), name_of(tok));
   }
 
   return grouping();
@@ -452,10 +573,18 @@ expr_ptr parser_impl::primary() {
 expr_ptr parser_impl::call() {
   auto expr = primary();
 
+  if (m_panicking) {
+    return nullptr;
+  }
+
   while (!is_at_end()) {
     if (current().is(kind::symbol_openparen)) {
       expr = finish_call(std::move(expr));
 
+      if (m_panicking) {
+        return nullptr;
+      }
+
       continue;
     }
 
@@ -464,43 +593,49 @@ expr_ptr parser_impl::call() {
 
       auto index = expression();
 
+      if (m_panicking) {
+        return nullptr;
+      }
+
       if (is_at_end()) {
-        report_error(ec::unexpected_end_of_input, previous(), "Expected a closing ']'.");
+        return report_error(ec::unexpected_end_of_input, previous(), "Expected a closing ']'.");
       }
 
       if (current().is(kind::symbol_closebracket)) {
         auto close = consume();
 
-        expr = std::make_unique<ast::index>(srcinfo::from(expr->info(), close.info()),
+        expr = m_nodes.make<ast::index>(srcinfo::from(expr->info(), close.info()),
             std::move(expr),
             std::move(index));
 
         continue;
       }
 
-      report_error(ec::expected_closing_bracket,
+      return report_error(ec::expected_closing_bracket,
           consume(),
           "Expected a ']' to finish index access expression");
     }
 
     if (current().is(kind::symbol_dot)) {
-      auto dot = consume();
+      consume();
 
       if (is_at_end()) {
-        report_error(ec::unexpected_end_of_input,
+        return report_error(ec::unexpected_end_of_input,
             previous(),
             "Expected a field or method name, but got EOF.");
       }
 
       if (current().is_not(kind::identifier)) {
-        report_error(ec::unexpected_tok, consume(), "Expected a field name or a method name.");
+        return report_error(ec::unexpected_tok,
+            consume(),
+            "Expected a field name or a method name.");
       }
 
       auto id = consume();
 
-      expr = std::make_unique<ast::field_access>(srcinfo::from(expr->info(), id.info()),
+      expr = m_nodes.make<ast::field_access>(srcinfo::from(expr->info(), id.info()),
           std::move(expr),
-          std::string{id.raw()});
+          name_of(id));
 
       continue;
     }
@@ -511,139 +646,122 @@ expr_ptr parser_impl::call() {
   return expr;
 }
 
-expr_ptr parser_impl::unary() {
-  return parse_unary([this]() { return unary(); },
-      [this]() { return call(); },
-      kind::symbol_tilde,
-      kind::symbol_star,
-      kind::symbol_pound,
-      kind::symbol_at,
-      kind::symbol_hyphen,
-      kind::keyword_clone);
-}
-
-expr_ptr parser_impl::multiplication() {
-  return parse_binary([this]() { return unary(); },
-      kind::symbol_star,
-      kind::symbol_forwardslash,
-      kind::symbol_percent);
-}
+expr_ptr parser_impl::if_then() {
+  auto keyword_if = consume();
+  auto condition = expression(prec_if);
 
-expr_ptr parser_impl::addition() {
-  return parse_binary([this]() { return multiplication(); },
-      kind::symbol_plus,
-      kind::symbol_hyphen);
-}
+  if (m_panicking) {
+    return nullptr;
+  }
 
-expr_ptr parser_impl::bitshift() {
-  return parse_binary([this]() { return addition(); }, kind::symbol_gtgt, kind::symbol_ltlt);
-}
+  // if `then` was present, if and else both need to be parsed slightly differently
+  auto is_then = current().is(kind::keyword_then);
 
-expr_ptr parser_impl::bitwise_and() {
-  return parse_binary([this]() { return bitshift(); }, kind::symbol_pound);
-}
+  // if `then`, it needs to be consumed and an expression parsed. (',' evaluates lhs and
+  // returns rhs) if not, return a block
+  auto true_clause = (is_then) ? consume(), expression(prec_if) : block();
 
-expr_ptr parser_impl::bitwise_xor() {
-  return parse_binary([this]() { return bitwise_and(); }, kind::symbol_caret);
-}
-
-expr_ptr parser_impl::bitwise_or() {
-  return parse_binary([this]() { return bitwise_xor(); }, kind::symbol_pipe);
-}
+  if (m_panicking) {
+    return nullptr;
+  }
 
-expr_ptr parser_impl::relational() {
-  return parse_binary([this]() { return bitwise_or(); },
-      kind::symbol_gt,
-      kind::symbol_geq,
-      kind::symbol_lt,
-      kind::symbol_leq);
-}
+  if (current().is(kind::keyword_else)) {
+    consume();
+    auto false_clause = (is_then) ? expression(prec_if) : block();
 
-expr_ptr parser_impl::equality() {
-  return parse_binary([this]() { return relational(); },
-      kind::symbol_equalequal,
-      kind::symbol_bangequal);
-}
+    if (m_panicking) {
+      return nullptr;
+    }
 
-expr_ptr parser_impl::logical_not() {
-  return parse_unary([this]() { return logical_not(); },
-      [this]() { return equality(); },
-      kind::keyword_not);
-}
+    return m_nodes.make<ast::if_else>(srcinfo::from(keyword_if.info(), false_clause->info()),
+        std::move(condition),
+        std::move(true_clause),
+        std::move(false_clause));
+  }
 
-expr_ptr parser_impl::logical_and() {
-  return parse_binary([this]() { return logical_not(); }, kind::keyword_and);
-}
+  if (is_then) {
+    return report_error(ec::expected_else_after_then,
+        m_nodes.make<ast::if_else>(srcinfo::from(keyword_if.info(), true_clause->info()),
+            std::move(condition),
+            std::move(true_clause),
+            std::nullopt));
+  }
 
-expr_ptr parser_impl::logical_xor() {
-  return parse_binary([this]() { return logical_and(); }, kind::keyword_xor);
+  return m_nodes.make<ast::if_else>(srcinfo::from(keyword_if.info(), true_clause->info()),
+      std::move(condition),
+      std::move(true_clause),
+      std::nullopt);
 }
 
-expr_ptr parser_impl::logical_or() {
-  return parse_binary([this]() { return logical_xor(); }, kind::keyword_or);
-}
+expr_ptr parser_impl::expression(precedence min) {
+  // prefixes that bind looser than `min` can't appear here, e.g. the `not` in `a == not b`.
+  // those fall through to `call()` and get reported as not being an expression
+  auto prefix = is_at_end() ? prec_none : prefix_precedence(current().type());
+  expr_ptr expr;
+
+  if (prefix < min) {
+    prefix = prec_none;
+    expr = call();
+  } else if (prefix == prec_if) {
+    expr = if_then();
+  } else {
+    auto op = consume();
+    auto rhs = expression(prefix);
 
-expr_ptr parser_impl::if_then() {
-  if (current().is(kind::keyword_if)) {
-    auto keyword_if = consume();
-    auto condition = if_then();
+    if (m_panicking) {
+      return nullptr;
+    }
 
-    // if `then` was present, if and else both need to be parsed slightly differently
-    auto is_then = current().is(kind::keyword_then);
+    expr = m_nodes.make<ast::unary>(srcinfo::from(op.info(), rhs->info()),
+        op.type(),
+        std::move(rhs));
+  }
 
-    // if `then`, it needs to be consumed and an expression parsed. (',' evaluates lhs and
-    // returns rhs) if not, return a block
-    auto true_clause = (is_then) ? consume(), if_then() : block();
+  // an operand already took every operator binding more tightly than the operator before
+  // it, so only looser ones can follow. that's only ever not the case for an `if` that ends
+  // in a block, which doesn't take anything after the block. this keeps `a = if b {} + c`
+  // (and `if a {} else {} + b`) an error like it would be with one function per level
+  if (m_panicking) {
+    return nullptr;
+  }
 
-    if (current().is(kind::keyword_else)) {
-      consume();
-      auto false_clause = (is_then) ? if_then() : block();
+  auto ceiling = (prefix == prec_none) ? prec_unary : prefix;
 
-      return std::make_unique<ast::if_else>(srcinfo::from(keyword_if.info(), false_clause->info()),
-          std::move(condition),
-          std::move(true_clause),
-          std::move(false_clause));
-    }
+  while (!is_at_end()) {
+    auto level = infix_precedence(current().type());
 
-    if (is_then) {
-      report_error(ec::expected_else_after_then,
-          std::make_unique<ast::if_else>(srcinfo::from(keyword_if.info(), true_clause->info()),
-              std::move(condition),
-              std::move(true_clause),
-              std::nullopt));
+    if (level < min || level >= ceiling) {
+      break;
     }
 
-    return std::make_unique<ast::if_else>(srcinfo::from(keyword_if.info(), true_clause->info()),
-        std::move(condition),
-        std::move(true_clause),
-        std::nullopt);
-  }
-
-  return logical_or();
-}
+    auto op = consume();
 
-expr_ptr parser_impl::assignment() {
-  auto expr = if_then();
+    // assignment is right-associative, everything else is left-associative
+    auto rhs = expression(
+        (level == prec_assignment) ? level : static_cast<precedence>(level + 1));
 
-  while (!is_at_end() && current().is_assignment()) {
-    auto op = consume();
-    auto rhs = assignment();
+    if (m_panicking) {
+      return nullptr;
+    }
 
-    expr = std::make_unique<ast::binary>(srcinfo::from(expr->info(), rhs->info()),
+    expr = m_nodes.make<ast::binary>(srcinfo::from(expr->info(), rhs->info()),
         op.type(),
         std::move(expr),
         std::move(rhs));
+
+    ceiling = static_cast<precedence>(level + 1);
   }
 
   return expr;
 }
 
-expr_ptr parser_impl::expression() { return assignment(); }
+expr_ptr parser_impl::expression() { return expression(prec_assignment); }
 
 type_ptr parser_impl::read_type() {
   using mods = ast::type::type_modifiers;
 
-  const auto &begin = current();
+  // this needs to be a copy, the stream only keeps a few tokens around
+  auto begin = current();
   std::deque<ast::type::type_modifiers> modifs;
 
   if (current().is(kind::symbol_pound)) {
@@ -670,10 +788,12 @@ type_ptr parser_impl::read_type() {
     }
 
     if (current().is(kind::symbol_openbracket)) {
-      auto open = consume();
+      consume();
 
       if (current().is_not(kind::symbol_closebracket)) {
-        report_error(ec::unexpected_tok, consume(), "Expected a ']' to match opening '['");
+        return report_error(ec::unexpected_tok,
+            consume(),
+            "Expected a ']' to match opening '['");
       }
 
       consume();
@@ -686,7 +806,7 @@ type_ptr parser_impl::read_type() {
     auto id = consume();
 
     if (id.raw() == "bool") {
-      return std::make_unique<ast::type>(srcinfo::from(begin.info(), id.info()),
+      return m_nodes.make<ast::type>(srcinfo::from(begin.info(), id.info()),
           std::move(modifs),
           ast::type::type_base::boolean,
           1);
@@ -710,12 +830,12 @@ type_ptr parser_impl::read_type() {
         width_int = 64;
       } else {
         // i12 is a perfectly valid struct name, no matter how much I may dislike it
-        return std::make_unique<ast::type>(srcinfo::from(begin.info(), id.info()),
+        return m_nodes.make<ast::type>(srcinfo::from(begin.info(), id.info()),
             std::move(modifs),
-            std::string{id.raw()});
+            id.symbol());
       }
 
-      return std::make_unique<ast::type>(srcinfo::from(begin.info(), id.info()),
+      return m_nodes.make<ast::type>(srcinfo::from(begin.info(), id.info()),
           std::move(modifs),
           type,
           width_int);
@@ -731,28 +851,28 @@ type_ptr parser_impl::read_type() {
         width_int = 64;
       } else {
         // f12 is a perfectly valid struct name, no matter how much I may dislike it
-        return std::make_unique<ast::type>(srcinfo::from(begin.info(), id.info()),
+        return m_nodes.make<ast::type>(srcinfo::from(begin.info(), id.info()),
             std::move(modifs),
-            std::string{id.raw()});
+            id.symbol());
       }
 
-      return std::make_unique<ast::type>(srcinfo::from(begin.info(), id.info()),
+      return m_nodes.make<ast::type>(srcinfo::from(begin.info(), id.info()),
           std::move(modifs),
           ast::type::type_base::floating_point,
           width_int);
     }
 
-    return std::make_unique<ast::type>(srcinfo::from(begin.info(), id.info()),
+    return m_nodes.make<ast::type>(srcinfo::from(begin.info(), id.info()),
         std::move(modifs),
-        std::string{id.raw()});
+        id.symbol());
   }
 
-  report_error(ec::expected_type, current(), "An identifier, *, *mut or [] was expected.");
+  return report_error(ec::expected_type, current(), "An identifier, *, *mut or [] was expected.");
 }
 
 type_ptr parser_impl::type_with_colon() {
   if (current().is_not(kind::symbol_colon)) {
-    report_error(ec::unexpected_tok, consume(), "Expected a ':' before type!");
+    return report_error(ec::unexpected_tok, consume(), "Expected a ':' before type!");
   }
 
   consume();
@@ -766,7 +886,7 @@ stmt_ptr parser_impl::variable() {
   auto begin = consume();
 
   if (current().is_not(kind::identifier)) {
-    report_error(ec::expected_identifier,
+    return report_error(ec::expected_identifier,
         consume(),
         fmt::format("Expected an identifier after keyword '{}'.", begin.raw()));
   }
@@ -776,30 +896,38 @@ stmt_ptr parser_impl::variable() {
   // type has to be explicitly the base
   type_ptr var_type = (current().is(kind::symbol_colon))
                           ? type_with_colon()
-                          : std::make_unique<ast::implied>(id.info());
+                          : m_nodes.make<ast::implied>(id.info());
+
+  if (m_panicking) {
+    return nullptr;
+  }
 
   if (current().is_not(kind::symbol_equal)) {
-    report_error(ec::unexpected_tok, consume(), "Expected an '=' for variable initializer!");
+    return report_error(ec::unexpected_tok,
+        consume(),
+        "Expected an '=' for variable initializer!");
   }
 
   consume();
 
   auto expr = expression();
 
-  check_semi("Expected a ';' after initializer!");
+  if (m_panicking || !check_semi("Expected a ';' after initializer!")) {
+    return nullptr;
+  }
 
   auto semi = consume();
 
   if (begin.is(kind::keyword_let)) {
-    return std::make_unique<ast::let>(srcinfo::from(begin.info(), semi.info()),
+    return m_nodes.make<ast::let>(srcinfo::from(begin.info(), semi.info()),
         std::move(expr),
         std::move(var_type),
-        std::string{id.raw()});
+        name_of(id));
   } else {
-    return std::make_unique<ast::mut>(srcinfo::from(begin.info(), semi.info()),
+    return m_nodes.make<ast::mut>(srcinfo::from(begin.info(), semi.info()),
         std::move(expr),
         std::move(var_type),
-        std::string{id.raw()});
+        name_of(id));
   }
 }
 
@@ -809,15 +937,19 @@ stmt_ptr parser_impl::ret() {
 
   if (current().is_not(kind::symbol_semicolon)) {
     expr = expression();
+
+    if (m_panicking) {
+      return nullptr;
+    }
   }
 
   if (current().is_not(kind::symbol_semicolon)) {
-    report_error(ec::expected_semi, consume());
+    return report_error(ec::expected_semi, consume());
   }
 
   auto semi = consume();
 
-  return std::make_unique<ast::ret>(srcinfo::from(ret.info(), semi.info()), std::move(expr));
+  return m_nodes.make<ast::ret>(srcinfo::from(ret.info(), semi.info()), std::move(expr));
 }
 
 stmt_ptr parser_impl::loop() {
@@ -826,14 +958,27 @@ stmt_ptr parser_impl::loop() {
   if (begin.is(kind::keyword_loop)) {
     auto body = expression();
 
-    return std::make_unique<ast::loop>(srcinfo::from(begin.info(), body->info()),
+    if (m_panicking) {
+      return nullptr;
+    }
+
+    return m_nodes.make<ast::loop>(srcinfo::from(begin.info(), body->info()),
         std::nullopt,
         std::move(body));
   } else {
     auto condition = expression();
+
+    if (m_panicking) {
+      return nullptr;
+    }
+
     auto body = expression();
 
-    return std::make_unique<ast::loop>(srcinfo::from(begin.info(), body->info()),
+    if (m_panicking) {
+      return nullptr;
+    }
+
+    return m_nodes.make<ast::loop>(srcinfo::from(begin.info(), body->info()),
         std::move(condition),
         std::move(body));
   }
@@ -846,19 +991,23 @@ stmt_ptr parser_impl::break_continue() { return nullptr; }
 stmt_ptr parser_impl::expr_statement() {
   auto expr = expression();
 
+  if (m_panicking) {
+    return nullptr;
+  }
+
   if (current().is(kind::symbol_semicolon)) {
     auto semi = consume();
 
-    return std::make_unique<ast::expression_statement>(srcinfo::from(expr->info(), semi.info()),
+    return m_nodes.make<ast::expression_statement>(srcinfo::from(expr->info(), semi.info()),
         std::move(expr));
   }
 
   // expressions w/ blocks don't need semis
   if (previous().is(kind::symbol_closebrace)) {
-    return std::make_unique<ast::expression_statement>(expr->info(), std::move(expr));
+    return m_nodes.make<ast::expression_statement>(expr->info(), std::move(expr));
   }
 
-  report_error(ec::expected_semi, current(), "Expected a ';' after the expression");
+  return report_error(ec::expected_semi, current(), "Expected a ';' after the expression");
 }
 
 stmt_ptr parser_impl::statement() {
@@ -891,34 +1040,42 @@ decl_ptr parser_impl::module_decl() {
   auto begin = consume();
 
   if (current().is_not(kind::identifier)) {
-    report_error(ec::expected_identifier, consume(), "Expected a module name!");
+    return report_error(ec::expected_identifier, consume(), "Expected a module name!");
   }
 
   auto name = consume();
 
   if (is_builtin(name)) {
-    report_nothrow(ec::unexpected_builtin,
+    report_and_continue(ec::unexpected_builtin,
         name,
         "Expected a module name, got a reserved builtin name!");
   }
 
-  check_semi("Expected a ';' after initializer!");
+  if (!check_semi("Expected a ';' after initializer!")) {
+    return nullptr;
+  }
 
   auto semi = consume();
 
-  return std::make_unique<ast::module_decl>(srcinfo::from(begin.info(), semi.info()),
-      std::string{name.raw()});
+  return m_nodes.make<ast::module_decl>(srcinfo::from(begin.info(), semi.info()),
+      name_of(name));
 }
 
 decl_ptr parser_impl::export_decl() {
   auto begin = consume();
   auto decl = declaration();
 
+  if (m_panicking) {
+    return nullptr;
+  }
+
   if (decl->is(ast::kind::declaration_export)) {
-    report_error(ec::cannot_export_export, std::move(decl), "Cannot export an export declaration!");
+    return report_error(ec::cannot_export_export,
+        std::move(decl),
+        "Cannot export an export declaration!");
   }
 
-  return std::make_unique<ast::export_decl>(srcinfo::from(begin.info(), decl->info()),
+  return m_nodes.make<ast::export_decl>(srcinfo::from(begin.info(), decl->info()),
       std::move(decl));
 }
 
@@ -926,7 +1083,7 @@ decl_ptr parser_impl::const_static() {
   auto begin = consume();
 
   if (current().is_not(kind::identifier)) {
-    report_error(ec::expected_identifier,
+    return report_error(ec::expected_identifier,
         consume(),
         fmt::format("Expected an identifier after keyword '{}'!", begin.raw()));
   }
@@ -934,7 +1091,7 @@ decl_ptr parser_impl::const_static() {
   auto id = consume();
 
   if (is_builtin(id)) {
-    report_nothrow(ec::unexpected_builtin,
+    report_and_continue(ec::unexpected_builtin,
         id,
         "Expected a variable name, got a reserved builtin name!");
   }
@@ -942,28 +1099,36 @@ decl_ptr parser_impl::const_static() {
   // type has to be explicitly the base
   type_ptr var_type = (current().is(kind::symbol_colon))
                           ? type_with_colon()
-                          : std::make_unique<ast::implied>(id.info());
+                          : m_nodes.make<ast::implied>(id.info());
+
+  if (m_panicking) {
+    return nullptr;
+  }
 
   if (current().is_not(kind::symbol_equal)) {
-    report_error(ec::unexpected_tok, consume(), "Expected an '=' for variable initializer!");
+    return report_error(ec::unexpected_tok,
+        consume(),
+        "Expected an '=' for variable initializer!");
   }
 
   consume();
 
   auto expr = expression();
 
-  check_semi("Expected a ';' after initializer!");
+  if (m_panicking || !check_semi("Expected a ';' after initializer!")) {
+    return nullptr;
+  }
 
   auto semi = consume();
 
   if (begin.is(kind::keyword_const)) {
-    return std::make_unique<ast::const_decl>(srcinfo::from(begin.info(), semi.info()),
-        std::string{id.raw()},
+    return m_nodes.make<ast::const_decl>(srcinfo::from(begin.info(), semi.info()),
+        name_of(id),
         std::move(expr),
         std::move(var_type));
   } else {
-    return std::make_unique<ast::static_decl>(srcinfo::from(begin.info(), semi.info()),
-        std::string{id.raw()},
+    return m_nodes.make<ast::static_decl>(srcinfo::from(begin.info(), semi.info()),
+        name_of(id),
         std::move(expr),
         std::move(var_type));
   }
@@ -973,39 +1138,45 @@ decl_ptr parser_impl::type_decl() {
   auto begin = consume();
 
   if (current().is_not(kind::identifier)) {
-    report_error(ec::expected_identifier, consume(), "Expected an identifier for the type alias!");
+    return report_error(ec::expected_identifier,
+        consume(),
+        "Expected an identifier for the type alias!");
   }
 
   auto name = consume();
 
   if (is_builtin(name)) {
-    report_nothrow(ec::unexpected_builtin,
+    report_and_continue(ec::unexpected_builtin,
         name,
         "Expected a type alias name, got a reserved builtin name!");
   }
 
   if (current().is_not(kind::symbol_equal)) {
-    report_error(ec::unexpected_tok, consume(), "Expected an '=' and a type for type alias!");
+    return report_error(ec::unexpected_tok,
+        consume(),
+        "Expected an '=' and a type for type alias!");
   }
 
   consume();
 
   auto type = type_without_colon();
 
-  check_semi("Expected a ';' after type alias!");
+  if (m_panicking || !check_semi("Expected a ';' after type alias!")) {
+    return nullptr;
+  }
 
   auto semi = consume();
 
-  return std::make_unique<ast::type_decl>(srcinfo::from(begin.info(), semi.info()),
+  return m_nodes.make<ast::type_decl>(srcinfo::from(begin.info(), semi.info()),
       std::move(type),
-      std::string{name.raw()});
+      name_of(name));
 }
 
 decl_ptr parser_impl::fn() {
   auto begin = consume();
 
   if (current().is_not(kind::identifier)) {
-    report_error(ec::expected_identifier,
+    return report_error(ec::expected_identifier,
         consume(),
         "Expected an identifier for the function name!");
   }
@@ -1013,11 +1184,15 @@ decl_ptr parser_impl::fn() {
   auto name = consume();
 
   if (is_builtin(name)) {
-    report_nothrow(ec::unexpected_builtin, name, "Expected an fn name, got reserved builtin name!");
+    report_and_continue(ec::unexpected_builtin,
+        name,
+        "Expected an fn name, got reserved builtin name!");
   }
 
   if (current().is_not(kind::symbol_openparen)) {
-    report_error(ec::unexpected_tok, consume(), "Expected a '(' to begin fn argument list!");
+    return report_error(ec::unexpected_tok,
+        consume(),
+        "Expected a '(' to begin fn argument list!");
   }
 
   consume();
@@ -1026,24 +1201,30 @@ decl_ptr parser_impl::fn() {
 
   while (current().is_not(kind::symbol_closeparen)) {
     if (current().is_not(kind::identifier)) {
-      report_error(ec::expected_identifier, consume(), "Expected an argument name!");
+      return report_error(ec::expected_identifier, consume(), "Expected an argument name!");
     }
 
     auto arg_name = consume();
 
     if (current().is_not(kind::symbol_colon)) {
-      report_error(ec::unexpected_tok, consume(), "Expected a ':' for argument type!");
+      return report_error(ec::unexpected_tok, consume(), "Expected a ':' for argument type!");
     }
 
     auto arg_type = type_with_colon();
 
+    if (m_panicking) {
+      return nullptr;
+    }
+
     args.emplace_back(srcinfo::from(arg_name.info(), arg_type->info()),
-        std::string{arg_name.raw()},
+        name_of(arg_name),
         std::move(arg_type));
 
     if (current().is_not(kind::symbol_closeparen)) {
       if (current().is_not(kind::symbol_comma)) {
-        report_error(ec::expected_comma, consume(), "Expected a comma between arguments!");
+        return report_error(ec::expected_comma,
+            consume(),
+            "Expected a comma between arguments!");
       }
 
       consume();
@@ -1054,13 +1235,40 @@ decl_ptr parser_impl::fn() {
 
   auto return_type = (current().is(kind::symbol_colon))
                          ? type_with_colon()
-                         : std::make_unique<ast::void_type>(previous().info());
+                         : m_nodes.make<ast::void_type>(previous().info());
+
+  if (m_panicking) {
+    return nullptr;
+  }
+
+  if (m_skim && current().is(kind::symbol_openbrace)) {
+    auto first = m_toks.position();
+
+    // nothing inside a body starts with `fn`, running into one means the body was never
+    // closed. stopping there keeps the declarations after it, the missing '}' is reported
+    // once the body is parsed, like every other error in it
+    m_toks.skip_block({kind::keyword_fn});
+
+    // the body is parsed later from these tokens, see `skimmed_program::body`
+    auto tokens = ast::token_range{static_cast<std::uint32_t>(first),
+        static_cast<std::uint32_t>(m_toks.position())};
+
+    return m_nodes.make<ast::fn>(srcinfo::from(begin.info(), previous().info()),
+        name_of(name),
+        m_nodes.make_span(std::move(args)),
+        std::move(return_type),
+        tokens);
+  }
 
   auto body = block();
 
-  return std::make_unique<ast::fn>(srcinfo::from(begin.info(), body->info()),
-      std::string{name.raw()},
-      std::move(args),
+  if (m_panicking) {
+    return nullptr;
+  }
+
+  return m_nodes.make<ast::fn>(srcinfo::from(begin.info(), body->info()),
+      name_of(name),
+      m_nodes.make_span(std::move(args)),
       std::move(return_type),
       std::move(body));
 }
@@ -1081,40 +1289,102 @@ decl_ptr parser_impl::declaration() {
     case kind::keyword_type:
       return type_decl();
     default:
-      report_error(ec::expected_declaration, consume());
+      return report_error(ec::expected_declaration, consume());
   }
 }
 
-ast::program parser_impl::parse() {
+ast::list<decl_ptr> parser_impl::parse() {
   std::vector<decl_ptr> decls;
   auto has_module = false;
 
   while (!is_at_end()) {
     // util::debug_print(expression());
-    try {
-      auto decl = declaration();
-
-      if (decl->is(ast::kind::declaration_module)) {
-        if (has_module) {
-          report_error(ec::duplicate_module,
-              std::move(decl),
-              "You can only have one module declaration per file.");
-        }
+    auto decl = declaration();
 
-        has_module = true;
+    if (!m_panicking && decl->is(ast::kind::declaration_module)) {
+      if (has_module) {
+        report_error(ec::duplicate_module,
+            std::move(decl),
+            "You can only have one module declaration per file.");
       }
 
-      decls.emplace_back(std::move(decl));
-    } catch (error_sentinel &) {
-      synchronize();
+      has_module = true;
+    }
+
+    if (m_panicking) {
+      recover();
+
+      continue;
     }
+
+    decls.emplace_back(std::move(decl));
+  }
+
+  return m_nodes.make_span(std::move(decls));
+}
+
+ast::program core::parse(lexer source, register_fn report) {
+  return parse(token_stream(std::move(source)), std::move(report));
+}
+
+ast::program core::parse(token_stream tokens, register_fn report) {
+  util::arena nodes;
+  parser_impl parser(std::move(tokens), std::move(report), nodes, false);
+
+  // the list has to be made before the arena is moved into the program
+  auto decls = parser.parse();
+
+  return ast::program(std::move(nodes), decls);
+}
+
+skimmed_program core::skim(token_buffer tokens, register_fn report) {
+  util::arena nodes;
+  parser_impl parser(token_stream(tokens, 0, tokens.size()), std::move(report), nodes, true);
+
+  // skimmed fns refer to tokens by index, moving the buffer doesn't invalidate them
+  auto decls = parser.parse();
+
+  return skimmed_program(std::move(tokens), ast::program(std::move(nodes), decls));
+}
+
+expr_ptr skimmed_program::body(ast::fn &fn, register_fn report) {
+  if (!fn.skimmed()) {
+    return expr_ptr(&fn.body());
+  }
+
+  // its errors were already reported the first time, parsing it again would just
+  // report them twice and put another set of nodes in the arena
+  if (fn.body_failed()) {
+    return nullptr;
   }
 
-  return ast::program(std::move(decls));
+  auto range = fn.body_tokens();
+  parser_impl parser(token_stream(m_tokens, range.begin, range.end),
+      std::move(report),
+      m_program.nodes(),
+      false);
+
+  auto body = parser.block();
+
+  if (body) {
+    fn.set_body(body);
+  } else {
+    fn.set_body_failed();
+  }
+
+  return body;
 }
 
-ast::program core::parse(std::vector<token> source, register_fn report) {
-  parser_impl parser(std::move(source), std::move(report));
+void skimmed_program::parse_bodies(register_fn report) {
+  for (auto &decl : m_program.decls()) {
+    auto *declared = decl.get();
+
+    if (declared->is(ast::kind::declaration_export)) {
+      declared = &static_cast<ast::export_decl *>(declared)->exported();
+    }
 
-  return parser.parse();
+    if (declared->is(ast::kind::declaration_fn)) {
+      (void)body(static_cast<ast::fn &>(*declared), report);
+    }
+  }
 }
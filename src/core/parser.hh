@@ -26,7 +26,9 @@
 
 #include "ast/ast.hh"
 #include "core/lexer.hh"
+#include "core/token_stream.hh"
 #include "errors/error.hh"
+#include "util/mixins.hh"
 #include <cstddef>
 #include <memory>
 #include <string_view>
@@ -35,11 +37,84 @@
 namespace cascade::core {
   /**
    * @brief Parses a program
-   * @param source List of tokens for a file
+   * @details Tokens are pulled out of @p source as the parser needs them, the
+   * whole file is never lexed up front
+   * @param source The lexer for a file
    * @param report The function that gets called on any errors
    * @return An AST
    */
-  ast::program parse(lexer::return_type source,
+  ast::program parse(lexer source, std::function<void(std::unique_ptr<errors::error>)> report);
+
+  /**
+   * @brief Parses a program
+   * @param tokens The tokens for a file, lazily lexed or not
+   * @param report The function that gets called on any errors
+   * @return An AST
+   */
+  ast::program parse(token_stream tokens,
+      std::function<void(std::unique_ptr<errors::error>)> report);
+
+  /**
+   * @brief A program where fn bodies are only parsed once something asks for them
+   * @details Made by `skim`. Holds onto the file's tokens so skipped bodies can be
+   * parsed later, the nodes for a body go into the program's own arena. Not thread-safe
+   */
+  class skimmed_program : util::noncopyable {
+    /**
+     * @brief The tokens the program was skimmed from, skimmed fns refer to ranges of
+     * them, so this has to outlive every `token_range` stored in `m_program`
+     */
+    token_buffer m_tokens;
+
+    /** @brief The program, bodies get filled in as they're parsed */
+    ast::program m_program;
+
+  public:
+    /**
+     * @brief Creates a skimmed program
+     * @param tokens The tokens the program was skimmed from
+     * @param prog The program, with skimmed fns referring to @p tokens
+     */
+    explicit skimmed_program(token_buffer tokens, ast::program prog)
+        : m_tokens(std::move(tokens))
+        , m_program(std::move(prog)) {}
+
+    /**
+     * @brief Returns the program
+     * @details Every signature is there, but fns whose body hasn't been asked
+     * for yet are `skimmed()`
+     */
+    [[nodiscard]] ast::program &program() { return m_program; }
+
+    /**
+     * @brief Returns the body of a fn, parsing it if it hasn't been yet
+     * @param fn A fn from this program
+     * @details A body is only ever parsed once. If the parser couldn't recover from
+     * an error in it, later calls return nothing without reporting anything
+     * @param report The function that gets called on any errors in the body
+     * @return The body, empty if the parser couldn't recover from an error in it
+     */
+    ast::ptr<ast::expression> body(ast::fn &fn,
+        std::function<void(std::unique_ptr<errors::error>)> report);
+
+    /**
+     * @brief Parses every body that hasn't been yet
+     * @details For a file without errors the program ends up the same as `parse` would make it
+     * @param report The function that gets called on any errors
+     */
+    void parse_bodies(std::function<void(std::unique_ptr<errors::error>)> report);
+  };
+
+  /**
+   * @brief Parses only the declarations of a program, skipping the body of every fn
+   * @details Bodies are skipped by matching braces without building any tokens,
+   * so skimming costs roughly one pass over the tokens. Errors inside a body,
+   * including a missing `}`, are only found once it's parsed
+   * @param tokens The tokens for a file
+   * @param report The function that gets called on any errors
+   * @return The skimmed program
+   */
+  skimmed_program skim(token_buffer tokens,
       std::function<void(std::unique_ptr<errors::error>)> report);
 } // namespace cascade::core
 
@@ -0,0 +1,193 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * core/token_stream.cc:
+ *   Implements the `token_stream` class
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "core/token_stream.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+using namespace cascade;
+using namespace core;
+
+token_stream::token_stream(lexer source) : m_lexer(std::move(source)) { fill(); }
+
+token_stream::token_stream(token_buffer tokens) : m_buffered(std::move(tokens)) {
+  m_buffered_end = m_buffered->size();
+
+  fill();
+}
+
+token_stream::token_stream(const token_buffer &tokens, std::size_t begin, std::size_t end)
+    : m_borrowed(&tokens)
+    , m_buffered_pos(begin)
+    , m_buffered_end(end) {
+  assert(begin <= end && end <= tokens.size() && "range is outside of the buffer");
+
+  fill();
+}
+
+const token_buffer &token_stream::buffer() const {
+  assert(!m_lexer && "stream is pulling from a lexer");
+
+  return (m_borrowed != nullptr) ? *m_borrowed : *m_buffered;
+}
+
+std::optional<token> token_stream::pull() {
+  if (m_lexer) {
+    return m_lexer->next();
+  }
+
+  if (m_buffered_pos < m_buffered_end) {
+    return buffer()[m_buffered_pos++];
+  }
+
+  return std::nullopt;
+}
+
+void token_stream::fill() {
+  // the slot being written to is always at least two behind the current token,
+  // so previous() stays valid
+  while (m_lexed <= m_index + 1) {
+    auto tok = pull();
+
+    if (!tok) {
+      return;
+    }
+
+    m_ring[m_lexed++ % ring_size] = std::move(tok);
+  }
+}
+
+const token &token_stream::at(std::size_t index) const {
+  assert(index < m_lexed && index + ring_size > m_lexed && "token is outside of the window");
+
+  return m_ring[index % ring_size].value();
+}
+
+const token &token_stream::previous() const {
+  assert(m_index > 0 && "previous() isn't being called before consume()");
+
+  return at(m_index - 1);
+}
+
+const token &token_stream::current() const { return at(m_index); }
+
+const token &token_stream::next() const { return at(m_index + 1); }
+
+bool token_stream::is_at_end() const { return m_index >= m_lexed; }
+
+bool token_stream::has_next() const { return m_index + 1 < m_lexed; }
+
+token token_stream::consume() {
+  assert(!is_at_end() && "consume() isn't being called at the end");
+
+  auto tok = current();
+
+  ++m_index;
+  fill();
+
+  return tok;
+}
+
+void token_stream::skip_until(std::initializer_list<token::kind> kinds) {
+  auto is_stop = [kinds](token::kind k) {
+    return std::find(kinds.begin(), kinds.end(), k) != kinds.end();
+  };
+
+  if (is_at_end() || is_stop(current().type())) {
+    return;
+  }
+
+  // when lexing lazily every token has to be built anyway
+  if (m_lexer) {
+    do {
+      consume();
+    } while (!is_at_end() && !is_stop(current().type()));
+
+    return;
+  }
+
+  if (has_next() && is_stop(next().type())) {
+    consume();
+
+    return;
+  }
+
+  // neither token in the window matched, the rest only exist in the buffer and
+  // can be checked by looking at their kinds
+  auto &kinds_left = buffer().kinds();
+  auto found = std::find_if(kinds_left.begin() + static_cast<std::ptrdiff_t>(m_buffered_pos),
+      kinds_left.begin() + static_cast<std::ptrdiff_t>(m_buffered_end),
+      is_stop);
+
+  jump_to(static_cast<std::size_t>(found - kinds_left.begin()));
+}
+
+std::size_t token_stream::position() const {
+  assert(!m_lexer && "stream is pulling from a lexer");
+
+  // everything in the window past the current token has been pulled out already
+  return m_buffered_pos - (m_lexed - m_index);
+}
+
+void token_stream::jump_to(std::size_t pos) {
+  assert(pos >= position() && pos <= m_buffered_end && "can only jump forward");
+
+  auto target = m_lexed + (pos - m_buffered_pos);
+
+  if (pos > m_buffered_pos) {
+    // jump ahead so the token right before the target is current. it has to be
+    // built so previous() keeps working once the target is consumed into
+    m_buffered_pos = pos - 1;
+    m_index = target - 1;
+    m_lexed = m_index;
+
+    fill();
+  }
+
+  while (m_index < target) {
+    consume();
+  }
+}
+
+void token_stream::skip_block(std::initializer_list<token::kind> stops) {
+  assert(!is_at_end() && current().is(token::kind::symbol_openbrace) && "not at a block");
+
+  auto &kinds = buffer().kinds();
+  auto depth = std::size_t{0};
+  auto i = position();
+
+  for (; i < m_buffered_end; ++i) {
+    if (kinds[i] == token::kind::symbol_openbrace) {
+      ++depth;
+    } else if (kinds[i] == token::kind::symbol_closebrace && --depth == 0) {
+      jump_to(i + 1);
+
+      return;
+    } else if (std::find(stops.begin(), stops.end(), kinds[i]) != stops.end()) {
+      break;
+    }
+  }
+
+  jump_to(i);
+}
@@ -0,0 +1,157 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * core/token_stream.hh:
+ *   Defines the `token_stream` class that lazily feeds tokens to the parser
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_CORE_TOKEN_STREAM_HH
+#define CASCADE_CORE_TOKEN_STREAM_HH
+
+#include "core/lexer.hh"
+#include "util/mixins.hh"
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <optional>
+
+namespace cascade::core {
+  /**
+   * @brief Pulls tokens out of a lexer on demand
+   * @details Only a small window of tokens is kept around: the previous token,
+   * the current one and one of lookahead. References returned from the accessors
+   * are only valid until the next call to `consume()`. Can also walk a list of
+   * tokens that were already lexed (e.g. in parallel).
+   */
+  class token_stream : util::noncopyable {
+    /** @brief Number of slots in the ring, needs to fit previous/current/next */
+    static constexpr std::size_t ring_size = 4;
+
+    /** @brief The lexer tokens are pulled out of, if they aren't already lexed */
+    std::optional<lexer> m_lexer;
+
+    /** @brief Tokens that were lexed ahead of time, used if there's no lexer */
+    std::optional<token_buffer> m_buffered;
+
+    /** @brief A buffer owned by someone else, used instead of `m_buffered` if set */
+    const token_buffer *m_borrowed = nullptr;
+
+    /** @brief The next token in the buffer to move into the ring */
+    std::size_t m_buffered_pos = 0;
+
+    /** @brief One past the last token in the buffer that's part of the stream */
+    std::size_t m_buffered_end = 0;
+
+    /** @brief Ring buffer of tokens, indexed by (absolute index % ring_size) */
+    std::array<std::optional<token>, ring_size> m_ring;
+
+    /** @brief Absolute index of the current token */
+    std::size_t m_index = 0;
+
+    /** @brief Number of tokens that have been pulled out of the lexer */
+    std::size_t m_lexed = 0;
+
+    /** @brief Lexes until the token after the current one is buffered, or the lexer runs out */
+    void fill();
+
+    /** @brief Gets the next token from the lexer or the pre-lexed buffer */
+    std::optional<token> pull();
+
+    /** @brief Returns the token at absolute index @p index, must be inside the window */
+    [[nodiscard]] const token &at(std::size_t index) const;
+
+    /** @brief Returns the pre-lexed tokens, there must not be a lexer */
+    [[nodiscard]] const token_buffer &buffer() const;
+
+    /**
+     * @brief Moves forward until the token at @p pos in the buffer is current
+     * @details Everything in between is skipped without being built
+     * @param pos The index in the buffer, at or after `position()`
+     */
+    void jump_to(std::size_t pos);
+
+  public:
+    /**
+     * @brief Creates a token stream
+     * @param source The lexer to pull tokens from
+     */
+    explicit token_stream(lexer source);
+
+    /**
+     * @brief Creates a token stream over tokens that were already lexed
+     * @param tokens The tokens, in source order
+     */
+    explicit token_stream(token_buffer tokens);
+
+    /**
+     * @brief Creates a token stream over part of a buffer owned by someone else
+     * @param tokens The tokens, they need to outlive the stream
+     * @param begin The index of the first token in the stream
+     * @param end One past the index of the last token in the stream
+     */
+    explicit token_stream(const token_buffer &tokens, std::size_t begin, std::size_t end);
+
+    /** @brief Returns the token before the current one */
+    [[nodiscard]] const token &previous() const;
+
+    /** @brief Returns the current token, the stream must not be at the end */
+    [[nodiscard]] const token &current() const;
+
+    /** @brief Returns the token after the current one, there must be one */
+    [[nodiscard]] const token &next() const;
+
+    /** @brief Returns whether every token has been consumed */
+    [[nodiscard]] bool is_at_end() const;
+
+    /** @brief Returns whether there is a token after the current one */
+    [[nodiscard]] bool has_next() const;
+
+    /**
+     * @brief Moves past the current token
+     * @return The token that was current
+     */
+    token consume();
+
+    /**
+     * @brief Consumes tokens until the current one is one of @p kinds, or the end
+     * @details Tokens that were already lexed are skipped by only looking at their
+     * kinds, none of the skipped tokens are built
+     * @param kinds The kinds to stop at
+     */
+    void skip_until(std::initializer_list<token::kind> kinds);
+
+    /**
+     * @brief Returns the index in the buffer of the current token
+     * @details The stream must be over pre-lexed tokens. Returns one past the
+     * last token once every token has been consumed
+     */
+    [[nodiscard]] std::size_t position() const;
+
+    /**
+     * @brief Consumes everything from the current `{` up to and including its matching `}`
+     * @details Braces are matched by only looking at the kinds of tokens, same as
+     * `skip_until`. The stream must be over pre-lexed tokens
+     * @param stops Kinds that can't be inside the block, if one is found before the
+     * matching `}` the block is treated as unclosed and the stream stops at it
+     */
+    void skip_block(std::initializer_list<token::kind> stops = {});
+  };
+} // namespace cascade::core
+
+#endif
@@ -5,13 +5,17 @@
 #include "core/lexer.hh"
 #include "errors/error.hh"
 #include "fmt/format.h"
+#include "util/interner.hh"
 #include "util/types.hh"
+#include <algorithm>
 #include <cassert>
 #include <deque>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace cascade;
 class scope;
@@ -27,12 +31,36 @@ static std::string expected_type(const ast::type_data &expected, const ast::type
       util::to_string(got));
 }
 
+/**
+ * @brief Prints every name in @p table and its type, sorted by name
+ * @details Symbols are handed out in whatever order the (parallel) lexer got to
+ * each name first, so neither the symbols nor the map's order are stable between runs
+ */
+static void print_sorted(const std::unordered_map<util::symbol, ast::type_data> &table) {
+  auto &names = util::interner::instance();
+  std::vector<std::pair<std::string_view, const ast::type_data *>> entries;
+
+  entries.reserve(table.size());
+
+  for (auto &[k, v] : table) {
+    entries.emplace_back(names.lookup(k), &v);
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) {
+    return lhs.first < rhs.first;
+  });
+
+  for (auto &[name, type] : entries) {
+    fmt::print("{{ name: {}, value: {} }}\n", name, util::to_string(*type));
+  }
+}
+
 class scope {
   /** @brief Variables mapped to their types */
-  std::unordered_map<std::string_view, ast::type_data> m_table;
+  std::unordered_map<util::symbol, ast::type_data> m_table;
 
   /** @brief Type aliases mapped to actual types */
-  std::unordered_map<std::string_view, ast::type_data> m_types;
+  std::unordered_map<util::symbol, ast::type_data> m_types;
 
   std::optional<std::reference_wrapper<scope>> m_parent;
 
@@ -44,7 +72,7 @@ public:
    * @brief Whether or not the scope includes that symbol
    * @param name The name to check for
    */
-  bool has(std::string_view name) {
+  bool has(util::symbol name) {
     if (m_table.find(name) != m_table.end()) {
       return true;
     }
@@ -60,7 +88,7 @@ public:
    * @brief Gets the type associated with a name
    * @param name The name to get
    */
-  ast::type_data &get(std::string_view name) {
+  ast::type_data &get(util::symbol name) {
     assert(has(name) && "attempting to get non-existent variable!");
 
     if (m_table.find(name) != m_table.end()) {
@@ -70,11 +98,11 @@ public:
     return m_parent.value().get().get(name);
   }
 
-  void set(std::string_view name, ast::type_data type) {
+  void set(util::symbol name, ast::type_data type) {
     m_table.insert_or_assign(name, std::move(type));
   }
 
-  bool has_alias(std::string_view name) {
+  bool has_alias(util::symbol name) {
     if (m_types.find(name) != m_table.end()) {
       return true;
     }
@@ -86,7 +114,7 @@ public:
     return false;
   }
 
-  ast::type_data &get_alias(std::string_view name) {
+  ast::type_data &get_alias(util::symbol name) {
     assert(has_alias(name) && "attempting to get non-existent variable!");
 
     if (m_types.find(name) != m_types.end()) {
@@ -96,13 +124,13 @@ public:
     return m_parent.value().get().get_alias(name);
   }
 
-  void set_alias(std::string_view name, ast::type_data type) {
+  void set_alias(util::symbol name, ast::type_data type) {
     m_types.insert_or_assign(name, std::move(type));
   }
 
-  std::unordered_map<std::string_view, ast::type_data> &table() { return m_table; };
+  std::unordered_map<util::symbol, ast::type_data> &table() { return m_table; };
 
-  std::unordered_map<std::string_view, ast::type_data> &types() { return m_types; };
+  std::unordered_map<util::symbol, ast::type_data> &types() { return m_types; };
 };
 
 class typechecker : public ast::visitor<ast::type_data> {
@@ -221,7 +249,7 @@ ast::type_data typechecker::visit(ast::const_decl &ref) {
   if (ref.type().data().is(ast::type::type_base::implied)) {
     // update AST value and the typechecker's representation
     ref.type().data() = std::move(initializer_type);
-    m_global_scopes.back().set(ref.name(), ref.type().data());
+    m_global_scopes.back().set(ref.name_id(), ref.type().data());
   }
 
   // e.g `const x: i32 = 3.5;`
@@ -238,7 +266,7 @@ ast::type_data typechecker::visit(ast::static_decl &ref) {
   // e.g `static x = 5;`
   if (ref.type().data().is(ast::type::type_base::implied)) {
     ref.type().data() = std::move(initializer_type);
-    m_global_scopes.back().set(ref.name(), ref.type().data());
+    m_global_scopes.back().set(ref.name_id(), ref.type().data());
   }
 
   // e.g `static x: i32 = 3.5;`
@@ -285,15 +313,32 @@ ast::type_data typechecker::visit(ast::string_literal &ref) {
 }
 
 ast::type_data typechecker::visit(ast::int_literal &ref) {
-  // todo: check for suffixes?
-  (void)ref;
-  return ast::type_data({}, base::integer, 32);
+  using suffix = core::token::literal_suffix;
+
+  switch (ref.suffix()) {
+    case suffix::i8:
+      return ast::type_data({}, base::integer, 8);
+    case suffix::i16:
+      return ast::type_data({}, base::integer, 16);
+    case suffix::i64:
+      return ast::type_data({}, base::integer, 64);
+    case suffix::u8:
+      return ast::type_data({}, base::unsigned_integer, 8);
+    case suffix::u16:
+      return ast::type_data({}, base::unsigned_integer, 16);
+    case suffix::u32:
+      return ast::type_data({}, base::unsigned_integer, 32);
+    case suffix::u64:
+      return ast::type_data({}, base::unsigned_integer, 64);
+    default:
+      return ast::type_data({}, base::integer, 32);
+  }
 }
 
 ast::type_data typechecker::visit(ast::float_literal &ref) {
-  // todo: check for suffixes
-  (void)ref;
-  return ast::type_data({}, base::floating_point, 32);
+  auto is_double = ref.suffix() == core::token::literal_suffix::f64;
+
+  return ast::type_data({}, base::floating_point, is_double ? 64 : 32);
 }
 
 ast::type_data typechecker::visit(ast::bool_literal &ref) {
@@ -443,12 +488,12 @@ void typechecker::handle_single_declaration(const ast::declaration &decl) {
   switch (decl.raw_kind()) {
     case kind::declaration_const: {
       const auto &ref = static_cast<const ast::const_decl &>(decl);
-      m_global_scopes.back().set(ref.name(), ref.type().data());
+      m_global_scopes.back().set(ref.name_id(), ref.type().data());
       break;
     }
     case kind::declaration_static: {
       const auto &ref = static_cast<const ast::static_decl &>(decl);
-      m_global_scopes.back().set(ref.name(), ref.type().data());
+      m_global_scopes.back().set(ref.name_id(), ref.type().data());
       break;
     }
     case kind::declaration_export: {
@@ -458,12 +503,12 @@ void typechecker::handle_single_declaration(const ast::declaration &decl) {
     }
     case kind::declaration_fn: {
       const auto &ref = static_cast<const ast::fn &>(decl);
-      m_global_scopes.back().set(ref.name(), ref.type().data());
+      m_global_scopes.back().set(ref.name_id(), ref.type().data());
       break;
     }
     case kind::declaration_type: {
       const auto &ref = static_cast<const ast::type_decl &>(decl);
-      m_global_scopes.back().set_alias(ref.name(), ref.type().data());
+      m_global_scopes.back().set_alias(ref.name_id(), ref.type().data());
       break;
     }
     default:
@@ -490,14 +535,10 @@ bool typechecker::typecheck_program(ast::program &prog) {
   }
 
   std::cout << "== symbol types ==\n";
-  for (auto &[k, v] : m_global_scopes.back().table()) {
-    fmt::print("{{ name: {}, value: {} }}\n", k, util::to_string(v));
-  }
+  print_sorted(m_global_scopes.back().table());
 
   std::cout << "== type aliases ==\n";
-  for (auto &[k, v] : m_global_scopes.back().types()) {
-    fmt::print("{{ name: {}, value: {} }}\n", k, util::to_string(v));
-  }
+  print_sorted(m_global_scopes.back().types());
 
   return m_has_failed;
 }
@@ -24,11 +24,16 @@
 #include "driver.hh"
 #include "core/lexer.hh"
 #include "core/parser.hh"
+#include "core/token_stream.hh"
 #include "core/typechecker.hh"
+#include "errors/diagnostic.hh"
 #include "errors/error.hh"
 #include "util/logging.hh"
+#include "util/source_manager.hh"
 #include "util/source_reader.hh"
 #include <algorithm>
+#include <future>
+#include <iostream>
 #include <iterator>
 #include <memory>
 #include <queue>
@@ -48,9 +53,20 @@ static void log_errors(std::vector<std::unique_ptr<errors::error>> errs, util::l
   });
 }
 
+// files at least this big get lexed up front on every thread instead of lazily
+static constexpr std::size_t parallel_lex_threshold = 4 << 20;
+
 driver::driver(int argc, const char **argv) : m_options(util::parse(argc, argv)) {}
 
-std::optional<ast::program> driver::parse(stdpath path, std::string_view source) {
+util::thread_pool &driver::pool() {
+  if (!m_pool) {
+    m_pool = std::make_unique<util::thread_pool>(m_options->jobs());
+  }
+
+  return *m_pool;
+}
+
+driver::parsed_file driver::parse(util::file_id file) {
   std::vector<std::unique_ptr<errors::error>> errs;
 
   auto report_err = [&errs](std::unique_ptr<errors::error> err) {
@@ -58,27 +74,80 @@ std::optional<ast::program> driver::parse(stdpath path, std::string_view source)
     errs.emplace_back(std::move(err));
   };
 
-  auto tokens = core::lexer(source, path, report_err).lex();
-  util::debug_print(tokens);
-  auto parsed = core::parse(std::move(tokens), report_err);
+  auto source = util::source_manager::instance().source(file);
+  auto diagnostics = errors::diagnostic_sink(file);
+  auto lexer = core::lexer(file, diagnostics);
+  auto parsed = (source.size() >= parallel_lex_threshold)
+                    ? core::parse(core::token_stream(lexer.lex(pool())), report_err)
+                    : core::parse(std::move(lexer), report_err);
+
+  // both lists are in source order already, merging keeps the order they were found in
+  auto lex_errs = diagnostics.to_errors();
+  auto all_errs = std::vector<std::unique_ptr<errors::error>>();
+  auto by_position = [](const std::unique_ptr<errors::error> &lhs,
+                         const std::unique_ptr<errors::error> &rhs) {
+    return lhs->position() < rhs->position();
+  };
+
+  std::merge(std::make_move_iterator(lex_errs.begin()),
+      std::make_move_iterator(lex_errs.end()),
+      std::make_move_iterator(errs.begin()),
+      std::make_move_iterator(errs.end()),
+      std::back_inserter(all_errs),
+      by_position);
 
-  log_errors(std::move(errs), util::logger(source));
+  auto program = all_errs.empty() ? std::make_optional(std::move(parsed)) : std::nullopt;
 
-  return (errs.size() == 0) ? std::make_optional(std::move(parsed)) : std::nullopt;
+  return parsed_file{std::move(program), std::move(all_errs), diagnostics.dropped()};
 }
 
-bool driver::parse(const std::vector<util::file_source> &files) {
+bool driver::parse(std::vector<util::file_source> files) {
+  auto &manager = util::source_manager::instance();
   auto has_failed = false;
 
-  for (const auto &file : files) {
-    m_sources.push_back(file.source());
+  // the manager isn't safe to add to from several threads, so everything is registered first
+  std::vector<util::file_id> ids;
+
+  for (auto &file : files) {
+    auto id = manager.add(std::move(file));
+
+    m_sources.push_back(manager.source(id));
+    ids.push_back(id);
+  }
+
+  // files don't share any parser state, each one is its own task. a lone file
+  // is parsed right here, there's nothing to overlap it with
+  std::vector<std::future<parsed_file>> pending;
+
+  if (ids.size() > 1) {
+    for (auto id : ids) {
+      pending.push_back(pool().submit([this, id] { return parse(id); }));
+    }
+  }
+
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    auto result = parsed_file{};
 
-    auto parsed = parse(file.path(), file.source());
+    if (pending.empty()) {
+      result = parse(ids[i]);
+    } else {
+      // waiting in input order keeps the output the same no matter which file finishes first
+      pool().wait(pending[i]);
+      result = pending[i].get();
+    }
+
+    log_errors(std::move(result.errors), util::logger(manager.source(ids[i])));
+
+    if (result.dropped != 0) {
+      std::cout << util::colors::bold_yellow(std::to_string(result.dropped)
+                                             + " more errors in this file weren't shown")
+                << "\n\n";
+    }
 
-    if (parsed) {
-      util::debug_print(parsed.value());
+    if (result.program) {
+      util::debug_print(result.program.value());
 
-      m_programs.emplace_back(std::move(parsed.value()));
+      m_programs.emplace_back(std::move(result.program.value()));
     } else {
       has_failed = true;
     }
@@ -126,16 +195,17 @@ int driver::run() {
 
   auto args = m_options.value();
 
-  // if no files are passed in, input is read from stdin
+  // if no files are passed in, input is read from stdin. files are loaded on the same
+  // pool the lexer uses later, rather than spinning up a second set of threads
   auto sources = args.files().size() == 0 ? util::read_source<util::pipe_reader>(args)
-                                          : util::read_source<util::file_reader>(args);
+                                          : util::file_reader::read(args, pool());
 
   // same w/ source readers, they will inform on the issue if they have one
   if (!sources) {
     return -1;
   }
 
-  if (parse(sources.value())) {
+  if (parse(std::move(sources.value()))) {
     return -2;
   }
 
@@ -25,11 +25,16 @@
 #define CASCADE_DRIVER_HH
 
 #include "ast/ast.hh"
+#include "errors/error.hh"
 #include "util/argument_parser.hh"
 #include "util/mixins.hh"
+#include "util/source_manager.hh"
 #include "util/source_reader.hh"
+#include "util/thread_pool.hh"
 #include <filesystem>
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace cascade {
   /**
@@ -46,20 +51,40 @@ namespace cascade {
 
     std::vector<std::string_view> m_sources;
 
+    /** @brief Worker threads, only started once something needs them */
+    std::unique_ptr<util::thread_pool> m_pool;
+
+    /** @brief Returns the worker pool, starting it if it hasn't been yet */
+    util::thread_pool &pool();
+
+    /** @brief Everything parsing one file produced, held until it's that file's turn to report */
+    struct parsed_file {
+      /** @brief The program, empty if there were any errors */
+      std::optional<ast::program> program;
+
+      /** @brief Every error in the file, in source order */
+      std::vector<std::unique_ptr<errors::error>> errors;
+
+      /** @brief The number of errors the lexer found but didn't keep */
+      std::size_t dropped;
+    };
+
     /**
-     * @brief Attempts to parse a source string
-     * @param path Path to the file being parsed
-     * @param source The source code
-     * @return An ast::program
+     * @brief Attempts to parse a source file
+     * @details Doesn't print anything, so it's safe to call for several files at once
+     * @param file The file being parsed, must be registered in the source_manager
+     * @return The program and any errors
      */
-    [[nodiscard]] std::optional<ast::program> parse(stdpath path, std::string_view source);
+    [[nodiscard]] parsed_file parse(util::file_id file);
 
     /**
-     * @brief Parses a list of source files and puts them in m_program
+     * @brief Registers a list of source files and parses them into m_program
+     * @details Files are parsed in parallel, but errors are reported and
+     * programs are stored in the order the files were given
      * @param files The files to parse
      * @return Whether any files failed to parse
      */
-    [[nodiscard]] bool parse(const std::vector<util::file_source> &files);
+    [[nodiscard]] bool parse(std::vector<util::file_source> files);
 
     /**
      * @brief Typechecks a list of programs and handles error reporting
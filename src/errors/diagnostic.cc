@@ -0,0 +1,71 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * errors/diagnostic.cc:
+ *   Implements the `diagnostic_sink` class
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "errors/diagnostic.hh"
+#include "core/lexer.hh"
+#include "errors/error.hh"
+#include <algorithm>
+
+using namespace cascade;
+using namespace errors;
+
+void diagnostic_sink::report(error_code code,
+    std::size_t offset,
+    std::size_t length,
+    std::string_view note) {
+  if (full()) {
+    ++m_dropped;
+
+    return;
+  }
+
+  auto id = note.empty() ? util::interner::empty : util::interner::instance().intern(note);
+
+  m_records.push_back(
+      diagnostic{code, static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(length), id});
+}
+
+void diagnostic_sink::append(const diagnostic_sink &other) {
+  auto room = m_limit - std::min(m_limit, m_records.size());
+  auto kept = std::min(room, other.m_records.size());
+
+  m_records.insert(m_records.end(), other.m_records.begin(), other.m_records.begin() + kept);
+  m_dropped += (other.m_records.size() - kept) + other.m_dropped;
+}
+
+std::vector<std::unique_ptr<error>> diagnostic_sink::to_errors() const {
+  auto &interner = util::interner::instance();
+  auto source = util::source_manager::instance().source(m_file);
+  std::vector<std::unique_ptr<error>> errs;
+
+  errs.reserve(m_records.size());
+
+  for (auto &record : m_records) {
+    auto raw = source.substr(record.offset, record.length);
+    auto tok = core::token(record.offset, core::token::kind::error, raw, m_file);
+
+    errs.push_back(error::from(record.code, tok, std::string(interner.lookup(record.note))));
+  }
+
+  return errs;
+}
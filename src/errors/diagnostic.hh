@@ -0,0 +1,131 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * errors/diagnostic.hh:
+ *   Defines compact diagnostic records and the sink the lexer reports them to
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_ERRORS_DIAGNOSTIC_HH
+#define CASCADE_ERRORS_DIAGNOSTIC_HH
+
+#include "errors/error_lookup.hh"
+#include "util/interner.hh"
+#include "util/source_manager.hh"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace cascade::errors {
+  class error;
+
+  /** @brief A diagnostic without anything needed to print it, see `diagnostic_sink` */
+  struct diagnostic {
+    /** @brief The error code */
+    error_code code;
+
+    /** @brief The offset of the offending text */
+    std::uint32_t offset;
+
+    /** @brief The length of the offending text */
+    std::uint32_t length;
+
+    /** @brief The note to show under the error, `util::interner::empty` if there isn't one */
+    util::symbol note;
+  };
+
+  /**
+   * @brief Collects diagnostics for one file as compact records
+   * @details Reporting is a push_back of 16 bytes, nothing is allocated per
+   * diagnostic. Records are only turned into `error`s when they're printed.
+   * Only the first `limit()` diagnostics are kept, the rest are just counted,
+   * so input that's nothing but errors (e.g. binary files) stays cheap.
+   */
+  class diagnostic_sink {
+    /** @brief The file the diagnostics are in */
+    util::file_id m_file;
+
+    /** @brief The maximum number of diagnostics that are kept */
+    std::size_t m_limit;
+
+    /** @brief Every diagnostic that's been kept, in the order they were reported */
+    std::vector<diagnostic> m_records;
+
+    /** @brief Number of diagnostics reported after the limit was hit */
+    std::size_t m_dropped = 0;
+
+  public:
+    /** @brief The default for `limit()` */
+    static constexpr std::size_t default_limit = 256;
+
+    /**
+     * @brief Creates an empty sink
+     * @param file The file the diagnostics will be in
+     * @param limit The maximum number of diagnostics to keep
+     */
+    explicit diagnostic_sink(util::file_id file, std::size_t limit = default_limit)
+        : m_file(file)
+        , m_limit(limit) {}
+
+    /**
+     * @brief Reports a diagnostic
+     * @param code The error code
+     * @param offset The offset of the offending text
+     * @param length The length of the offending text
+     * @param note A note to show under the error, empty for no note
+     */
+    void report(error_code code,
+        std::size_t offset,
+        std::size_t length,
+        std::string_view note = "");
+
+    /**
+     * @brief Moves every diagnostic in @p other onto the end, up to the limit
+     * @param other A sink for the same file, with diagnostics that come after these
+     */
+    void append(const diagnostic_sink &other);
+
+    /** @brief Returns the file the diagnostics are in */
+    [[nodiscard]] util::file_id file() const { return m_file; }
+
+    /** @brief Returns the maximum number of diagnostics that are kept */
+    [[nodiscard]] std::size_t limit() const { return m_limit; }
+
+    /** @brief Returns whether the limit has been hit */
+    [[nodiscard]] bool full() const { return m_records.size() >= m_limit; }
+
+    /** @brief Returns the number of diagnostics reported, including dropped ones */
+    [[nodiscard]] std::size_t count() const { return m_records.size() + m_dropped; }
+
+    /** @brief Returns the number of diagnostics dropped because of the limit */
+    [[nodiscard]] std::size_t dropped() const { return m_dropped; }
+
+    /** @brief Returns every diagnostic that was kept, in order */
+    [[nodiscard]] const std::vector<diagnostic> &records() const { return m_records; }
+
+    /**
+     * @brief Turns the kept diagnostics into errors that can be printed
+     * @return One error per record, in order
+     */
+    [[nodiscard]] std::vector<std::unique_ptr<error>> to_errors() const;
+  };
+} // namespace cascade::errors
+
+#endif
@@ -78,7 +78,13 @@ namespace cascade::errors {
      * @brief Returns the path of the file the error originated from
      * @return The path of the error's file
      */
-    [[nodiscard]] virtual std::filesystem::path path() const = 0;
+    [[nodiscard]] virtual const std::filesystem::path &path() const = 0;
+
+    /**
+     * @brief Returns the ID of the file the error originated from
+     * @return The error's file
+     */
+    [[nodiscard]] virtual util::file_id file() const = 0;
 
     /**
      * @brief Returns a "note" to put at the bottom of the error
@@ -161,7 +167,13 @@ namespace cascade::errors {
      * @brief Returns the path of the error
      * @return The path of the file the error is in
      */
-    [[nodiscard]] virtual std::filesystem::path path() const { return m_token.path(); }
+    [[nodiscard]] virtual const std::filesystem::path &path() const { return m_token.path(); }
+
+    /**
+     * @brief Returns the file of the error
+     * @return The ID of the file the error is in
+     */
+    [[nodiscard]] virtual util::file_id file() const { return m_token.file(); }
 
     /**
      * @brief Returns the "note" message
@@ -180,8 +192,8 @@ namespace cascade::errors {
     /** @brief Code of the error being printed */
     error_code m_code;
 
-    /** @brief Pointer to the node */
-    std::unique_ptr<ast::node> m_node;
+    /** @brief Where the node is, the node itself lives in its program's arena */
+    core::source_info m_info;
 
     /** @brief A helpful message to show under the error */
     std::optional<std::string> m_note;
@@ -190,13 +202,13 @@ namespace cascade::errors {
     /**
      * @brief Creates a new error
      * @param code The error code
-     * @param tok The offending token
+     * @param node The offending node
      */
     explicit ast_error(error_code code,
-        std::unique_ptr<ast::node> node,
+        const ast::node &node,
         std::optional<std::string> note = std::nullopt)
         : m_code(code)
-        , m_node(std::move(node))
+        , m_info(node.info())
         , m_note(std::move(note)) {}
 
     /**
@@ -209,25 +221,25 @@ namespace cascade::errors {
      * @brief Returns the error's offset in the source
      * @return An offset
      */
-    [[nodiscard]] virtual std::size_t position() const final { return m_node->info().position(); }
+    [[nodiscard]] virtual std::size_t position() const final { return m_info.position(); }
 
     /**
      * @brief Returns the line the error appears on
      * @return The line of the error
      */
-    [[nodiscard]] virtual std::size_t line() const final { return m_node->info().line(); }
+    [[nodiscard]] virtual std::size_t line() const final { return m_info.line(); }
 
     /**
      * @brief Returns the column of the error
      * @return The column number
      */
-    [[nodiscard]] virtual std::size_t column() const final { return m_node->info().column(); }
+    [[nodiscard]] virtual std::size_t column() const final { return m_info.column(); }
 
     /**
      * @brief Returns the number of characters in the error
      * @return The number of characters
      */
-    [[nodiscard]] virtual std::size_t length() const final { return m_node->info().length(); }
+    [[nodiscard]] virtual std::size_t length() const final { return m_info.length(); }
 
     /**
      * @brief Returns the entire source string causing the error
@@ -235,14 +247,20 @@ namespace cascade::errors {
      * @return A substring of @p source
      */
     [[nodiscard]] std::string_view raw(std::string_view source) const {
-      return source.substr(m_node->info().position(), m_node->info().length());
+      return source.substr(m_info.position(), m_info.length());
     }
 
     /**
      * @brief Returns the path of the error
      * @return The path of the file the error is in
      */
-    [[nodiscard]] virtual std::filesystem::path path() const { return m_node->info().path(); }
+    [[nodiscard]] virtual const std::filesystem::path &path() const { return m_info.path(); }
+
+    /**
+     * @brief Returns the file of the error
+     * @return The ID of the file the error is in
+     */
+    [[nodiscard]] virtual util::file_id file() const { return m_info.file(); }
 
     /**
      * @brief Returns the "note" message
@@ -327,7 +345,13 @@ namespace cascade::errors {
      * @brief Returns the path of the error
      * @return The path of the file the error is in
      */
-    [[nodiscard]] virtual std::filesystem::path path() const { return m_node.info().path(); }
+    [[nodiscard]] virtual const std::filesystem::path &path() const { return m_node.info().path(); }
+
+    /**
+     * @brief Returns the file of the error
+     * @return The ID of the file the error is in
+     */
+    [[nodiscard]] virtual util::file_id file() const { return m_node.info().file(); }
 
     /**
      * @brief Returns the "note" message
@@ -0,0 +1,90 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/arena.cc:
+ *   Implements the `arena` class
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/arena.hh"
+#include <cstdint>
+
+using namespace cascade::util;
+
+// objects are packed into blocks of this size, anything bigger gets its own block
+static constexpr std::size_t block_size = 64 * 1024;
+
+arena::arena(arena &&other) noexcept
+    : m_blocks(std::move(other.m_blocks))
+    , m_block_cursor(std::exchange(other.m_block_cursor, nullptr))
+    , m_block_left(std::exchange(other.m_block_left, 0))
+    , m_destructors(std::exchange(other.m_destructors, nullptr)) {
+  other.m_blocks.clear();
+}
+
+arena &arena::operator=(arena &&other) noexcept {
+  if (this != &other) {
+    release();
+
+    m_blocks = std::move(other.m_blocks);
+    m_block_cursor = std::exchange(other.m_block_cursor, nullptr);
+    m_block_left = std::exchange(other.m_block_left, 0);
+    m_destructors = std::exchange(other.m_destructors, nullptr);
+
+    other.m_blocks.clear();
+  }
+
+  return *this;
+}
+
+void arena::release() noexcept {
+  // newest first, the same order the objects would be destroyed in on the stack
+  for (auto entry = m_destructors; entry != nullptr; entry = entry->next) {
+    entry->destroy(entry->object);
+  }
+
+  m_destructors = nullptr;
+  m_block_cursor = nullptr;
+  m_block_left = 0;
+  m_blocks.clear();
+}
+
+void *arena::allocate(std::size_t size, std::size_t align) {
+  assert((align & (align - 1)) == 0 && align <= alignof(std::max_align_t) && "bad alignment");
+
+  // big objects get a block that's exactly their size, the current block keeps being used
+  if (size > block_size / 4) {
+    return m_blocks.emplace_back(new char[size]).get();
+  }
+
+  auto padding = (align - reinterpret_cast<std::uintptr_t>(m_block_cursor) % align) % align;
+
+  if (m_block_cursor == nullptr || size + padding > m_block_left) {
+    // not make_unique, there's no reason to zero the block
+    m_block_cursor = m_blocks.emplace_back(new char[block_size]).get();
+    m_block_left = block_size;
+    padding = 0;
+  }
+
+  auto memory = m_block_cursor + padding;
+
+  m_block_cursor += padding + size;
+  m_block_left -= padding + size;
+
+  return memory;
+}
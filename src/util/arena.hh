@@ -0,0 +1,189 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/arena.hh:
+ *   Defines a bump-pointer arena that AST nodes are allocated in
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_UTIL_ARENA_HH
+#define CASCADE_UTIL_ARENA_HH
+
+#include "util/mixins.hh"
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cascade::util {
+  /**
+   * @brief A non-owning pointer to an object allocated in an `arena`
+   * @details Never destroys what it points at, that only happens when the
+   * arena goes away. Converts to a handle to any base class, like a raw pointer
+   */
+  template <class T> class arena_ptr {
+    T *m_ptr = nullptr;
+
+  public:
+    arena_ptr() = default;
+
+    arena_ptr(std::nullptr_t) {}
+
+    explicit arena_ptr(T *ptr) : m_ptr(ptr) {}
+
+    template <class U, class = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    arena_ptr(arena_ptr<U> other) : m_ptr(other.get()) {}
+
+    [[nodiscard]] T *get() const { return m_ptr; }
+
+    T &operator*() const { return *m_ptr; }
+
+    T *operator->() const { return m_ptr; }
+
+    explicit operator bool() const { return m_ptr != nullptr; }
+  };
+
+  /** @brief A view of a contiguous list of objects, used for lists stored in an `arena` */
+  template <class T> class span {
+    T *m_data = nullptr;
+    std::size_t m_size = 0;
+
+  public:
+    span() = default;
+
+    span(T *data, std::size_t size) : m_data(data), m_size(size) {}
+
+    [[nodiscard]] T *begin() const { return m_data; }
+
+    [[nodiscard]] T *end() const { return m_data + m_size; }
+
+    [[nodiscard]] T *data() const { return m_data; }
+
+    [[nodiscard]] std::size_t size() const { return m_size; }
+
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+
+    T &operator[](std::size_t i) const {
+      assert(i < m_size && "span index out of range");
+      return m_data[i];
+    }
+  };
+
+  /**
+   * @brief Bump-pointer allocator where everything is freed at once
+   * @details Objects are packed into large blocks and never freed individually.
+   * Objects that need their destructor run (e.g. ones owning a `std::string`) are
+   * put on a list that's run in reverse when the arena is destroyed, trivially
+   * destructible objects cost nothing to tear down. Not thread-safe
+   */
+  class arena : noncopyable {
+    /** @brief An object that needs its destructor run, stored in the arena itself */
+    struct destructor {
+      void (*destroy)(void *);
+      void *object;
+      destructor *next;
+    };
+
+    /** @brief Blocks of memory objects are allocated from */
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+
+    /** @brief Where the next allocation in the current block starts */
+    char *m_block_cursor = nullptr;
+
+    /** @brief Number of bytes left in the current block */
+    std::size_t m_block_left = 0;
+
+    /** @brief The last object allocated that needs its destructor run */
+    destructor *m_destructors = nullptr;
+
+    /** @brief Runs every destructor and frees every block */
+    void release() noexcept;
+
+  public:
+    arena() = default;
+
+    arena(arena &&other) noexcept;
+
+    arena &operator=(arena &&other) noexcept;
+
+    ~arena() { release(); }
+
+    /**
+     * @brief Allocates raw memory that lives as long as the arena
+     * @param size The number of bytes
+     * @param align The alignment, must be a power of 2 no bigger than `alignof(std::max_align_t)`
+     * @return The memory
+     */
+    [[nodiscard]] void *allocate(std::size_t size, std::size_t align);
+
+    /**
+     * @brief Creates an object in the arena
+     * @param args The arguments to construct it with
+     * @return A handle to the object
+     */
+    template <class T, class... Args> arena_ptr<T> make(Args &&... args) {
+      auto object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+      if constexpr (!std::is_trivially_destructible_v<T>) {
+        remember(object);
+      }
+
+      return arena_ptr<T>(object);
+    }
+
+    /**
+     * @brief Moves a list of objects into the arena
+     * @param list The objects
+     * @return A span over the objects, now stored in the arena
+     */
+    template <class T> span<T> make_span(std::vector<T> &&list) {
+      if (list.empty()) {
+        return span<T>();
+      }
+
+      auto data = static_cast<T *>(allocate(sizeof(T) * list.size(), alignof(T)));
+
+      for (std::size_t i = 0; i < list.size(); ++i) {
+        new (data + i) T(std::move(list[i]));
+
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+          remember(data + i);
+        }
+      }
+
+      return span<T>(data, list.size());
+    }
+
+  private:
+    /** @brief Adds @p object to the list of objects destroyed with the arena */
+    template <class T> void remember(T *object) {
+      auto entry = static_cast<destructor *>(allocate(sizeof(destructor), alignof(destructor)));
+
+      entry->destroy = [](void *ptr) { static_cast<T *>(ptr)->~T(); };
+      entry->object = object;
+      entry->next = m_destructors;
+
+      m_destructors = entry;
+    }
+  };
+} // namespace cascade::util
+
+#endif
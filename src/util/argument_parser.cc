@@ -28,6 +28,8 @@
 #pragma clang diagnostic ignored "-Wunused-function"
 #include <cxxopts.hpp>
 #pragma clang diagnostic pop
+#include <filesystem>
+#include <fstream>
 
 using namespace cascade::util;
 
@@ -63,6 +65,128 @@ static std::optional<optimization_level> optimization_from_int(int input) {
   }
 }
 
+/**
+ * @brief Reads the lines of a file, without any trailing `\r`
+ * @param path The file to read
+ * @return The lines, or nothing if the file couldn't be opened
+ */
+static std::optional<std::vector<std::string>> read_lines(const fs::path &path) {
+  std::ifstream stream(path);
+
+  if (!stream.is_open()) {
+    return std::nullopt;
+  }
+
+  std::vector<std::string> lines;
+
+  for (std::string line; std::getline(stream, line);) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    lines.push_back(std::move(line));
+  }
+
+  return lines;
+}
+
+/**
+ * @brief Replaces every `@path` argument with the lines of that file
+ * @details Response files aren't expanded recursively, and blank lines are skipped
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return The expanded arguments, or nothing if a response file couldn't be read
+ */
+static std::optional<std::vector<std::string>> expand_response_files(int argc,
+    const char **argv) {
+  std::vector<std::string> args;
+
+  for (auto i = 0; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+
+    // argv[0] is the program, it's never a response file
+    if (i == 0 || arg.size() < 2 || arg.front() != '@') {
+      args.emplace_back(arg);
+
+      continue;
+    }
+
+    auto lines = read_lines(fs::path(arg.substr(1)));
+
+    if (!lines) {
+      error(std::string(arg.substr(1)) + ": Unable to open response file!");
+
+      return std::nullopt;
+    }
+
+    for (auto &line : lines.value()) {
+      if (!line.empty()) {
+        args.push_back(std::move(line));
+      }
+    }
+  }
+
+  return args;
+}
+
+/**
+ * @brief Reads a manifest, adding every file listed in it to @p files
+ * @details Every line is a path, optionally followed by a tab and the file's module
+ * name. Blank lines and lines starting with `#` are ignored. Relative paths are
+ * relative to the manifest, not to the working directory
+ * @param path The manifest
+ * @param files The list of files to add to
+ * @param modules The list of module names to add to, kept the same length as @p files
+ * @return Whether the manifest was valid
+ */
+static bool read_manifest(const fs::path &path,
+    std::vector<std::string> &files,
+    std::vector<std::string> &modules) {
+  auto lines = read_lines(path);
+
+  if (!lines) {
+    error(path.string() + ": Unable to open manifest!");
+
+    return false;
+  }
+
+  auto base = path.parent_path();
+  auto valid = true;
+
+  for (std::size_t i = 0; i < lines->size(); ++i) {
+    auto line = std::string_view((*lines)[i]);
+
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+
+    auto tab = line.find('\t');
+    auto file = line.substr(0, tab);
+    auto module = tab == std::string_view::npos ? std::string_view{} : line.substr(tab + 1);
+
+    if (file.empty() || module.find('\t') != std::string_view::npos) {
+      error(path.string() + ":" + std::to_string(i + 1) + ": Expected '<path>[\\t<module>]'!");
+
+      // keep going, every bad line gets reported
+      valid = false;
+
+      continue;
+    }
+
+    files.push_back((base / file).string());
+    modules.emplace_back(module);
+  }
+
+  // an empty file list means "read stdin", that's never what an empty manifest wants
+  if (valid && files.empty()) {
+    error(path.string() + ": Manifest doesn't list any files!");
+
+    return false;
+  }
+
+  return valid;
+}
+
 #ifdef _WIN32
 static constexpr auto default_output = "main.exe";
 #else
@@ -70,17 +194,25 @@ static constexpr auto default_output = "main";
 #endif
 
 compilation_options::compilation_options(std::vector<std::string> paths,
+    std::vector<std::string> modules,
     optimization_level opt_level,
     bool debug_symbols,
     emitted emitted,
     std::string triple,
-    std::string output)
+    std::string output,
+    bool framed,
+    std::size_t jobs)
     : m_files(std::move(paths))
+    , m_modules(std::move(modules))
     , m_opt_level(opt_level)
     , m_debug_symbols(debug_symbols)
     , m_to_emit(emitted)
     , m_target_triple(std::move(triple))
-    , m_output(std::move(output)) {}
+    , m_output(std::move(output))
+    , m_framed(framed)
+    , m_jobs(jobs) {
+  m_modules.resize(m_files.size());
+}
 
 std::optional<compilation_options> cascade::util::parse(int argc, const char **argv) {
   using options = compilation_options;
@@ -88,7 +220,7 @@ std::optional<compilation_options> cascade::util::parse(int argc, const char **a
   cxxopts::Options console_options(argv[0], "Compiler for the Cascade language\n");
 
   console_options.custom_help("[options]");
-  console_options.positional_help("file(s)...\n\nOptions:");
+  console_options.positional_help("file(s)... [@response-file]\n\nOptions:");
 
   console_options.add_options()
       //
@@ -112,13 +244,42 @@ std::optional<compilation_options> cascade::util::parse(int argc, const char **a
           "The LLVM target to output for",
           cxxopts::value<std::string>()->default_value("default"))
       //
+      ("framed",
+          "Read several files from stdin, each after a '<length> <path>' header line",
+          cxxopts::value<bool>()->default_value("false"))
+      //
+      ("m,manifest",
+          "A file listing files to compile, one per line as '<path>[\\t<module>]'",
+          cxxopts::value<std::string>())
+      //
+      ("j,jobs",
+          "Number of threads to use, 0 means one per core",
+          cxxopts::value<int>()->default_value("0"))
+      //
       ("h,help", "Prints this page")
       //
       ("input-files", "", cxxopts::value<std::vector<std::string>>(), "INPUT FILES");
 
+  auto args = expand_response_files(argc, argv);
+
+  if (!args) {
+    return std::nullopt;
+  }
+
+  // cxxopts wants the same shape as argv
+  std::vector<const char *> arg_pointers;
+  arg_pointers.reserve(args->size());
+
+  for (auto &arg : args.value()) {
+    arg_pointers.push_back(arg.c_str());
+  }
+
+  auto expanded_argc = static_cast<int>(arg_pointers.size());
+  auto expanded_argv = arg_pointers.data();
+
   try {
     console_options.parse_positional({"input-files"});
-    auto result = console_options.parse(argc, argv);
+    auto result = console_options.parse(expanded_argc, expanded_argv);
 
     if (result.count("help")) {
       std::cout << console_options.help();
@@ -144,18 +305,41 @@ std::optional<compilation_options> cascade::util::parse(int argc, const char **a
       return std::nullopt;
     }
 
+    auto jobs = result["jobs"].as<int>();
+
+    if (jobs < 0) {
+      util::error("Number of jobs can't be negative!");
+
+      return std::nullopt;
+    }
+
     auto output = result["output"].as<std::string>();
     auto target = result["target"].as<std::string>();
+    auto framed = result["framed"].as<bool>();
+
+    auto files = std::vector<std::string>{};
+    auto modules = std::vector<std::string>{};
 
     if (result.count("input-files")) {
-      auto files = result["input-files"].as<std::vector<std::string>>();
+      files = result["input-files"].as<std::vector<std::string>>();
+      modules.resize(files.size());
+    }
 
-      return std::make_optional<options>(
-          options(files, opt_level.value(), debug, emitted.value(), target, output));
+    if (result.count("manifest")) {
+      if (!read_manifest(result["manifest"].as<std::string>(), files, modules)) {
+        return std::nullopt;
+      }
     }
 
-    return std::make_optional<options>(
-        options({}, opt_level.value(), debug, emitted.value(), target, output));
+    return std::make_optional<options>(options(std::move(files),
+        std::move(modules),
+        opt_level.value(),
+        debug,
+        emitted.value(),
+        target,
+        output,
+        framed,
+        static_cast<std::size_t>(jobs)));
   } catch (const cxxopts::OptionException &err) {
     util::error(std::string("Error while parsing options: ") + err.what());
 
@@ -25,6 +25,7 @@
 #define CASCADE_UTIL_ARGUMENT_PARSER_HH
 
 #include "util/mixins.hh"
+#include <cstddef>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -65,6 +66,12 @@ namespace cascade::util {
      */
     std::vector<std::string> m_files;
 
+    /**
+     * @brief The module name of each file in `m_files`, by index. Empty
+     * when a file wasn't given one
+     */
+    std::vector<std::string> m_modules;
+
     /** @brief The optimization level given */
     optimization_level m_opt_level;
 
@@ -80,22 +87,34 @@ namespace cascade::util {
     /** @brief The output file */
     std::string m_output;
 
+    /** @brief Whether piped input holds several files, see `pipe_reader` */
+    bool m_framed = false;
+
+    /** @brief The number of worker threads to use, 0 means one per hardware thread */
+    std::size_t m_jobs = 0;
+
   public:
     /**
      * @brief Creates a new compilation_options object
      * @param files The list of files to compile
+     * @param modules The module name of each file, may be shorter than @p files
      * @param opt_level The optimization level
      * @param debug_symbols Whether or not debug symbols are enabled
      * @param emitted The form to emit the output in
      * @param triple The target triple
      * @param output The file to output to
+     * @param framed Whether piped input holds several files
+     * @param jobs The number of worker threads, 0 means one per hardware thread
      */
     explicit compilation_options(std::vector<std::string> files,
+        std::vector<std::string> modules,
         optimization_level opt_level,
         bool debug_symbols,
         emitted to_emit,
         std::string triple,
-        std::string output);
+        std::string output,
+        bool framed,
+        std::size_t jobs);
 
     /**
      * @brief Returns a list of files to compile. If the list is empty,
@@ -104,6 +123,14 @@ namespace cascade::util {
      */
     const std::vector<std::string> &files() const { return m_files; }
 
+    /**
+     * @brief Returns the module name of each file, in the same order as `files()`
+     * @details Only files listed in a manifest can have a module name, the
+     * rest are empty strings
+     * @return The list of module names
+     */
+    const std::vector<std::string> &modules() const { return m_modules; }
+
     /**
      * @brief Returns the optimization level
      * @return The optimization level
@@ -133,10 +160,24 @@ namespace cascade::util {
      * @return The output file
      */
     std::string_view output() const { return m_output; }
+
+    /**
+     * @brief Returns whether piped input holds several files, each with a header
+     * @return Whether input is framed
+     */
+    bool framed() const { return m_framed; }
+
+    /**
+     * @brief Returns the number of worker threads to use
+     * @return The number of threads, 0 means one per hardware thread
+     */
+    std::size_t jobs() const { return m_jobs; }
   };
 
   /**
    * @brief Parses the program arguments
+   * @details Any argument of the form `@path` is replaced by the lines of the file at
+   * `path`, one argument per line. Lets a build pass more files than fit on a command line
    * @return The options given to the compiler
    */
   std::optional<compilation_options> parse(int argc, const char **argv);
@@ -0,0 +1,494 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/hash.cc:
+ *   Implements XXH3-128, with SSE2/AVX2 paths for long inputs picked at runtime
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/hash.hh"
+#include <array>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CASCADE_HAS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace cascade;
+
+static constexpr std::uint32_t prime32_1 = 0x9E3779B1U;
+static constexpr std::uint32_t prime32_2 = 0x85EBCA77U;
+static constexpr std::uint32_t prime32_3 = 0xC2B2AE3DU;
+static constexpr std::uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+static constexpr std::uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr std::uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+static constexpr std::uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr std::uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+static constexpr std::uint64_t prime_mx1 = 0x165667919E3779F9ULL;
+static constexpr std::uint64_t prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+/** @brief The bytes of a stripe, the unit long inputs are consumed in */
+static constexpr std::size_t stripe_length = 64;
+
+/** @brief How far into the secret each stripe moves */
+static constexpr std::size_t secret_consume_rate = 8;
+
+/** @brief The default XXH3 secret, every offset used below is into this */
+alignas(64) static constexpr std::array<std::uint8_t, 192> secret = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// both of these compile down to a single load on little-endian machines
+
+static std::uint32_t read32(const std::uint8_t *ptr) {
+  return static_cast<std::uint32_t>(ptr[0]) | (static_cast<std::uint32_t>(ptr[1]) << 8)
+         | (static_cast<std::uint32_t>(ptr[2]) << 16) | (static_cast<std::uint32_t>(ptr[3]) << 24);
+}
+
+static std::uint64_t read64(const std::uint8_t *ptr) {
+  return static_cast<std::uint64_t>(read32(ptr))
+         | (static_cast<std::uint64_t>(read32(ptr + 4)) << 32);
+}
+
+static std::uint32_t swap32(std::uint32_t x) {
+  return ((x << 24) & 0xFF000000U) | ((x << 8) & 0x00FF0000U) | ((x >> 8) & 0x0000FF00U)
+         | ((x >> 24) & 0x000000FFU);
+}
+
+static std::uint64_t swap64(std::uint64_t x) {
+  return (static_cast<std::uint64_t>(swap32(static_cast<std::uint32_t>(x))) << 32)
+         | swap32(static_cast<std::uint32_t>(x >> 32));
+}
+
+static std::uint32_t rotl32(std::uint32_t x, int bits) { return (x << bits) | (x >> (32 - bits)); }
+
+/** @brief Full 64x64 -> 128 bit multiply */
+static util::hash128 multiply(std::uint64_t lhs, std::uint64_t rhs) {
+#ifdef __SIZEOF_INT128__
+  __extension__ using u128 = unsigned __int128;
+
+  auto product = static_cast<u128>(lhs) * rhs;
+
+  return {static_cast<std::uint64_t>(product), static_cast<std::uint64_t>(product >> 64)};
+#else
+  auto lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  auto hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  auto lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  auto hi_hi = (lhs >> 32) * (rhs >> 32);
+  auto cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+
+  return {(cross << 32) | (lo_lo & 0xFFFFFFFF), (hi_lo >> 32) + (cross >> 32) + hi_hi};
+#endif
+}
+
+/** @brief Multiplies to 128 bits, then xors the halves together */
+static std::uint64_t multiply_fold(std::uint64_t lhs, std::uint64_t rhs) {
+  auto product = multiply(lhs, rhs);
+
+  return product.low ^ product.high;
+}
+
+static std::uint64_t xxh64_avalanche(std::uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= prime64_2;
+  hash ^= hash >> 29;
+  hash *= prime64_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+static std::uint64_t avalanche(std::uint64_t hash) {
+  hash ^= hash >> 37;
+  hash *= prime_mx1;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+static util::hash128 hash_1_to_3(const std::uint8_t *input, std::size_t length) {
+  auto combined_low = (static_cast<std::uint32_t>(input[0]) << 16)
+                      | (static_cast<std::uint32_t>(input[length >> 1]) << 24)
+                      | static_cast<std::uint32_t>(input[length - 1])
+                      | (static_cast<std::uint32_t>(length) << 8);
+  auto combined_high = rotl32(swap32(combined_low), 13);
+  auto flip_low = static_cast<std::uint64_t>(read32(secret.data()) ^ read32(secret.data() + 4));
+  auto flip_high =
+      static_cast<std::uint64_t>(read32(secret.data() + 8) ^ read32(secret.data() + 12));
+
+  return {xxh64_avalanche(combined_low ^ flip_low), xxh64_avalanche(combined_high ^ flip_high)};
+}
+
+static util::hash128 hash_4_to_8(const std::uint8_t *input, std::size_t length) {
+  auto combined = read32(input) + (static_cast<std::uint64_t>(read32(input + length - 4)) << 32);
+  auto flip = read64(secret.data() + 16) ^ read64(secret.data() + 24);
+  auto result = multiply(combined ^ flip, prime64_1 + (length << 2));
+
+  result.high += result.low << 1;
+  result.low ^= result.high >> 3;
+  result.low ^= result.low >> 35;
+  result.low *= prime_mx2;
+  result.low ^= result.low >> 28;
+  result.high = avalanche(result.high);
+
+  return result;
+}
+
+static util::hash128 hash_9_to_16(const std::uint8_t *input, std::size_t length) {
+  auto flip_low = read64(secret.data() + 32) ^ read64(secret.data() + 40);
+  auto flip_high = read64(secret.data() + 48) ^ read64(secret.data() + 56);
+  auto input_low = read64(input);
+  auto input_high = read64(input + length - 8);
+  auto mixed = multiply(input_low ^ input_high ^ flip_low, prime64_1);
+
+  mixed.low += static_cast<std::uint64_t>(length - 1) << 54;
+  input_high ^= flip_high;
+  mixed.high += input_high
+                + static_cast<std::uint64_t>(static_cast<std::uint32_t>(input_high))
+                      * (prime32_2 - 1);
+  mixed.low ^= swap64(mixed.high);
+
+  auto result = multiply(mixed.low, prime64_2);
+  result.high += mixed.high * prime64_2;
+
+  return {avalanche(result.low), avalanche(result.high)};
+}
+
+static std::uint64_t mix16(const std::uint8_t *input, const std::uint8_t *key) {
+  return multiply_fold(read64(input) ^ read64(key), read64(input + 8) ^ read64(key + 8));
+}
+
+/** @brief Mixes two 16 byte blocks into both halves of @p acc */
+static void mix32(util::hash128 &acc,
+    const std::uint8_t *first,
+    const std::uint8_t *second,
+    const std::uint8_t *key) {
+  acc.low += mix16(first, key);
+  acc.low ^= read64(second) + read64(second + 8);
+  acc.high += mix16(second, key + 16);
+  acc.high ^= read64(first) + read64(first + 8);
+}
+
+/** @brief The final step shared by the 17-128 and 129-240 byte paths */
+static util::hash128 finish_mid(util::hash128 acc, std::size_t length) {
+  auto low = acc.low + acc.high;
+  auto high = acc.low * prime64_1 + acc.high * prime64_4 + length * prime64_2;
+
+  return {avalanche(low), 0 - avalanche(high)};
+}
+
+static util::hash128 hash_17_to_128(const std::uint8_t *input, std::size_t length) {
+  auto acc = util::hash128{length * prime64_1, 0};
+
+  if (length > 32) {
+    if (length > 64) {
+      if (length > 96) {
+        mix32(acc, input + 48, input + length - 64, secret.data() + 96);
+      }
+
+      mix32(acc, input + 32, input + length - 48, secret.data() + 64);
+    }
+
+    mix32(acc, input + 16, input + length - 32, secret.data() + 32);
+  }
+
+  mix32(acc, input, input + length - 16, secret.data());
+
+  return finish_mid(acc, length);
+}
+
+static util::hash128 hash_129_to_240(const std::uint8_t *input, std::size_t length) {
+  auto acc = util::hash128{length * prime64_1, 0};
+
+  for (std::size_t i = 32; i < 160; i += 32) {
+    mix32(acc, input + i - 32, input + i - 16, secret.data() + i - 32);
+  }
+
+  acc = {avalanche(acc.low), avalanche(acc.high)};
+
+  // the rest of the 32 byte blocks reuse the secret, 3 bytes off from the first four
+  for (std::size_t i = 160; i <= length; i += 32) {
+    mix32(acc, input + i - 32, input + i - 16, secret.data() + 3 + i - 160);
+  }
+
+  mix32(acc, input + length - 16, input + length - 32, secret.data() + 136 - 17 - 16);
+
+  return finish_mid(acc, length);
+}
+
+/** @brief One implementation of the two steps of hashing long inputs */
+struct long_hasher {
+  /** @brief Folds @p stripes stripes of input into the accumulators */
+  void (*accumulate)(std::uint64_t *, const std::uint8_t *, const std::uint8_t *, std::size_t);
+
+  /** @brief Scrambles the accumulators after every block of stripes */
+  void (*scramble)(std::uint64_t *, const std::uint8_t *);
+};
+
+static void scalar_accumulate(std::uint64_t *acc,
+    const std::uint8_t *input,
+    const std::uint8_t *key,
+    std::size_t stripes) {
+  for (std::size_t n = 0; n < stripes; ++n) {
+    auto stripe = input + n * stripe_length;
+    auto stripe_key = key + n * secret_consume_rate;
+
+    for (std::size_t i = 0; i < 8; ++i) {
+      auto value = read64(stripe + i * 8);
+      auto keyed = value ^ read64(stripe_key + i * 8);
+
+      acc[i ^ 1] += value;
+      acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+    }
+  }
+}
+
+static void scalar_scramble(std::uint64_t *acc, const std::uint8_t *key) {
+  for (std::size_t i = 0; i < 8; ++i) {
+    auto value = acc[i];
+
+    value ^= value >> 47;
+    value ^= read64(key + i * 8);
+    value *= prime32_1;
+    acc[i] = value;
+  }
+}
+
+#ifdef CASCADE_HAS_X86_SIMD
+// both of these do exactly what the scalar versions do, 2 or 4 accumulators at a time.
+// the accumulators stay in registers for every stripe of a block
+
+__attribute__((target("sse2"))) static void sse2_accumulate(std::uint64_t *acc,
+    const std::uint8_t *input,
+    const std::uint8_t *key,
+    std::size_t stripes) {
+  auto acc_vec = reinterpret_cast<__m128i *>(acc);
+  __m128i lanes[4];
+
+  for (auto i = 0; i < 4; ++i) {
+    lanes[i] = _mm_loadu_si128(acc_vec + i);
+  }
+
+  for (std::size_t n = 0; n < stripes; ++n) {
+    auto stripe = reinterpret_cast<const __m128i *>(input + n * stripe_length);
+    auto stripe_key = reinterpret_cast<const __m128i *>(key + n * secret_consume_rate);
+
+    for (auto i = 0; i < 4; ++i) {
+      auto value = _mm_loadu_si128(stripe + i);
+      auto keyed = _mm_xor_si128(value, _mm_loadu_si128(stripe_key + i));
+
+      // (low 32 bits) * (high 32 bits) of each 64-bit lane
+      auto product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+      auto swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+
+      lanes[i] = _mm_add_epi64(product, _mm_add_epi64(lanes[i], swapped));
+    }
+  }
+
+  for (auto i = 0; i < 4; ++i) {
+    _mm_storeu_si128(acc_vec + i, lanes[i]);
+  }
+}
+
+__attribute__((target("sse2"))) static void sse2_scramble(std::uint64_t *acc,
+    const std::uint8_t *key) {
+  auto acc_vec = reinterpret_cast<__m128i *>(acc);
+  auto key_vec = reinterpret_cast<const __m128i *>(key);
+  auto prime = _mm_set1_epi32(static_cast<int>(prime32_1));
+
+  for (auto i = 0; i < 4; ++i) {
+    auto value = _mm_loadu_si128(acc_vec + i);
+    value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+    value = _mm_xor_si128(value, _mm_loadu_si128(key_vec + i));
+
+    // there's no 64x32 multiply, it's done as two 32x32 ones
+    auto product_low = _mm_mul_epu32(value, prime);
+    auto product_high = _mm_mul_epu32(_mm_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+
+    _mm_storeu_si128(acc_vec + i, _mm_add_epi64(product_low, _mm_slli_epi64(product_high, 32)));
+  }
+}
+
+__attribute__((target("avx2"))) static void avx2_accumulate(std::uint64_t *acc,
+    const std::uint8_t *input,
+    const std::uint8_t *key,
+    std::size_t stripes) {
+  auto acc_vec = reinterpret_cast<__m256i *>(acc);
+  __m256i lanes[2] = {_mm256_loadu_si256(acc_vec), _mm256_loadu_si256(acc_vec + 1)};
+
+  for (std::size_t n = 0; n < stripes; ++n) {
+    auto stripe = reinterpret_cast<const __m256i *>(input + n * stripe_length);
+    auto stripe_key = reinterpret_cast<const __m256i *>(key + n * secret_consume_rate);
+
+    for (auto i = 0; i < 2; ++i) {
+      auto value = _mm256_loadu_si256(stripe + i);
+      auto keyed = _mm256_xor_si256(value, _mm256_loadu_si256(stripe_key + i));
+      auto product =
+          _mm256_mul_epu32(keyed, _mm256_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+      auto swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+
+      lanes[i] = _mm256_add_epi64(product, _mm256_add_epi64(lanes[i], swapped));
+    }
+  }
+
+  _mm256_storeu_si256(acc_vec, lanes[0]);
+  _mm256_storeu_si256(acc_vec + 1, lanes[1]);
+}
+
+__attribute__((target("avx2"))) static void avx2_scramble(std::uint64_t *acc,
+    const std::uint8_t *key) {
+  auto acc_vec = reinterpret_cast<__m256i *>(acc);
+  auto key_vec = reinterpret_cast<const __m256i *>(key);
+  auto prime = _mm256_set1_epi32(static_cast<int>(prime32_1));
+
+  for (auto i = 0; i < 2; ++i) {
+    auto value = _mm256_loadu_si256(acc_vec + i);
+    value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 47));
+    value = _mm256_xor_si256(value, _mm256_loadu_si256(key_vec + i));
+
+    auto product_low = _mm256_mul_epu32(value, prime);
+    auto product_high =
+        _mm256_mul_epu32(_mm256_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+
+    _mm256_storeu_si256(acc_vec + i,
+        _mm256_add_epi64(product_low, _mm256_slli_epi64(product_high, 32)));
+  }
+}
+#endif
+
+/**
+ * @brief Picks the widest implementation the CPU running the compiler supports
+ * @return The hasher to use
+ */
+static long_hasher select_hasher() {
+#ifdef CASCADE_HAS_X86_SIMD
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return {avx2_accumulate, avx2_scramble};
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    return {sse2_accumulate, sse2_scramble};
+  }
+#endif
+
+  return {scalar_accumulate, scalar_scramble};
+}
+
+/** @brief Returns the hasher picked for this machine, only selected once */
+static const long_hasher &active_hasher() {
+  static const long_hasher selected = select_hasher();
+
+  return selected;
+}
+
+/** @brief Combines the 8 accumulators into 64 bits */
+static std::uint64_t merge(const std::uint64_t *acc, const std::uint8_t *key, std::uint64_t start) {
+  for (std::size_t i = 0; i < 4; ++i) {
+    start += multiply_fold(acc[2 * i] ^ read64(key + 16 * i),
+        acc[2 * i + 1] ^ read64(key + 16 * i + 8));
+  }
+
+  return avalanche(start);
+}
+
+static util::hash128 hash_long(const std::uint8_t *input, std::size_t length) {
+  constexpr auto stripes_per_block = (secret.size() - stripe_length) / secret_consume_rate;
+  constexpr auto block_length = stripe_length * stripes_per_block;
+
+  auto &hasher = active_hasher();
+  auto blocks = (length - 1) / block_length;
+
+  alignas(64) std::uint64_t acc[8] = {
+      prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1};
+
+  for (std::size_t n = 0; n < blocks; ++n) {
+    hasher.accumulate(acc, input + n * block_length, secret.data(), stripes_per_block);
+    hasher.scramble(acc, secret.data() + secret.size() - stripe_length);
+  }
+
+  // whatever full stripes are left, then the last 64 bytes (overlapping the previous
+  // stripe) with a key that's 7 bytes off from the scramble key
+  auto stripes = ((length - 1) - block_length * blocks) / stripe_length;
+
+  hasher.accumulate(acc, input + blocks * block_length, secret.data(), stripes);
+  hasher.accumulate(acc,
+      input + length - stripe_length,
+      secret.data() + secret.size() - stripe_length - 7,
+      1);
+
+  return {merge(acc, secret.data() + 11, length * prime64_1),
+      merge(acc, secret.data() + secret.size() - sizeof(acc) - 11, ~(length * prime64_2))};
+}
+
+std::string util::hash128::to_string() const {
+  constexpr auto digits = "0123456789abcdef";
+
+  std::string result(32, '0');
+
+  for (auto i = 0; i < 16; ++i) {
+    result[15 - i] = digits[(high >> (i * 4)) & 0xF];
+    result[31 - i] = digits[(low >> (i * 4)) & 0xF];
+  }
+
+  return result;
+}
+
+util::hash128 util::hash_bytes(std::string_view data) {
+  auto input = reinterpret_cast<const std::uint8_t *>(data.data());
+  auto length = data.size();
+
+  if (length == 0) {
+    return {xxh64_avalanche(read64(secret.data() + 64) ^ read64(secret.data() + 72)),
+        xxh64_avalanche(read64(secret.data() + 80) ^ read64(secret.data() + 88))};
+  }
+
+  if (length <= 3) {
+    return hash_1_to_3(input, length);
+  }
+
+  if (length <= 8) {
+    return hash_4_to_8(input, length);
+  }
+
+  if (length <= 16) {
+    return hash_9_to_16(input, length);
+  }
+
+  if (length <= 128) {
+    return hash_17_to_128(input, length);
+  }
+
+  if (length <= 240) {
+    return hash_129_to_240(input, length);
+  }
+
+  return hash_long(input, length);
+}
@@ -0,0 +1,75 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/hash.hh:
+ *   Defines the 128-bit content hash used to identify sources
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_UTIL_HASH_HH
+#define CASCADE_UTIL_HASH_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cascade::util {
+  /** @brief A 128-bit hash, big enough to key caches on without worrying about collisions */
+  struct hash128 {
+    /** @brief The low 64 bits */
+    std::uint64_t low;
+
+    /** @brief The high 64 bits */
+    std::uint64_t high;
+
+    bool operator==(const hash128 &other) const { return low == other.low && high == other.high; }
+
+    bool operator!=(const hash128 &other) const { return !(*this == other); }
+
+    bool operator<(const hash128 &other) const {
+      return high < other.high || (high == other.high && low < other.low);
+    }
+
+    /**
+     * @brief Formats the hash as 32 hex digits, high bits first
+     * @return The hash as a string
+     */
+    [[nodiscard]] std::string to_string() const;
+  };
+
+  /**
+   * @brief Hashes a string of bytes
+   * @details Computes XXH3-128 with the default secret and no seed, so the
+   * result matches `xxh128sum`. Long inputs use SSE2/AVX2 where the CPU has them
+   * @param data The bytes to hash
+   * @return The hash
+   */
+  hash128 hash_bytes(std::string_view data);
+} // namespace cascade::util
+
+namespace std {
+  template <> struct hash<cascade::util::hash128> {
+    std::size_t operator()(const cascade::util::hash128 &value) const {
+      // the bits are already well mixed, there's nothing to gain from hashing again
+      return static_cast<std::size_t>(value.low);
+    }
+  };
+} // namespace std
+
+#endif
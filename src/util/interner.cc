@@ -0,0 +1,170 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/interner.cc:
+ *   Implements the `interner` class
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/interner.hh"
+#include "util/keywords.hh"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+using namespace cascade::util;
+
+// names that can't be used for anything but the builtin types
+static constexpr std::string_view builtin_words[] = {
+    "i8",
+    "i16",
+    "i32",
+    "i64",
+    "u8",
+    "u16",
+    "u32",
+    "u64",
+    "f32",
+    "f64",
+    "bool",
+};
+
+// strings are packed into blocks of this size, anything bigger gets its own block
+static constexpr std::size_t block_size = 64 * 1024;
+
+// number of entries in each thread's cache, must be a power of 2
+static constexpr std::size_t cache_size = 1024;
+
+/** @brief A string a thread interned recently, `str` is the interner's copy */
+struct cached_symbol {
+  std::string_view str;
+  symbol sym = interner::empty;
+};
+
+interner::interner() {
+  intern("");
+
+  for (auto word : builtin_words) {
+    intern(word);
+  }
+}
+
+interner &interner::instance() {
+  static interner table;
+
+  return table;
+}
+
+std::string_view interner::store(std::string_view str) {
+  if (str.empty()) {
+    return std::string_view{};
+  }
+
+  // big strings get a block that's exactly their size, the current block keeps being used
+  if (str.size() > block_size) {
+    auto &block = m_blocks.emplace_back(std::make_unique<char[]>(str.size()));
+    std::memcpy(block.get(), str.data(), str.size());
+
+    return std::string_view(block.get(), str.size());
+  }
+
+  if (str.size() > m_block_left) {
+    m_block_cursor = m_blocks.emplace_back(std::make_unique<char[]>(block_size)).get();
+    m_block_left = block_size;
+  }
+
+  auto dest = m_block_cursor;
+
+  std::memcpy(dest, str.data(), str.size());
+  m_block_cursor += str.size();
+  m_block_left -= str.size();
+
+  return std::string_view(dest, str.size());
+}
+
+symbol interner::intern(std::string_view str) {
+  // strings are never freed and never change symbols, so a cached entry never goes stale.
+  // an empty slot holds the empty string, which is already the right answer for it
+  thread_local cached_symbol cache[cache_size];
+
+  auto &slot = cache[std::hash<std::string_view>{}(str) & (cache_size - 1)];
+
+  if (slot.str == str) {
+    return slot.sym;
+  }
+
+  auto [stored, sym] = intern_shared(str);
+
+  slot = cached_symbol{stored, sym};
+
+  return sym;
+}
+
+std::pair<std::string_view, symbol> interner::intern_shared(std::string_view str) {
+  {
+    std::shared_lock lock(m_mutex);
+
+    if (auto it = m_symbols.find(str); it != m_symbols.end()) {
+      return *it;
+    }
+  }
+
+  std::unique_lock lock(m_mutex);
+
+  // another thread could have interned it between the two locks
+  if (auto it = m_symbols.find(str); it != m_symbols.end()) {
+    return *it;
+  }
+
+  auto properties = std::uint8_t{none};
+
+  if (std::find(std::begin(builtin_words), std::end(builtin_words), str)
+      != std::end(builtin_words)) {
+    properties |= builtin;
+  }
+
+  if (!str.empty() && util::is_kind(str)) {
+    properties |= keyword;
+  }
+
+  auto stored = store(str);
+  auto sym = static_cast<symbol>(m_entries.size());
+
+  m_entries.push_back(entry{stored, properties});
+  m_symbols.emplace(stored, sym);
+
+  return {stored, sym};
+}
+
+std::string_view interner::lookup(symbol sym) const {
+  std::shared_lock lock(m_mutex);
+
+  return m_entries[sym].str;
+}
+
+bool interner::is_builtin(symbol sym) const {
+  std::shared_lock lock(m_mutex);
+
+  return (m_entries[sym].properties & builtin) != 0;
+}
+
+bool interner::is_keyword(symbol sym) const {
+  std::shared_lock lock(m_mutex);
+
+  return (m_entries[sym].properties & keyword) != 0;
+}
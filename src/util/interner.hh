@@ -0,0 +1,153 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/interner.hh:
+ *   Defines the global string interner that identifiers are stored in
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_UTIL_INTERNER_HH
+#define CASCADE_UTIL_INTERNER_HH
+
+#include "util/mixins.hh"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cascade::util {
+  /** @brief Compact handle to an interned string, equal strings always get the same symbol */
+  using symbol = std::uint32_t;
+
+  /**
+   * @brief A symbol as its own type, for storing one next to other integers
+   * @details `symbol` is the same type as `std::size_t` on 32-bit targets, so
+   * e.g a `std::variant<std::size_t, symbol>` wouldn't compile there
+   */
+  struct strong_symbol {
+    symbol id;
+
+    bool operator==(strong_symbol other) const { return id == other.id; }
+
+    bool operator!=(strong_symbol other) const { return id != other.id; }
+  };
+
+  /**
+   * @brief Deduplicates identifiers into 32-bit symbols
+   * @details The lexer interns every identifier, everything after it (parser,
+   * typechecker) only compares symbols. Strings are never freed, so the
+   * string_views handed out stay valid for the rest of the program.
+   * Safe to use from multiple threads at once. Each thread keeps a small cache
+   * of what it interned recently in front of the shared table, so repeated
+   * identifiers (most of them) don't touch the table's lock at all.
+   */
+  class interner : noncopyable {
+  public:
+    /** @brief Properties of a string figured out when it's first interned */
+    enum flags : std::uint8_t {
+      none = 0,
+      /** @brief A builtin type name, e.g `i32` or `bool` */
+      builtin = 1 << 0,
+      /** @brief A keyword, e.g `fn` */
+      keyword = 1 << 1,
+    };
+
+    /** @brief The symbol for the empty string */
+    static constexpr symbol empty = 0;
+
+  private:
+    /** @brief An interned string */
+    struct entry {
+      std::string_view str;
+      std::uint8_t properties;
+    };
+
+    /** @brief Guards everything below, lookups only need a shared lock */
+    mutable std::shared_mutex m_mutex;
+
+    /** @brief Every interned string, indexed by symbol */
+    std::deque<entry> m_entries;
+
+    /** @brief Maps strings back to their symbols */
+    std::unordered_map<std::string_view, symbol> m_symbols;
+
+    /** @brief Blocks of memory the strings are copied into */
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+
+    /** @brief Where the next string gets copied to in the current block */
+    char *m_block_cursor = nullptr;
+
+    /** @brief Number of bytes left in the current block */
+    std::size_t m_block_left = 0;
+
+    /** @brief Copies @p str into storage owned by the interner */
+    std::string_view store(std::string_view str);
+
+    /**
+     * @brief Interns a string through the shared table, taking its lock
+     * @param str The string to intern
+     * @return The interner's copy of @p str and its symbol
+     */
+    std::pair<std::string_view, symbol> intern_shared(std::string_view str);
+
+    /** @brief Interns the builtin names ahead of time */
+    interner();
+
+  public:
+    /**
+     * @brief Returns the global interner
+     * @return The interner
+     */
+    static interner &instance();
+
+    /**
+     * @brief Interns a string
+     * @param str The string to intern
+     * @return The symbol for @p str
+     */
+    symbol intern(std::string_view str);
+
+    /**
+     * @brief Gets the string a symbol was interned from
+     * @param sym The symbol
+     * @return The string
+     */
+    [[nodiscard]] std::string_view lookup(symbol sym) const;
+
+    /**
+     * @brief Checks if a symbol is a builtin type name
+     * @param sym The symbol
+     * @return Whether it's a builtin
+     */
+    [[nodiscard]] bool is_builtin(symbol sym) const;
+
+    /**
+     * @brief Checks if a symbol is a keyword
+     * @param sym The symbol
+     * @return Whether it's a keyword
+     */
+    [[nodiscard]] bool is_keyword(symbol sym) const;
+  };
+} // namespace cascade::util
+
+#endif
@@ -22,15 +22,25 @@
  *---------------------------------------------------------------------------*/
 
 #include "util/keywords.hh"
-#include <cassert>
-#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <optional>
 
 using namespace cascade;
 using kind = core::token::kind;
+using suffix = core::token::literal_suffix;
 
-// this gets reversed for string_to_kind
-// every k/v pair get put back into string_to_kind with string_to_kind[v] = k;
-static std::unordered_map<kind, std::string_view> kind_to_string{
+/** @brief A kind and the string it maps to */
+struct kind_mapping {
+  kind type;
+  std::string_view str;
+};
+
+// every kind that has a fixed spelling. this is used in both directions,
+// string -> kind goes through the perfect hash below, kind -> string through an array
+static constexpr kind_mapping spellings[] = {
+    {kind::literal_bool, "true"},
+    {kind::literal_bool, "false"},
     {kind::keyword_const, "const"},
     {kind::keyword_static, "static"},
     {kind::keyword_fn, "fn"},
@@ -102,36 +112,186 @@ static std::unordered_map<kind, std::string_view> kind_to_string{
     {kind::symbol_tilde, "~"},
 };
 
-static std::unordered_map<std::string_view, kind> string_to_kind{};
+// these need to **not** be looked up by string, they're only for printing
+static constexpr kind_mapping descriptions[] = {
+    {kind::identifier, "identifier"},
+    {kind::literal_number, "number literal"},
+    {kind::literal_float, "float literal"},
+    {kind::literal_bool, "bool literal"},
+    {kind::literal_char, "char literal"},
+    {kind::literal_string, "string literal"},
+    {kind::unknown, "unknown"},
+    {kind::error, "error"},
+};
+
+// the kinds are dense, so the last one tells us how many there are
+static constexpr auto kind_count = static_cast<std::size_t>(kind::symbol_tilde) + 1;
+
+// number of slots in the hash table, needs to be a power of two
+static constexpr std::size_t table_size = 512;
+
+static constexpr std::uint8_t empty_slot = 0xFF;
+
+static_assert(std::size(spellings) < empty_slot,
+    "every spelling needs an index that fits in a slot");
+
+/**
+ * @brief Hashes the first two characters, the last character and the length of a string
+ * @details Those are enough to tell every spelling apart, so a lookup never looks at
+ * more than 3 characters before the final comparison
+ * @param raw The string to hash, must not be empty
+ * @param seed The seed to mix in
+ * @return A slot in the table
+ */
+static constexpr std::size_t hash(std::string_view raw, std::uint32_t seed) {
+  constexpr std::uint32_t prime = 0x01000193;
+  auto first = static_cast<unsigned char>(raw.front());
+  auto second = static_cast<unsigned char>(raw.size() > 1 ? raw[1] : '\0');
+  auto last = static_cast<unsigned char>(raw.back());
+  auto h = seed;
 
-// allows "standards compliant" __attribute__((constructor)), so this would work on MSVC as well
-// it simply initializes the strings_to_kind type with flipped k/vs to what kind_to_string has
-static struct init {
-  init() {
-    for (auto &pair : kind_to_string) {
-      string_to_kind[pair.second] = pair.first;
+  h = (h ^ static_cast<std::uint32_t>(raw.size())) * prime;
+  h = (h ^ first) * prime;
+  h = (h ^ second) * prime;
+  h = (h ^ last) * prime;
+
+  return (h ^ (h >> 16)) & (table_size - 1);
+}
+
+/**
+ * @brief Checks if a seed maps every spelling to a different slot
+ * @param seed The seed to check
+ * @return Whether there are no collisions
+ */
+static constexpr bool is_collision_free(std::uint32_t seed) {
+  std::array<bool, table_size> used{};
+
+  for (auto &mapping : spellings) {
+    auto slot = hash(mapping.str, seed);
+
+    if (used[slot]) {
+      return false;
     }
 
-    // these need to **not** be included in string_to_kind, so they're added here
-    kind_to_string[kind::identifier] = "identifier";
-    kind_to_string[kind::literal_number] = "number literal";
-    kind_to_string[kind::literal_float] = "float literal";
-    kind_to_string[kind::literal_bool] = "bool literal";
-    kind_to_string[kind::literal_char] = "char literal";
-    kind_to_string[kind::literal_string] = "string literal";
-    kind_to_string[kind::unknown] = "unknown";
-    kind_to_string[kind::error] = "error";
-
-    // same for string_to_kind
-    string_to_kind["true"] = kind::literal_bool;
-    string_to_kind["false"] = kind::literal_bool;
+    used[slot] = true;
   }
-} init;
 
-bool util::is_kind(std::string_view raw) {
-  return string_to_kind.find(raw) != string_to_kind.end();
+  return true;
 }
 
-kind util::kind_from_string(std::string_view raw) { return string_to_kind[raw]; }
+/**
+ * @brief Searches for the first seed that gives a perfect hash
+ * @return The seed, or 0 if none of the seeds tried work
+ */
+static constexpr std::uint32_t find_seed() {
+  for (std::uint32_t seed = 1; seed < 65536; ++seed) {
+    if (is_collision_free(seed)) {
+      return seed;
+    }
+  }
 
-std::string_view util::string_from_kind(kind k) { return kind_to_string[k]; }
+  return 0;
+}
+
+static constexpr auto seed = find_seed();
+
+static_assert(seed != 0 && is_collision_free(seed),
+    "no collision-free seed was found for the spellings, table_size needs to grow");
+
+/** @brief Builds the slot -> index into `spellings` table */
+static constexpr std::array<std::uint8_t, table_size> build_slots() {
+  std::array<std::uint8_t, table_size> slots{};
+
+  for (auto &slot : slots) {
+    slot = empty_slot;
+  }
+
+  for (std::size_t i = 0; i < std::size(spellings); ++i) {
+    slots[hash(spellings[i].str, seed)] = static_cast<std::uint8_t>(i);
+  }
+
+  return slots;
+}
+
+/** @brief Builds the kind -> string table */
+static constexpr std::array<std::string_view, kind_count> build_names() {
+  std::array<std::string_view, kind_count> names{};
+
+  for (auto &mapping : spellings) {
+    // true/false share a kind, that gets a description instead
+    if (mapping.type != kind::literal_bool) {
+      names[static_cast<std::size_t>(mapping.type)] = mapping.str;
+    }
+  }
+
+  for (auto &mapping : descriptions) {
+    names[static_cast<std::size_t>(mapping.type)] = mapping.str;
+  }
+
+  return names;
+}
+
+static constexpr auto slots = build_slots();
+
+static constexpr auto names = build_names();
+
+/**
+ * @brief Finds the spelling that @p raw is, if there is one
+ * @param raw The string to look up
+ * @return A pointer to the mapping, or nullptr
+ */
+static const kind_mapping *find_spelling(std::string_view raw) {
+  if (raw.empty()) {
+    return nullptr;
+  }
+
+  auto index = slots[hash(raw, seed)];
+
+  if (index == empty_slot || spellings[index].str != raw) {
+    return nullptr;
+  }
+
+  return &spellings[index];
+}
+
+bool util::is_kind(std::string_view raw) { return find_spelling(raw) != nullptr; }
+
+kind util::kind_from_string(std::string_view raw) {
+  auto mapping = find_spelling(raw);
+
+  return (mapping != nullptr) ? mapping->type : kind::unknown;
+}
+
+std::string_view util::string_from_kind(kind k) { return names[static_cast<std::size_t>(k)]; }
+
+// indexed by the suffix, `none` is never looked up by spelling
+static constexpr std::string_view suffixes[] = {
+    "",
+    "i8",
+    "i16",
+    "i32",
+    "i64",
+    "u8",
+    "u16",
+    "u32",
+    "u64",
+    "f32",
+    "f64",
+};
+
+static_assert(std::size(suffixes) == static_cast<std::size_t>(suffix::f64) + 1,
+    "every suffix needs a spelling");
+
+std::optional<suffix> util::suffix_from_string(std::string_view raw) {
+  for (std::size_t i = 1; i < std::size(suffixes); ++i) {
+    if (suffixes[i] == raw) {
+      return static_cast<suffix>(i);
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::string_view util::string_from_suffix(suffix s) {
+  return suffixes[static_cast<std::size_t>(s)];
+}
@@ -26,6 +26,7 @@
 #define CASCADE_UTIL_KEYWORDS_HH
 
 #include "core/lexer.hh"
+#include <optional>
 
 namespace cascade::util {
   /**
@@ -36,9 +37,9 @@ namespace cascade::util {
 
   /**
    * @brief Returns a token::kind for a raw string if possible
-   * @details Throws an std::exception derivative if the string isn't
-   * found in the symbol mappings or keyword mappings. This shouldn't
-   * be caught, just check is_kind() beforehand.
+   * @details Returns token::kind::unknown if the string isn't
+   * found in the symbol mappings or keyword mappings, check is_kind()
+   * beforehand if that matters.
    * @return The kind of token it is
    */
   core::token::kind kind_from_string(std::string_view raw);
@@ -48,6 +49,18 @@ namespace cascade::util {
    * @return The string representation of a token
    */
   std::string_view string_from_kind(core::token::kind kind);
+
+  /**
+   * @brief Returns the number literal suffix a string spells, e.g `u8`
+   * @return The suffix, or std::nullopt if @p raw isn't one
+   */
+  std::optional<core::token::literal_suffix> suffix_from_string(std::string_view raw);
+
+  /**
+   * @brief Returns the spelling of a number literal suffix
+   * @return The suffix as a string, empty for `none`
+   */
+  std::string_view string_from_suffix(core::token::literal_suffix suffix);
 } // namespace cascade::util
 
 #endif
@@ -24,10 +24,12 @@
 #include "util/logging.hh"
 #include "ast/detail/declarations.hh"
 #include "ast/detail/types.hh"
+#include "ast/flat.hh"
 #include "ast/visitor.hh"
 #include "errors/error_lookup.hh"
 #include "errors/error_visitor.hh"
 #include "util/keywords.hh"
+#include "util/source_manager.hh"
 #include "util/types.hh"
 #include <fmt/core.h>
 #include <fmt/format.h>
@@ -122,13 +124,13 @@ static constexpr unsigned number_of_digits(int n) {
   return digits;
 }
 
-/** @brief Visits AST nodes to print them out */
-struct printer : public ast::visitor<void> {
+/** @brief Visits the nodes of a flat AST to print them out */
+struct printer : public ast::flat::visitor<void> {
   std::string m_prefix = "";
 
-  void accept_with_prefix(ast::node &node);
+  void accept_with_prefix(ast::flat::view node);
 
-#define VISIT(type) virtual void visit(ast::type &) final
+#define VISIT(type) virtual void visit(ast::flat::type) final
 
   CASCADE_VISIT_TYPES
 
@@ -137,15 +139,15 @@ struct printer : public ast::visitor<void> {
 
 using kind = ast::kind;
 
-void printer::accept_with_prefix(ast::node &node) {
+void printer::accept_with_prefix(ast::flat::view node) {
   m_prefix += "  ";
   node.accept(*this);
   m_prefix = m_prefix.substr(0, m_prefix.size() - 2);
 }
 
-void printer::visit(ast::type &node) { std::cout << util::to_string(node.data()) << "\n"; }
+void printer::visit(ast::flat::type node) { std::cout << util::to_string(node.data()) << "\n"; }
 
-void printer::visit(ast::type_decl &decl) {
+void printer::visit(ast::flat::type_decl decl) {
   std::cout << "type alias {\n";
   fmt::print("{}  type: ", m_prefix);
   decl.type().accept(*this);
@@ -153,7 +155,7 @@ void printer::visit(ast::type_decl &decl) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::const_decl &decl) {
+void printer::visit(ast::flat::const_decl decl) {
   std::cout << "const decl {\n";
   fmt::print("{}  type: ", m_prefix);
 
@@ -167,7 +169,7 @@ void printer::visit(ast::const_decl &decl) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::static_decl &decl) {
+void printer::visit(ast::flat::static_decl decl) {
   std::cout << "static decl {\n";
   fmt::print("{}  type: ", m_prefix);
 
@@ -181,7 +183,7 @@ void printer::visit(ast::static_decl &decl) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::argument &arg) {
+void printer::visit(ast::flat::argument arg) {
   std::cout << "argument {\n";
   fmt::print("{}  name: {}\n", m_prefix, arg.name());
   fmt::print("{}  type: ", m_prefix);
@@ -190,7 +192,7 @@ void printer::visit(ast::argument &arg) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::fn &fn) {
+void printer::visit(ast::flat::fn fn) {
   std::cout << "fn {\n";
   fmt::print("{}  name: {}\n", m_prefix, fn.name());
   fmt::print("{}  type: ", m_prefix);
@@ -201,7 +203,7 @@ void printer::visit(ast::fn &fn) {
     fmt::print("{}  args: [\n{}    ", m_prefix, m_prefix);
 
     m_prefix += "  ";
-    for (auto &arg : fn.args()) {
+    for (auto arg : fn.args()) {
       accept_with_prefix(arg);
     }
     m_prefix = m_prefix.substr(0, m_prefix.length() - 2);
@@ -212,44 +214,48 @@ void printer::visit(ast::fn &fn) {
   }
 
   fmt::print("{}  body: ", m_prefix);
-  accept_with_prefix(fn.body());
-  fmt::print("{}}}\n", m_prefix);
-}
-
-void printer::visit(ast::module_decl &mod) { fmt::print("module: {}\n", mod.name()); }
 
-void printer::visit(ast::import_decl &impt) {
-  std::cout << "import {\n";
-  fmt::print("{}  from: {}\n", m_prefix, impt.name());
-  fmt::print("{}  items: [\n", m_prefix);
-
-  for (auto &item : impt.items()) {
-    fmt::print("{}    {}\n,", m_prefix, item);
+  if (fn.skimmed()) {
+    fmt::print("<skimmed>\n");
+  } else {
+    accept_with_prefix(fn.body());
   }
 
-  fmt::print("{}  ]\n", m_prefix);
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::export_decl &expt) {
+void printer::visit(ast::flat::module_decl mod) { fmt::print("module: {}\n", mod.name()); }
+
+void printer::visit(ast::flat::import_decl) {
+  throw std::logic_error{"imports can't be flattened yet"};
+}
+
+void printer::visit(ast::flat::export_decl expt) {
   std::cout << "(exported) ";
 
   expt.exported().accept(*this);
 }
 
-void printer::visit(ast::char_literal &c) { fmt::print("char literal: '{}'\n", c.value()); }
+void printer::visit(ast::flat::char_literal c) { fmt::print("char literal: '{}'\n", c.value()); }
 
-void printer::visit(ast::string_literal &s) { fmt::print("string literal: \"{}\"\n", s.value()); }
+void printer::visit(ast::flat::string_literal s) { fmt::print("string literal: \"{}\"\n", s.value()); }
 
-void printer::visit(ast::int_literal &d) { fmt::print("integer literal: {}\n", d.value()); }
+void printer::visit(ast::flat::int_literal d) { fmt::print("integer literal: {}\n", d.value()); }
 
-void printer::visit(ast::float_literal &f) { fmt::print("float literal: {}\n", f.value()); }
+void printer::visit(ast::flat::float_literal f) {
+  // f32 literals are stored as doubles, they'd print with digits that were never written
+  if (f.suffix() == core::token::literal_suffix::f64) {
+    fmt::print("float literal: {}\n", f.value());
+  } else {
+    fmt::print("float literal: {}\n", static_cast<float>(f.value()));
+  }
+}
 
-void printer::visit(ast::bool_literal &b) { fmt::print("bool literal: {}\n", b.value()); }
+void printer::visit(ast::flat::bool_literal b) { fmt::print("bool literal: {}\n", b.value()); }
 
-void printer::visit(ast::identifier &id) { fmt::print("identifier: '{}'\n", id.name()); }
+void printer::visit(ast::flat::identifier id) { fmt::print("identifier: '{}'\n", id.name()); }
 
-void printer::visit(ast::call &call) {
+void printer::visit(ast::flat::call call) {
   std::cout << "call {\n";
   fmt::print("{}  callee: ", m_prefix);
   accept_with_prefix(call.callee());
@@ -258,9 +264,9 @@ void printer::visit(ast::call &call) {
     fmt::print("{}  args: [\n", m_prefix);
 
     m_prefix += "  ";
-    for (auto &arg : call.args()) {
+    for (auto arg : call.args()) {
       fmt::print("{}  arg: ", m_prefix);
-      accept_with_prefix(*arg);
+      accept_with_prefix(arg);
     }
     m_prefix = m_prefix.substr(0, m_prefix.size() - 2);
 
@@ -271,7 +277,7 @@ void printer::visit(ast::call &call) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::binary &binop) {
+void printer::visit(ast::flat::binary binop) {
   std::cout << "binary {\n";
   fmt::print("{}  op: {}\n", m_prefix, string_from_kind(binop.op()));
   fmt::print("{}  lhs: ", m_prefix);
@@ -281,7 +287,7 @@ void printer::visit(ast::binary &binop) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::unary &unop) {
+void printer::visit(ast::flat::unary unop) {
   std::cout << "unary {\n";
   fmt::print("{}  op: {}\n", m_prefix, string_from_kind(unop.op()));
   fmt::print("{}  rhs: ", m_prefix);
@@ -289,7 +295,7 @@ void printer::visit(ast::unary &unop) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::field_access &field) {
+void printer::visit(ast::flat::field_access field) {
   std::cout << "field access {\n";
   fmt::print("{}  object: ", m_prefix);
   accept_with_prefix(field.accessed());
@@ -297,7 +303,7 @@ void printer::visit(ast::field_access &field) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::index &idx) {
+void printer::visit(ast::flat::index idx) {
   std::cout << "index access {\n";
   fmt::print("{}  object: ", m_prefix);
   accept_with_prefix(idx.array());
@@ -306,7 +312,7 @@ void printer::visit(ast::index &idx) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::if_else &ifelse) {
+void printer::visit(ast::flat::if_else ifelse) {
   std::cout << "if {\n";
   fmt::print("{}  condition: ", m_prefix);
   accept_with_prefix(ifelse.condition());
@@ -321,9 +327,9 @@ void printer::visit(ast::if_else &ifelse) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::struct_init &) { throw std::logic_error{"Not implemented!"}; }
+void printer::visit(ast::flat::struct_init) { throw std::logic_error{"Not implemented!"}; }
 
-void printer::visit(ast::block &block) {
+void printer::visit(ast::flat::block block) {
   std::cout << "block {\n";
   fmt::print("{}  return_type: ", m_prefix);
   block.type().accept(*this);
@@ -332,9 +338,9 @@ void printer::visit(ast::block &block) {
     fmt::print("{}  items: [\n", m_prefix);
 
     m_prefix += "  ";
-    for (auto &item : block.statements()) {
+    for (auto item : block.statements()) {
       fmt::print("{}  ", m_prefix);
-      accept_with_prefix(*item);
+      accept_with_prefix(item);
     }
     m_prefix = m_prefix.substr(0, m_prefix.size() - 2);
 
@@ -346,12 +352,12 @@ void printer::visit(ast::block &block) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::expression_statement &stmt) {
+void printer::visit(ast::flat::expression_statement stmt) {
   std::cout << "expr statement: ";
   stmt.expr().accept(*this);
 }
 
-void printer::visit(ast::let &stmt) {
+void printer::visit(ast::flat::let stmt) {
   std::cout << "let {\n";
   fmt::print("{}  type: ", m_prefix);
   stmt.type().accept(*this);
@@ -361,7 +367,7 @@ void printer::visit(ast::let &stmt) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::mut &stmt) {
+void printer::visit(ast::flat::mut stmt) {
   std::cout << "mut {\n";
   fmt::print("{}  type: ", m_prefix);
   stmt.type().accept(*this);
@@ -371,7 +377,7 @@ void printer::visit(ast::mut &stmt) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::ret &ret) {
+void printer::visit(ast::flat::ret ret) {
   std::cout << "ret {\n";
   fmt::print("{}  return value: ", m_prefix);
 
@@ -384,7 +390,7 @@ void printer::visit(ast::ret &ret) {
   fmt::print("{}}}\n", m_prefix);
 }
 
-void printer::visit(ast::loop &loop) {
+void printer::visit(ast::flat::loop loop) {
   std::cout << "loop {\n";
   fmt::print("{}  condition: ", m_prefix);
 
@@ -416,15 +422,18 @@ class logger::impl : public errors::error_visitor {
   /** @brief Puts the path:line:col error: [Enumber] error message thing up */
   void print_start(const errors::error &err) const;
 
-  /** @brief Prints out the code line in the error */
-  void print_code(const errors::error &err) const;
+  /** @brief Prints out the code line in the error, @p line is that line without its newline */
+  void print_code(util::source_location where, std::string_view line) const;
 
   /** @brief Puts a ~~~ or ^ under the source code for an error */
-  void point_out(const errors::error &err) const;
+  void point_out(const errors::error &err, util::source_location where, std::string_view line) const;
 
   /** @brief Prints out the err'rs note, if it has one */
   void print_note(const errors::error &err) const;
 
+  /** @brief Prints out the whole error, the line and column are only looked up once */
+  void print(const errors::error &err) const;
+
 public:
   impl(std::string_view source) : m_source(std::move(source)) {
 #ifdef CASCADE_IS_WIN32
@@ -490,29 +499,28 @@ void logger::impl::print_start(const errors::error &e) const {
   }
 }
 
-void logger::impl::print_code(const errors::error &err) const {
+void logger::impl::print_code(util::source_location where, std::string_view line) const {
   using namespace fmt::literals;
 
   // the lines without the number need to line up with the one that has it
-  std::string padding(number_of_digits(err.line()), ' ');
+  std::string padding(number_of_digits(where.line), ' ');
 
   fmt::print(" {padding} {pipe}\n", "padding"_a = padding, "pipe"_a = colors::bold_black("|"));
 
-  // err.position starts at 0, tok.column starts at 1. hence the +1
-  auto line_start = (err.position() + 1) - err.column();
-
   fmt::print(" {line} {pipe} {source}\n",
-      "line"_a = err.line(),
+      "line"_a = where.line,
       "pipe"_a = colors::bold_black("|"),
-      "source"_a = m_source.substr(line_start, m_source.find('\n', line_start) - line_start));
+      "source"_a = line);
 }
 
-void logger::impl::point_out(const errors::error &err) const {
+void logger::impl::point_out(const errors::error &err,
+    util::source_location where,
+    std::string_view line) const {
   using namespace fmt::literals;
 
-  std::string pipe_padding(number_of_digits(err.line()), ' ');
+  std::string pipe_padding(number_of_digits(where.line), ' ');
 
-  auto src_padding_len = err.column() - 1;
+  auto src_padding_len = where.column - 1;
 
   if (err.code() == errors::error_code::unexpected_end_of_input) {
     src_padding_len += 1;
@@ -520,19 +528,16 @@ void logger::impl::point_out(const errors::error &err) const {
 
   std::string src_padding(src_padding_len, ' ');
 
-  // item could be multiple lines, so it gets the position of the line break
-  auto len = m_source.find('\n', err.position()) - err.position();
-  auto line = std::string{m_source.substr(err.position(), len)};
+  // item could be multiple lines, only the part on the first line gets pointed out
+  auto rest = std::string{line.substr(where.column - 1)};
 
   // clang-format off
-  line.erase(std::find_if(line.rbegin(), line.rend(), [](char c) {
-    return !std::isspace(c);
-  }).base(), line.end());
+  rest.erase(std::find_if(rest.rbegin(), rest.rend(), [](char c) {
+    return !std::isspace(static_cast<unsigned char>(c));
+  }).base(), rest.end());
   // clang-format on
 
-  // if it's only one line and m_source.find() returns string_view::npos, it gets
-  // err.length()
-  auto shortest = line.size() < err.length() ? line.size() : err.length();
+  auto shortest = rest.size() < err.length() ? rest.size() : err.length();
 
   // if the length is 1, a ^ is used. Otherwise, ~~~s are put
   auto point_out = colors::bold_red(shortest == 1 ? "^" : std::string(shortest, '~'));
@@ -556,33 +561,33 @@ void logger::impl::print_note(const errors::error &err) const {
   }
 }
 
-void logger::impl::error(std::unique_ptr<errors::error> err) { err->accept(*this); }
+void logger::impl::print(const errors::error &err) const {
+  auto &manager = util::source_manager::instance();
+  auto where = manager.location(err.file(), err.position());
+  auto begin = manager.line_start(err.file(), where.line);
+  auto end = manager.line_start(err.file(), where.line + 1);
+  auto line = m_source.substr(begin, end - begin);
 
-void logger::impl::visit(errors::token_error &err) {
-  print_start(err);
-  print_code(err);
-  point_out(err);
-  print_note(err);
-  std::cout << "\n";
-}
+  if (!line.empty() && line.back() == '\n') {
+    line.remove_suffix(1);
+  }
 
-void logger::impl::visit(errors::ast_error &err) {
   print_start(err);
-  print_code(err);
-  point_out(err);
+  print_code(where, line);
+  point_out(err, where, line);
   print_note(err);
   std::cout << "\n";
 }
 
-void logger::impl::visit(errors::type_error &err) {
-  print_start(err);
-  print_code(err);
-  point_out(err);
-  print_note(err);
-  std::cout << "\n";
-}
+void logger::impl::error(std::unique_ptr<errors::error> err) { err->accept(*this); }
+
+void logger::impl::visit(errors::token_error &err) { print(err); }
 
-void util::debug_print(std::vector<core::token> toks) {
+void logger::impl::visit(errors::ast_error &err) { print(err); }
+
+void logger::impl::visit(errors::type_error &err) { print(err); }
+
+void util::debug_print(const core::token_buffer &toks) {
   using namespace fmt::literals;
 
 #ifndef NDEBUG // code is removed during dead-code elimination phase if the macro is defined
@@ -590,15 +595,17 @@ void util::debug_print(std::vector<core::token> toks) {
     return;
   }
 
-  auto size = util::string_from_kind(toks.begin()->type()).size();
+  auto size = util::string_from_kind(toks.kind(0)).size();
 
-  for (auto &tok : toks) {
-    auto tok_size = util::string_from_kind(tok.type()).size();
+  // only the kinds are needed to figure out the padding
+  for (auto k : toks.kinds()) {
+    auto tok_size = util::string_from_kind(k).size();
 
     size = tok_size > size ? tok_size : size;
   }
 
-  for (auto &tok : toks) {
+  for (std::size_t i = 0; i < toks.size(); ++i) {
+    auto tok = toks[i];
     auto type = util::string_from_kind(tok.type());
 
     // the fill constructor for std::string is truly magical
@@ -621,25 +628,34 @@ void util::debug_print(std::vector<core::token> toks) {
 void util::debug_print(ast::node &node) {
 #ifndef NDEBUG
   printer printer;
+  auto flat = ast::flatten(node);
 
-  node.accept(printer);
+  ast::flat::decls(flat)[0].accept(printer);
 #else
   (void)node;
 #endif
 }
 
 void util::debug_print(ast::program &prog) {
+#ifndef NDEBUG
+  debug_print(ast::flatten(prog));
+#else
+  (void)prog;
+#endif
+}
+
+void util::debug_print(const ast::flat_program &prog) {
 #ifndef NDEBUG
   std::cout << "program: {\n";
 
   printer printer;
   printer.m_prefix += "  ";
 
-  for (auto &&decl : prog.decls()) {
+  for (auto decl : ast::flat::decls(prog)) {
     // need an initial prefix for all the nodes, since they assume they
     // get printed at the right column
     std::cout << "  ";
-    decl->accept(printer);
+    decl.accept(printer);
   }
 
   std::cout << "}\n";
@@ -25,6 +25,7 @@
 #define CASCADE_UTIL_LOGGING_HH
 
 #include "ast/ast.hh"
+#include "ast/flat.hh"
 #include "errors/error.hh"
 #include "errors/error_visitor.hh"
 #include <memory>
@@ -133,19 +134,28 @@ namespace cascade::util {
    * @brief Pretty-prints a list of tokens
    * @param toks The list to print
    */
-  void debug_print(std::vector<core::token> toks);
+  void debug_print(const core::token_buffer &toks);
 
   /**
    * @brief Pretty-prints an AST node recursively
+   * @details The node is flattened first, and printed the same way a flat program is
    * @param node The node to print
    */
   void debug_print(ast::node &node);
 
   /**
    * @brief Prints an entire AST
+   * @details Flattens @p prog and prints the flat form, see the overload below
    * @param prog The program to print
    */
   void debug_print(ast::program &prog);
+
+  /**
+   * @brief Prints an entire flat AST
+   * @details Runs over the flat arrays directly, no tree nodes are built
+   * @param prog The program to print
+   */
+  void debug_print(const ast::flat_program &prog);
 } // namespace cascade::util
 
 #endif
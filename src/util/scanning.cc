@@ -0,0 +1,573 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/scanning.cc:
+ *   Implements the scanning helpers with SSE2/AVX2 paths picked at runtime
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/scanning.hh"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CASCADE_HAS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace cascade;
+
+/** @brief One implementation of each of the scanning functions */
+struct scanner {
+  std::size_t (*skip_whitespace)(std::string_view, std::size_t);
+  std::size_t (*find_newline)(std::string_view, std::size_t);
+  std::size_t (*find_block_comment_end)(std::string_view, std::size_t);
+  util::source_scan (*scan_source)(std::string_view);
+};
+
+/** @brief Equivalent to `std::isspace` in the "C" locale, without the locale lookup */
+static bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+static std::size_t scalar_skip_whitespace(std::string_view source, std::size_t pos) {
+  while (pos < source.size() && is_space(source[pos])) {
+    ++pos;
+  }
+
+  return pos;
+}
+
+static std::size_t scalar_find_newline(std::string_view source, std::size_t pos) {
+  auto result = source.find('\n', pos);
+
+  return (result == std::string_view::npos) ? source.size() : result;
+}
+
+static std::size_t scalar_find_block_comment_end(std::string_view source, std::size_t pos) {
+  return source.find("*-", pos);
+}
+
+/**
+ * @brief Validates the UTF-8 sequence starting at @p pos
+ * @param source The source code
+ * @param pos The offset of the first byte of the sequence
+ * @return The offset right after the sequence, or `std::string_view::npos` if it's invalid
+ */
+static std::size_t scalar_next_char(std::string_view source, std::size_t pos) {
+  auto lead = static_cast<unsigned char>(source[pos]);
+
+  if (lead < 0x80) {
+    return pos + 1;
+  }
+
+  // 0x80-0xBF are continuation bytes, 0xC0 and 0xC1 could only start an overlong
+  // encoding and 0xF5+ would be past U+10FFFF
+  if (lead < 0xC2 || lead > 0xF4) {
+    return std::string_view::npos;
+  }
+
+  auto length = std::size_t{(lead < 0xE0) ? 2u : (lead < 0xF0) ? 3u : 4u};
+
+  if (pos + length > source.size()) {
+    return std::string_view::npos;
+  }
+
+  // the second byte's range is narrower after a few leads, that's what rules out
+  // overlong 3/4 byte encodings, surrogates and anything past U+10FFFF
+  auto low = 0x80;
+  auto high = 0xBF;
+
+  switch (lead) {
+    case 0xE0:
+      low = 0xA0;
+      break;
+    case 0xED:
+      high = 0x9F;
+      break;
+    case 0xF0:
+      low = 0x90;
+      break;
+    case 0xF4:
+      high = 0x8F;
+      break;
+  }
+
+  auto second = static_cast<unsigned char>(source[pos + 1]);
+
+  if (second < low || second > high) {
+    return std::string_view::npos;
+  }
+
+  for (auto i = std::size_t{2}; i < length; ++i) {
+    if ((static_cast<unsigned char>(source[pos + i]) & 0xC0) != 0x80) {
+      return std::string_view::npos;
+    }
+  }
+
+  return pos + length;
+}
+
+/**
+ * @brief Validates everything from @p pos onwards one sequence at a time
+ * @param source The source code
+ * @param pos Where to start, must be the start of a sequence
+ * @param has_cr Whether a CR was already seen before @p pos
+ * @return The scan result for the whole source
+ */
+static util::source_scan scalar_scan_from(std::string_view source,
+    std::size_t pos,
+    bool has_cr) {
+  while (pos < source.size()) {
+    has_cr = has_cr || source[pos] == '\r';
+    pos = scalar_next_char(source, pos);
+
+    if (pos == std::string_view::npos) {
+      return {false, has_cr};
+    }
+  }
+
+  return {true, has_cr};
+}
+
+static util::source_scan scalar_scan_source(std::string_view source) {
+  return scalar_scan_from(source, 0, false);
+}
+
+#ifdef CASCADE_HAS_X86_SIMD
+// every one of these loops over full-width blocks, and leaves the tail (less than one
+// block) to the scalar version. nothing is ever read past the end of `source`
+
+__attribute__((target("sse2"))) static unsigned whitespace_mask_sse2(__m128i chunk) {
+  // '\t' through '\r' are contiguous, so (c - '\t') <= 4 (unsigned) catches all of them
+  auto shifted = _mm_sub_epi8(chunk, _mm_set1_epi8('\t'));
+  auto is_ctrl = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+  auto is_space = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(is_ctrl, is_space)));
+}
+
+__attribute__((target("sse2"))) static std::size_t sse2_skip_whitespace(std::string_view source,
+    std::size_t pos) {
+  for (; pos + 16 <= source.size(); pos += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + pos));
+    auto mask = whitespace_mask_sse2(chunk);
+
+    if (mask != 0xFFFF) {
+      return pos + __builtin_ctz(~mask);
+    }
+  }
+
+  return scalar_skip_whitespace(source, pos);
+}
+
+__attribute__((target("sse2"))) static std::size_t sse2_find_newline(std::string_view source,
+    std::size_t pos) {
+  for (; pos + 16 <= source.size(); pos += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + pos));
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+
+  return scalar_find_newline(source, pos);
+}
+
+__attribute__((target("sse2"))) static std::size_t sse2_find_block_comment_end(
+    std::string_view source,
+    std::size_t pos) {
+  // the second load is offset by one, so the block needs an extra byte after it
+  for (; pos + 17 <= source.size(); pos += 16) {
+    auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + pos));
+    auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + pos + 1));
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, _mm_set1_epi8('*')),
+            _mm_cmpeq_epi8(second, _mm_set1_epi8('-')))));
+
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+
+  return scalar_find_block_comment_end(source, pos);
+}
+
+__attribute__((target("sse2"))) static util::source_scan sse2_scan_source(
+    std::string_view source) {
+  auto pos = std::size_t{0};
+  auto crs = _mm_setzero_si128();
+
+  // sse2 doesn't have a byte shuffle for the lookup tables the avx2 version uses, so
+  // only runs of ASCII are done 16 bytes at a time. anything else is checked one
+  // sequence at a time until it's past the block
+  while (pos + 16 <= source.size()) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source.data() + pos));
+    crs = _mm_or_si128(crs, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+
+    if (_mm_movemask_epi8(chunk) == 0) {
+      pos += 16;
+
+      continue;
+    }
+
+    // every CR in [pos, pos + 16) was already seen, and sequences never contain one
+    for (auto end = pos + 16; pos < end;) {
+      pos = scalar_next_char(source, pos);
+
+      if (pos == std::string_view::npos) {
+        return {false, _mm_movemask_epi8(crs) != 0};
+      }
+    }
+  }
+
+  return scalar_scan_from(source, pos, _mm_movemask_epi8(crs) != 0);
+}
+
+__attribute__((target("avx2"))) static unsigned whitespace_mask_avx2(__m256i chunk) {
+  auto shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8('\t'));
+  auto is_ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+  auto is_space = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '));
+
+  return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(is_ctrl, is_space)));
+}
+
+__attribute__((target("avx2"))) static std::size_t avx2_skip_whitespace(std::string_view source,
+    std::size_t pos) {
+  for (; pos + 32 <= source.size(); pos += 32) {
+    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos));
+    auto mask = whitespace_mask_avx2(chunk);
+
+    if (mask != 0xFFFFFFFF) {
+      return pos + __builtin_ctz(~mask);
+    }
+  }
+
+  return sse2_skip_whitespace(source, pos);
+}
+
+__attribute__((target("avx2"))) static std::size_t avx2_find_newline(std::string_view source,
+    std::size_t pos) {
+  for (; pos + 32 <= source.size(); pos += 32) {
+    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos));
+    auto mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+
+  return sse2_find_newline(source, pos);
+}
+
+__attribute__((target("avx2"))) static std::size_t avx2_find_block_comment_end(
+    std::string_view source,
+    std::size_t pos) {
+  for (; pos + 33 <= source.size(); pos += 32) {
+    auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos));
+    auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos + 1));
+    auto mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, _mm256_set1_epi8('*')),
+            _mm256_cmpeq_epi8(second, _mm256_set1_epi8('-')))));
+
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+
+  return sse2_find_block_comment_end(source, pos);
+}
+
+// the avx2 UTF-8 validator is the lookup algorithm from Keiser & Lemire, "Validating
+// UTF-8 In Less Than One Instruction Per Byte". every error that involves two
+// bytes is one bit, the high nibble of the first byte, the low nibble of the first
+// byte and the high nibble of the second byte each get looked up in a table of which
+// errors they could be part of. any bit still set after and-ing the three is an error.
+// the only thing that needs more than two bytes is making sure the 3rd/4th bytes of a
+// sequence are continuations, and that's checked separately
+
+static constexpr std::uint8_t too_short = 1 << 0;      // 11______ 0_______, 11______ 11______
+static constexpr std::uint8_t too_long = 1 << 1;       // 0_______ 10______
+static constexpr std::uint8_t overlong_3 = 1 << 2;     // 11100000 100_____
+static constexpr std::uint8_t too_large = 1 << 3;      // 11110100 1001____ and above
+static constexpr std::uint8_t surrogate = 1 << 4;      // 11101101 101_____
+static constexpr std::uint8_t overlong_2 = 1 << 5;     // 1100000_ 10______
+static constexpr std::uint8_t overlong_4 = 1 << 6;     // 11110000 1000____
+static constexpr std::uint8_t too_large_1000 = 1 << 6; // 11110101 1000____ and above
+static constexpr std::uint8_t two_conts = 1 << 7;      // 10______ 10______
+
+// errors that don't depend on the low nibble of the first byte
+static constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+static constexpr std::uint8_t byte_1_high[16] = {
+    // 0_______: ASCII
+    too_long,
+    too_long,
+    too_long,
+    too_long,
+    too_long,
+    too_long,
+    too_long,
+    too_long,
+    // 10______: continuation
+    two_conts,
+    two_conts,
+    two_conts,
+    two_conts,
+    // 1100____, 1101____: 2 byte lead
+    too_short | overlong_2,
+    too_short,
+    // 1110____: 3 byte lead
+    too_short | overlong_3 | surrogate,
+    // 1111____: 4 byte lead
+    too_short | too_large | too_large_1000 | overlong_4,
+};
+
+static constexpr std::uint8_t byte_1_low[16] = {
+    carry | overlong_3 | overlong_2 | overlong_4, // ____0000
+    carry | overlong_2,                           // ____0001
+    carry,                                        // ____001_
+    carry,
+    carry | too_large,                  // ____0100
+    carry | too_large | too_large_1000, // ____0101
+    carry | too_large | too_large_1000, // ____011_
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000, // ____1___
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000 | surrogate, // ____1101
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+};
+
+static constexpr std::uint8_t byte_2_high[16] = {
+    // 0_______: ASCII
+    too_short,
+    too_short,
+    too_short,
+    too_short,
+    too_short,
+    too_short,
+    too_short,
+    too_short,
+    // 1000____
+    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+    // 1001____
+    too_long | overlong_2 | two_conts | overlong_3 | too_large,
+    // 101_____
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    // 11______
+    too_short,
+    too_short,
+    too_short,
+    too_short,
+};
+
+/**
+ * @brief Builds the values a block is compared against to see if it ends mid-sequence
+ * @details Anything greater than these is a lead byte that needs more bytes than are
+ * left in the block, so a saturating subtract leaves something nonzero
+ */
+static constexpr std::array<std::uint8_t, 32> build_incomplete_limits() {
+  std::array<std::uint8_t, 32> limits{};
+
+  for (auto &limit : limits) {
+    limit = 0xFF;
+  }
+
+  limits[29] = 0b11110000 - 1;
+  limits[30] = 0b11100000 - 1;
+  limits[31] = 0b11000000 - 1;
+
+  return limits;
+}
+
+static constexpr auto incomplete_limits = build_incomplete_limits();
+
+/** @brief The state carried from one block to the next by the avx2 validator */
+struct utf8_blocks {
+  /** @brief Any error seen so far, nonzero means invalid */
+  __m256i error;
+
+  /** @brief The previous block */
+  __m256i previous;
+
+  /** @brief Nonzero if the previous block ended in the middle of a sequence */
+  __m256i incomplete;
+
+  /** @brief Every CR seen so far */
+  __m256i crs;
+};
+
+__attribute__((target("avx2"))) static __m256i lookup_avx2(const std::uint8_t (&table)[16],
+    __m256i nibbles) {
+  auto half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table));
+
+  return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(half), nibbles);
+}
+
+/** @brief Shifts @p input right by N bytes, filling in from the end of @p previous */
+template <int N>
+__attribute__((target("avx2"))) static __m256i shift_in_avx2(__m256i input, __m256i previous) {
+  return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2"))) static void validate_block_avx2(__m256i input,
+    utf8_blocks &state) {
+  state.crs = _mm256_or_si256(state.crs, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\r')));
+
+  if (_mm256_movemask_epi8(input) == 0) {
+    // ASCII can't continue a sequence, so the last block had to be complete
+    state.error = _mm256_or_si256(state.error, state.incomplete);
+    state.incomplete = _mm256_setzero_si256();
+    state.previous = input;
+
+    return;
+  }
+
+  auto low_nibble = _mm256_set1_epi8(0x0F);
+  auto prev1 = shift_in_avx2<1>(input, state.previous);
+  auto prev1_high = _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble);
+  auto prev1_low = _mm256_and_si256(prev1, low_nibble);
+  auto input_high = _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble);
+  auto special = _mm256_and_si256(
+      _mm256_and_si256(lookup_avx2(byte_1_high, prev1_high), lookup_avx2(byte_1_low, prev1_low)),
+      lookup_avx2(byte_2_high, input_high));
+
+  // only 111_____ two bytes back or 1111____ three bytes back end up >= 0x80, those are
+  // the bytes that must be continuations. the lookup already flagged every
+  // continuation after another continuation as two_conts, those cancel out here
+  auto prev2 = shift_in_avx2<2>(input, state.previous);
+  auto prev3 = shift_in_avx2<3>(input, state.previous);
+  auto is_third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+  auto is_fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+  auto must_continue = _mm256_and_si256(_mm256_or_si256(is_third, is_fourth),
+      _mm256_set1_epi8(static_cast<char>(0x80)));
+
+  state.error = _mm256_or_si256(state.error, _mm256_xor_si256(must_continue, special));
+  state.incomplete = _mm256_subs_epu8(input,
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(incomplete_limits.data())));
+  state.previous = input;
+}
+
+__attribute__((target("avx2"))) static util::source_scan avx2_scan_source(
+    std::string_view source) {
+  auto state = utf8_blocks{_mm256_setzero_si256(),
+      _mm256_setzero_si256(),
+      _mm256_setzero_si256(),
+      _mm256_setzero_si256()};
+  auto pos = std::size_t{0};
+
+  // source code is nearly all ASCII, so 64 bytes at a time get checked for that first
+  for (; pos + 64 <= source.size(); pos += 64) {
+    auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos));
+    auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos + 32));
+
+    if (_mm256_movemask_epi8(_mm256_or_si256(first, second)) != 0) {
+      validate_block_avx2(first, state);
+      validate_block_avx2(second, state);
+
+      continue;
+    }
+
+    auto cr = _mm256_set1_epi8('\r');
+    auto crs = _mm256_or_si256(_mm256_cmpeq_epi8(first, cr), _mm256_cmpeq_epi8(second, cr));
+
+    state.crs = _mm256_or_si256(state.crs, crs);
+    state.error = _mm256_or_si256(state.error, state.incomplete);
+    state.incomplete = _mm256_setzero_si256();
+    state.previous = second;
+  }
+
+  for (; pos + 32 <= source.size(); pos += 32) {
+    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source.data() + pos));
+
+    validate_block_avx2(chunk, state);
+  }
+
+  // the tail is padded with NULs, those are ASCII so they end any sequence that's
+  // cut short by the end of the source
+  if (pos < source.size()) {
+    char tail[32] = {};
+    std::memcpy(tail, source.data() + pos, source.size() - pos);
+
+    validate_block_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail)), state);
+  }
+
+  auto error = _mm256_or_si256(state.error, state.incomplete);
+
+  return {_mm256_testz_si256(error, error) != 0, _mm256_movemask_epi8(state.crs) != 0};
+}
+#endif
+
+/**
+ * @brief Picks the widest implementation the CPU running the compiler supports
+ * @return The scanner to use
+ */
+static scanner select_scanner() {
+#ifdef CASCADE_HAS_X86_SIMD
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return {avx2_skip_whitespace,
+        avx2_find_newline,
+        avx2_find_block_comment_end,
+        avx2_scan_source};
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    return {sse2_skip_whitespace,
+        sse2_find_newline,
+        sse2_find_block_comment_end,
+        sse2_scan_source};
+  }
+#endif
+
+  return {scalar_skip_whitespace,
+      scalar_find_newline,
+      scalar_find_block_comment_end,
+      scalar_scan_source};
+}
+
+/** @brief Returns the scanner picked for this machine, only selected once */
+static const scanner &active_scanner() {
+  static const scanner selected = select_scanner();
+
+  return selected;
+}
+
+std::size_t util::skip_whitespace(std::string_view source, std::size_t pos) {
+  return active_scanner().skip_whitespace(source, pos);
+}
+
+std::size_t util::find_newline(std::string_view source, std::size_t pos) {
+  return active_scanner().find_newline(source, pos);
+}
+
+std::size_t util::find_block_comment_end(std::string_view source, std::size_t pos) {
+  return active_scanner().find_block_comment_end(source, pos);
+}
+
+util::source_scan util::scan_source(std::string_view source) {
+  return active_scanner().scan_source(source);
+}
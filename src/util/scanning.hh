@@ -0,0 +1,76 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/scanning.hh:
+ *   Declares vectorized helpers for skipping over runs of source text
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_UTIL_SCANNING_HH
+#define CASCADE_UTIL_SCANNING_HH
+
+#include <cstddef>
+#include <string_view>
+
+namespace cascade::util {
+  /** @brief What `scan_source` found out about a source */
+  struct source_scan {
+    /** @brief Whether the source is valid UTF-8 */
+    bool valid_utf8;
+
+    /** @brief Whether the source contains a '\r' anywhere, only set if it's valid */
+    bool has_cr;
+  };
+
+  /**
+   * @brief Finds the first non-whitespace character at or after @p pos
+   * @details "Whitespace" is the same set of characters `std::isspace` accepts
+   * in the "C" locale
+   * @param source The source code to scan
+   * @param pos The offset to begin scanning at
+   * @return The offset of the character, or `source.size()` if there isn't one
+   */
+  std::size_t skip_whitespace(std::string_view source, std::size_t pos);
+
+  /**
+   * @brief Finds the first '\n' at or after @p pos
+   * @param source The source code to scan
+   * @param pos The offset to begin scanning at
+   * @return The offset of the newline, or `source.size()` if there isn't one
+   */
+  std::size_t find_newline(std::string_view source, std::size_t pos);
+
+  /**
+   * @brief Finds the first `*-` (the end of a block comment) at or after @p pos
+   * @param source The source code to scan
+   * @param pos The offset to begin scanning at
+   * @return The offset of the '*', or `std::string_view::npos` if there isn't one
+   */
+  std::size_t find_block_comment_end(std::string_view source, std::size_t pos);
+
+  /**
+   * @brief Validates @p source as UTF-8 and looks for '\r's in the same pass
+   * @details Overlong encodings, surrogates, code points past U+10FFFF and
+   * truncated sequences are all rejected
+   * @param source The source code to scan
+   * @return Whether the source is valid and whether it has any CRs
+   */
+  source_scan scan_source(std::string_view source);
+} // namespace cascade::util
+
+#endif
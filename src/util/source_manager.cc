@@ -0,0 +1,80 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/source_manager.cc:
+ *   Implements the `source_manager` class
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/source_manager.hh"
+#include "util/scanning.hh"
+#include <algorithm>
+#include <cassert>
+
+using namespace cascade::util;
+
+source_manager &source_manager::instance() {
+  static source_manager manager;
+
+  return manager;
+}
+
+file_id source_manager::add(file_source file) {
+  // source_info stores 32-bit offsets/lengths into the file, the source readers
+  // reject anything bigger than that
+  assert(file.source().size() <= max_source_size && "files need to be smaller than 4GiB");
+
+  m_files.emplace_back(std::move(file));
+
+  return static_cast<file_id>(m_files.size() - 1);
+}
+
+const std::vector<std::uint32_t> &source_manager::line_starts(file_id id) const {
+  auto &registered = m_files[id];
+
+  std::call_once(registered.indexed, [&registered] {
+    auto source = registered.file.source();
+
+    registered.line_starts.push_back(0);
+
+    for (auto pos = util::find_newline(source, 0); pos != source.size();
+         pos = util::find_newline(source, pos + 1)) {
+      registered.line_starts.push_back(static_cast<std::uint32_t>(pos + 1));
+    }
+  });
+
+  return registered.line_starts;
+}
+
+source_location source_manager::location(file_id id, std::size_t offset) const {
+  auto &starts = line_starts(id);
+
+  // the first line starting *after* the offset is one past the line it's on
+  auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+  auto line = static_cast<std::size_t>(it - starts.begin());
+
+  return {line, (offset - starts[line - 1]) + 1};
+}
+
+std::size_t source_manager::line_start(file_id id, std::size_t line) const {
+  auto &starts = line_starts(id);
+
+  assert(line != 0 && line <= starts.size() + 1 && "line is out of range");
+
+  return (line <= starts.size()) ? starts[line - 1] : source(id).size();
+}
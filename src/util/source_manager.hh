@@ -0,0 +1,149 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/source_manager.hh:
+ *   Defines the `source_manager` that owns every source file being compiled
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_UTIL_SOURCE_MANAGER_HH
+#define CASCADE_UTIL_SOURCE_MANAGER_HH
+
+#include "util/mixins.hh"
+#include "util/source_reader.hh"
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cascade::util {
+  /** @brief Compact handle to a file owned by the source_manager */
+  using file_id = std::uint32_t;
+
+  /** @brief A resolved line/column pair, both start at 1 */
+  struct source_location {
+    std::size_t line;
+    std::size_t column;
+  };
+
+  /**
+   * @brief Owns the path and source code of every file being compiled
+   * @details Anything that needs to refer back to a file (tokens, AST nodes, errors)
+   * just stores a `file_id` and asks the manager for the rest. Files are never
+   * removed, so references and string_views handed out stay valid for the
+   * rest of the program.
+   *
+   * Nothing but byte offsets are stored for locations, line/column are only
+   * resolved when something (diagnostics, debug info) actually needs them.
+   */
+  class source_manager : noncopyable {
+    /** @brief A registered file and its line index */
+    struct entry {
+      /** @brief The file itself */
+      file_source file;
+
+      /** @brief Guards the lazy construction of `line_starts` */
+      mutable std::once_flag indexed;
+
+      /** @brief Offset of the first character of each line, built on first use */
+      mutable std::vector<std::uint32_t> line_starts;
+
+      explicit entry(file_source source) : file(std::move(source)) {}
+    };
+
+    /** @brief Every registered file, indexed by file_id. deque never moves elements */
+    std::deque<entry> m_files;
+
+    /**
+     * @brief Returns the line-start table for a file, building it if it isn't yet
+     * @param id The ID of the file
+     * @return The offset each line starts at
+     */
+    [[nodiscard]] const std::vector<std::uint32_t> &line_starts(file_id id) const;
+
+    /** @brief Only the global instance can exist */
+    source_manager() = default;
+
+  public:
+    /**
+     * @brief Returns the global source manager
+     * @return The source manager
+     */
+    static source_manager &instance();
+
+    /**
+     * @brief Takes ownership of a file
+     * @param file The file to register, no bigger than `max_source_size`
+     * @return The ID to refer to the file with
+     */
+    file_id add(file_source file);
+
+    /**
+     * @brief Returns a registered file
+     * @param id The ID of the file
+     * @return The file
+     */
+    [[nodiscard]] const file_source &file(file_id id) const { return m_files[id].file; }
+
+    /**
+     * @brief Returns the source code of a registered file
+     * @param id The ID of the file
+     * @return A string_view to the source
+     */
+    [[nodiscard]] std::string_view source(file_id id) const { return file(id).source(); }
+
+    /**
+     * @brief Returns the path of a registered file
+     * @param id The ID of the file
+     * @return The path
+     */
+    [[nodiscard]] const std::filesystem::path &path(file_id id) const { return file(id).path(); }
+
+    /**
+     * @brief Returns the module a registered file is in
+     * @param id The ID of the file
+     * @return The module name, empty if the file wasn't given one
+     */
+    [[nodiscard]] const std::string &module(file_id id) const { return file(id).module(); }
+
+    /**
+     * @brief Resolves a byte offset into a line and column
+     * @details The first call for a file scans it for newlines, every call
+     * after that is a binary search. Safe to call from multiple threads.
+     * @param id The ID of the file
+     * @param offset The offset into the file's source
+     * @return The line/column of @p offset
+     */
+    [[nodiscard]] source_location location(file_id id, std::size_t offset) const;
+
+    /**
+     * @brief Returns the offset of the first character of a line
+     * @details @p line can be one past the last line, which gives the size of the
+     * source. That way the line after any line is where it ends
+     * @param id The ID of the file
+     * @param line The line, starts at 1
+     * @return The offset the line starts at
+     */
+    [[nodiscard]] std::size_t line_start(file_id id, std::size_t line) const;
+  };
+} // namespace cascade::util
+
+#endif
@@ -23,92 +23,462 @@
 
 #include "util/source_reader.hh"
 #include "util/logging.hh"
+#include "util/scanning.hh"
+#include "util/thread_pool.hh"
 #include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
 #include <filesystem>
 #include <fstream>
-#include <stdexcept>
+#include <future>
+#include <iterator>
+#include <string>
+
+#if defined(PLATFORM_POSIX) || defined(__linux__) || defined(__unix__)
+#define CASCADE_IS_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <iostream>
+#endif
 
 using namespace cascade::util;
 using opt_file_list = file_reader::opt_file_list;
 using options = file_reader::options;
 namespace fs = std::filesystem;
 
-void cascade::util::normalize(file_source &ref) {
-  ref.m_path = ref.m_path.lexically_normal().lexically_relative(fs::current_path());
+file_source::file_source(std::filesystem::path path, std::string source) : m_path(std::move(path)) {
+  // the string lives on the heap, so the view stays put when the file_source moves
+  auto owned = std::make_shared<const std::string>(std::move(source));
 
-  // transform CRLF into LF
-  ref.m_source.erase(std::remove(ref.m_source.begin(), ref.m_source.end(), '\r'),
-      ref.m_source.end());
+  m_source = *owned;
+  m_storage = std::shared_ptr<const char>(owned, owned->data());
 }
 
+#ifdef CASCADE_IS_POSIX
 /**
- * @brief Checks if an input string is valid UTF-8
- * @param str A string_view to the string to check
- * @return Whether or not the string is valid UTF-8
+ * @brief Maps everything in a file descriptor into memory
+ * @param fd The descriptor, it can be closed as soon as this returns
+ * @param path The path to give the file
+ * @param size The size of the file, from the fstat the caller already did
+ * @return The file, or nothing if it couldn't be mapped
  */
-[[nodiscard]] static bool is_valid_utf8(std::string_view str) {
-#pragma message("is_valid_utf8: always returns true!")
+static std::optional<file_source> map_descriptor(int fd, fs::path path, std::size_t size) {
+  // mmap can't map 0 bytes
+  if (size == 0) {
+    return file_source(std::move(path), std::string());
+  }
 
-  (void)str;
+  auto flags = MAP_PRIVATE;
 
-  return true;
+#ifdef MAP_POPULATE
+  // the whole file is about to be read, fault it all in now instead of a page at a time
+  flags |= MAP_POPULATE;
+#endif
+
+  auto data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+
+  if (data == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  ::madvise(data, size, MADV_SEQUENTIAL);
+
+  auto storage = std::shared_ptr<const char>(static_cast<const char *>(data),
+      [size](const char *ptr) { ::munmap(const_cast<char *>(ptr), size); });
+  auto source = std::string_view(storage.get(), size);
+
+  return file_source(std::move(path), std::move(storage), source);
 }
 
-#include <iostream>
+/**
+ * @brief Reads everything left in a file descriptor with read(2)
+ * @param fd The descriptor
+ * @return Everything that was read, or nothing if reading failed
+ */
+static std::optional<std::string> read_descriptor(int fd) {
+  // doubling keeps the number of reads (and reallocations) logarithmic in the size
+  std::string buffer(std::size_t{1} << 16, '\0');
+  auto used = std::size_t{0};
+
+  while (true) {
+    if (used == buffer.size()) {
+      buffer.resize(buffer.size() * 2);
+    }
+
+    auto count = ::read(fd, buffer.data() + used, buffer.size() - used);
+
+    if (count == 0) {
+      break;
+    }
+
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return std::nullopt;
+    }
+
+    used += static_cast<std::size_t>(count);
+  }
+
+  buffer.resize(used);
+
+  return buffer;
+}
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+/**
+ * @brief Moves everything in a pipe into a memfd and maps it
+ * @details The data goes from the pipe into the page cache without ever being
+ * copied through userspace, and the mapping reads it straight from there
+ * @param fd The pipe
+ * @param path The path to give the file
+ * @param failed Set if reading failed after some data was already moved, the
+ * data that was moved can't be read any other way
+ * @return The file, or nothing if @p fd couldn't be spliced
+ */
+static std::optional<file_source> splice_descriptor(int fd, fs::path path, bool &failed) {
+  auto memfd = ::memfd_create("cascade-stdin", MFD_CLOEXEC);
+
+  if (memfd < 0) {
+    return std::nullopt;
+  }
+
+  auto total = std::size_t{0};
+  auto count = ::ssize_t{0};
+
+  while ((count = ::splice(fd, nullptr, memfd, nullptr, std::size_t{1} << 20, SPLICE_F_MOVE))
+         != 0) {
+    if (count < 0 && errno != EINTR) {
+      break;
+    }
+
+    total += (count > 0) ? static_cast<std::size_t>(count) : 0;
+  }
+
+  failed = count < 0 && total != 0;
+
+  auto result = (count == 0) ? map_descriptor(memfd, std::move(path), total) : std::nullopt;
+
+  ::close(memfd);
+
+  return result;
+}
+#endif
+#endif
+
+/**
+ * @brief Reads all of stdin
+ * @param path The path to give the file
+ * @return The file, or nothing if stdin couldn't be read
+ */
+static std::optional<file_source> read_stdin(fs::path path) {
+#ifdef CASCADE_IS_POSIX
+  struct stat info;
+  auto known = ::fstat(STDIN_FILENO, &info) == 0;
+
+  // `cascade < file` doesn't need to go through a pipe at all
+  if (known && S_ISREG(info.st_mode)) {
+    return map_descriptor(STDIN_FILENO,
+        std::move(path),
+        static_cast<std::size_t>(info.st_size));
+  }
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+  if (known && S_ISFIFO(info.st_mode)) {
+    auto failed = false;
+
+    if (auto result = splice_descriptor(STDIN_FILENO, path, failed); result || failed) {
+      return result;
+    }
+  }
+#endif
+
+  if (auto buffer = read_descriptor(STDIN_FILENO); buffer) {
+    return file_source(std::move(path), std::move(buffer.value()));
+  }
+
+  return std::nullopt;
+#else
+  std::string buffer(std::istreambuf_iterator<char>(std::cin), {});
+
+  return file_source(std::move(path), std::move(buffer));
+#endif
+}
+
+/**
+ * @brief Opens and maps one file, checking that it's something that can be compiled
+ * @param path The absolute path of the file
+ * @param error Set to why the file couldn't be loaded, if it couldn't be
+ * @return The file, or nothing if it couldn't be loaded
+ */
+static std::optional<file_source> load(fs::path path, std::string &error) {
+#ifdef CASCADE_IS_POSIX
+  // O_NONBLOCK stops a FIFO from blocking the open, it's rejected by the fstat after
+  auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+
+  if (fd < 0) {
+    error = (errno == ENOENT || errno == ENOTDIR) ? "No such file or directory!"
+                                                  : "Unable to open file!";
+
+    return std::nullopt;
+  }
+
+  struct stat info;
+  std::optional<file_source> result;
+
+  // compiler doesn't deal w/ binary files, or with symlinks/pipes/whatever
+  if (::fstat(fd, &info) != 0) {
+    error = "Unable to open file!";
+  } else if (!S_ISREG(info.st_mode)) {
+    error = "File is not a regular file!";
+  } else if (static_cast<std::uintmax_t>(info.st_size) > max_source_size) {
+    error = "File is larger than 4GiB!";
+  } else {
+    result = map_descriptor(fd, std::move(path), static_cast<std::size_t>(info.st_size));
+
+    if (!result) {
+      error = "Unable to open file!";
+    }
+  }
+
+  // the mapping keeps the file alive on its own
+  ::close(fd);
+
+  return result;
+#else
+  if (!fs::exists(path)) {
+    error = "No such file or directory!";
+
+    return std::nullopt;
+  }
+
+  if (!fs::is_regular_file(path)) {
+    error = "File is not a regular file!";
+
+    return std::nullopt;
+  }
+
+  if (fs::file_size(path) > max_source_size) {
+    error = "File is larger than 4GiB!";
+
+    return std::nullopt;
+  }
+
+  std::ifstream stream(path, std::ios::binary);
+
+  if (!stream.is_open()) {
+    error = "Unable to open file!";
+
+    return std::nullopt;
+  }
+
+  std::string str;
+  stream.seekg(0, std::ios_base::end);
+  str.resize(static_cast<std::size_t>(stream.tellg()));
+  stream.seekg(0, std::ios::beg);
+  stream.read(str.data(), static_cast<std::streamsize>(str.size()));
+
+  return file_source(std::move(path), std::move(str));
+#endif
+}
+
+std::optional<file_source> file_source::map(std::filesystem::path path) {
+  std::string error;
+
+  return load(std::move(path), error);
+}
+
+bool cascade::util::normalize(file_source &ref, const std::filesystem::path &base) {
+  ref.m_path = ref.m_path.lexically_normal().lexically_relative(base);
+
+  auto scan = util::scan_source(ref.m_source);
+
+  if (!scan.valid_utf8) {
+    return false;
+  }
+
+  // transform CRLF into LF. most files don't have any, those keep pointing into the mapping
+  if (scan.has_cr) {
+    std::string copy;
+    copy.reserve(ref.m_source.size());
+    std::remove_copy(ref.m_source.begin(), ref.m_source.end(), std::back_inserter(copy), '\r');
+
+    ref = file_source(std::move(ref.m_path), std::move(copy));
+  }
+
+  ref.m_hash = util::hash_bytes(ref.m_source);
+
+  return true;
+}
 
 opt_file_list file_reader::read(options &opts) {
+  thread_pool pool;
+
+  return read(opts, pool);
+}
+
+opt_file_list file_reader::read(options &opts, thread_pool &pool) {
+  // small enough that thousands of tiny files still spread over every thread,
+  // big enough that it isn't one task per file
+  constexpr auto batch_size = std::size_t{32};
+
+  struct loaded {
+    std::optional<file_source> source;
+    std::string error;
+  };
+
+  auto &paths = opts.files();
+  auto &modules = opts.modules();
+  auto cwd = fs::current_path();
+
+  auto load_batch = [&paths, &modules, &cwd](std::size_t begin, std::size_t end) {
+    std::vector<loaded> results(end - begin);
+
+    for (auto i = begin; i < end; ++i) {
+      auto &result = results[i - begin];
+
+      // same as fs::absolute, without asking the OS for the working directory every time
+      result.source = load(cwd / paths[i], result.error);
+
+      if (result.source && !normalize(result.source.value(), cwd)) {
+        result.source = std::nullopt;
+        result.error = "File is not valid UTF-8!";
+      } else if (result.source) {
+        result.source->set_module(modules[i]);
+      }
+    }
+
+    return results;
+  };
+
+  std::vector<std::future<std::vector<loaded>>> batches;
+
+  for (std::size_t begin = 0; begin < paths.size(); begin += batch_size) {
+    auto end = std::min(begin + batch_size, paths.size());
+
+    batches.emplace_back(pool.submit([load_batch, begin, end] { return load_batch(begin, end); }));
+  }
+
   std::vector<file_source> sources;
+  sources.reserve(paths.size());
 
-  // if any files have an error, no file contents are returned
+  // if any files have an error, no file contents are returned. every error is still
+  // reported though, in the order the files were given
   auto had_error = false;
+  auto index = std::size_t{0};
 
-  for (auto &file_path : opts.files()) {
-    fs::path path(fs::absolute(file_path));
+  for (auto &batch : batches) {
+    pool.wait(batch);
 
-    // user could pass a non-existent path
-    if (!fs::exists(path)) {
-      had_error = true;
-      util::error(file_path + ": No such file or directory!");
+    for (auto &result : batch.get()) {
+      if (result.source) {
+        sources.push_back(std::move(result.source.value()));
+      } else {
+        had_error = true;
+        util::error(paths[index] + ": " + result.error);
+      }
 
-      continue;
+      ++index;
     }
+  }
 
-    // compiler doesn't deal w/ binary files, or with symlinks/pipes/whatever
-    if (!fs::is_regular_file(path)) {
-      had_error = true;
-      util::error(file_path + ": File is not a regular file!");
+  if (had_error) {
+    return std::nullopt;
+  } else {
+    return sources;
+  }
+}
+
+/**
+ * @brief Splits framed input into the files inside of it
+ * @param input Everything that was read, see `pipe_reader` for the format
+ * @param files Where to put the files, they share storage with @p input
+ * @return Whether the input was well-formed
+ */
+static bool split_frames(const file_source &input, std::vector<file_source> &files) {
+  auto source = input.source();
+  auto pos = std::size_t{0};
+
+  while (pos < source.size()) {
+    if (source[pos] == '\n') {
+      ++pos;
 
       continue;
     }
 
-    std::ifstream stream(file_path);
+    auto newline = source.find('\n', pos);
+    auto header = source.substr(pos, newline - pos);
+    auto space = header.find(' ');
+    auto length = std::size_t{0};
+    auto valid = newline != std::string_view::npos && space != std::string_view::npos
+                 && space + 1 != header.size();
 
-    if (!stream.is_open()) {
-      had_error = true;
-      util::error(file_path + ": Unable to open file!");
-      stream.close();
+    if (valid) {
+      auto [end, ec] = std::from_chars(header.data(), header.data() + space, length);
 
-      continue;
+      valid = ec == std::errc{} && end == header.data() + space;
     }
 
-    std::string str;
-    stream.seekg(0, std::ios_base::end);
-    auto length = stream.tellg();
-    str.resize(length);
+    if (!valid) {
+      error("<stdin>: Expected a '<length> <path>' header at offset " + std::to_string(pos) + "!");
 
-    std::cout << "length: " << length << "\n";
+      return false;
+    }
 
-    stream.seekg(0, std::ios::beg);
-    stream.read(str.data(), length);
+    auto path = header.substr(space + 1);
+    auto begin = newline + 1;
 
-    if (!is_valid_utf8(str)) {
-      had_error = true;
-      util::error(file_path + ": File is not valid UTF-8!");
+    if (length > source.size() - begin) {
+      error("<stdin>: '" + std::string(path) + "' is " + std::to_string(length)
+            + " bytes long, but the input ends after " + std::to_string(source.size() - begin)
+            + "!");
 
-      continue;
+      return false;
     }
 
-    sources.emplace_back(std::move(path), std::move(str));
+    files.push_back(input.slice(fs::absolute(path), begin, length));
+    pos = begin + length;
+  }
+
+  return true;
+}
+
+opt_file_list pipe_reader::read(options &opts) {
+  auto input = read_stdin(fs::absolute("<stdin>"));
+
+  if (!input) {
+    util::error("<stdin>: Unable to read piped input!");
+
+    return std::nullopt;
+  }
+
+  std::vector<file_source> sources;
+
+  if (!opts.framed()) {
+    sources.push_back(std::move(input.value()));
+  } else if (!split_frames(input.value(), sources)) {
+    return std::nullopt;
+  }
+
+  // same as file_reader, one bad file means nothing is returned
+  auto had_error = false;
+
+  for (auto &source : sources) {
+    // unlike files, piped input isn't known to be too big until it's all been read
+    if (source.source().size() > max_source_size) {
+      had_error = true;
+      util::error(source.path().string() + ": File is larger than 4GiB!");
+    } else if (!normalize(source)) {
+      had_error = true;
+      util::error(source.path().string() + ": File is not valid UTF-8!");
+    }
   }
 
   if (had_error) {
@@ -117,7 +487,3 @@ opt_file_list file_reader::read(options &opts) {
     return sources;
   }
 }
-
-opt_file_list pipe_reader::read([[maybe_unused]] options &opts) {
-  throw std::logic_error{"Not implemented!"};
-}
@@ -26,24 +26,70 @@
 #define CASCADE_UTIL_SOURCE_READER_HH
 
 #include "util/argument_parser.hh"
+#include "util/hash.hh"
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
 namespace cascade::util {
-  /** @brief Represents a file that was successfully read */
+  class thread_pool;
+
+  /** @brief The biggest file that can be compiled, source info stores 32-bit offsets */
+  inline constexpr std::size_t max_source_size = std::numeric_limits<std::uint32_t>::max();
+
+  /**
+   * @brief Represents a file that was successfully read
+   * @details The source is either a memory mapping of the file or a string owned
+   * by the file_source, copies share the same storage. The source never moves
+   * once the file_source is created, `source()` views stay valid as long as any
+   * copy of it is alive.
+   */
   class file_source {
     std::filesystem::path m_path;
-    std::string m_source;
 
-    friend void normalize(file_source &);
+    /** @brief Owns whatever `m_source` points into */
+    std::shared_ptr<const char> m_storage;
+
+    std::string_view m_source;
+
+    /** @brief Hash of `m_source`, filled in by `normalize` */
+    hash128 m_hash = {0, 0};
+
+    /** @brief The module a manifest put the file in, empty if it wasn't given one */
+    std::string m_module;
+
+    friend bool normalize(file_source &, const std::filesystem::path &);
 
   public:
-    file_source(std::filesystem::path path, std::string source)
+    file_source(std::filesystem::path path, std::string source);
+
+    /**
+     * @brief Creates a file whose source is owned by something else
+     * @param path The path of the file
+     * @param storage Keeps @p source alive
+     * @param source The source code, must point into memory owned by @p storage
+     */
+    file_source(std::filesystem::path path,
+        std::shared_ptr<const char> storage,
+        std::string_view source)
         : m_path(std::move(path))
-        , m_source(std::move(source)) {}
+        , m_storage(std::move(storage))
+        , m_source(source) {}
+
+    /**
+     * @brief Maps a file into memory, the source points straight into the mapping
+     * @details Falls back to reading the file into a string where mmap isn't available
+     * @param path The file to map
+     * @return The file, or nothing if it couldn't be opened/mapped
+     */
+    static std::optional<file_source> map(std::filesystem::path path);
 
     /**
      * @brief Returns the source code
@@ -53,16 +99,54 @@ namespace cascade::util {
 
     /**
      * @brief Returns the path
-     * @return A copy of the path
+     * @return A reference to the path
+     */
+    const std::filesystem::path &path() const { return m_path; }
+
+    /**
+     * @brief Returns a hash of the source code, for keying caches on
+     * @details Computed by `normalize`, so it's the hash of the source after
+     * CRLFs are removed. Both source readers normalize every file they return
+     * @return The hash of `source()`
+     */
+    hash128 hash() const { return m_hash; }
+
+    /**
+     * @brief Returns the module the file is in
+     * @details Only files listed in a manifest can have one, see `compilation_options::modules`
+     * @return The module name, empty if the file wasn't given one
+     */
+    const std::string &module() const { return m_module; }
+
+    /**
+     * @brief Sets the module the file is in
+     * @param module The module name
+     */
+    void set_module(std::string module) { m_module = std::move(module); }
+
+    /**
+     * @brief Creates a file out of part of this one's source, without copying it
+     * @param path The path of the new file
+     * @param offset Where the new file's source begins
+     * @param length The length of the new file's source
+     * @return The new file, sharing storage with this one
      */
-    std::filesystem::path path() const { return m_path; }
+    file_source slice(std::filesystem::path path, std::size_t offset, std::size_t length) const {
+      return file_source(std::move(path), m_storage, m_source.substr(offset, length));
+    }
   };
 
   /**
-   * @brief "Normalizes" a string by turning it into UTF-8 LF
+   * @brief "Normalizes" a file by checking it's UTF-8 and turning it into LF
+   * @details Validating and looking for CRs is one pass, the source is only
+   * copied (and the mapping dropped) if there actually are CRs to remove. The
+   * content hash is computed here too, on the final source
    * @param ref The file to normalize
+   * @param base The directory the path is made relative to
+   * @return Whether the file is valid UTF-8
    */
-  void normalize(file_source &ref);
+  [[nodiscard]] bool normalize(file_source &ref,
+      const std::filesystem::path &base = std::filesystem::current_path());
 
   /**
    * @brief Marker type for a type that can be used to read source code.
@@ -92,13 +176,32 @@ namespace cascade::util {
      * @return The source string(s)
      */
     static opt_file_list read(options &options);
+
+    /**
+     * @brief Loads every file on the threads in @p pool, in batches
+     * @details Each file is one open, one fstat and one mmap, nothing else touches
+     * the filesystem. Every file that failed is reported, in the order they were given
+     * @param options The program options
+     * @param pool The pool to load on
+     * @return The files in the order they were given, or nothing if any failed
+     */
+    static opt_file_list read(options &options, thread_pool &pool);
   };
 
-  /** @brief Reads source from input piped into the program */
+  /**
+   * @brief Reads source from input piped into the program
+   * @details Normally stdin is one file. With `--framed`, stdin is any number of
+   * files, each one is a `<length> <path>\n` header line followed by exactly
+   * `length` bytes of source. Blank lines between files are ignored.
+   */
   class pipe_reader : public source_reading_policy<pipe_reader> {
   public:
     /**
-     * @brief Reads from the stdin pipe
+     * @brief Reads everything from stdin
+     * @details Pipes are spliced into a memfd and mapped where that's supported,
+     * otherwise they're read into a buffer that grows geometrically. Files
+     * redirected into stdin are mapped directly. Framed files all share the
+     * one buffer.
      * @param options The program arguments
      * @return The source string(s)
      */
@@ -0,0 +1,95 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/thread_pool.cc:
+ *   Implements the `thread_pool` class
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "util/thread_pool.hh"
+#include <algorithm>
+
+using namespace cascade::util;
+
+thread_pool::thread_pool(std::size_t threads) {
+  if (threads == 0) {
+    // hardware_concurrency is allowed to return 0 if it can't tell
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  m_workers.reserve(threads);
+
+  for (std::size_t i = 0; i < threads; ++i) {
+    m_workers.emplace_back([this] { work(); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard lock(m_mutex);
+
+    m_stopping = true;
+  }
+
+  m_available.notify_all();
+
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+void thread_pool::work() {
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock lock(m_mutex);
+
+      m_available.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+      // anything already queued still gets run before the workers exit
+      if (m_tasks.empty()) {
+        return;
+      }
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+bool thread_pool::run_one() {
+  std::function<void()> task;
+
+  {
+    std::lock_guard lock(m_mutex);
+
+    if (m_tasks.empty()) {
+      return false;
+    }
+
+    task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+  }
+
+  task();
+
+  return true;
+}
@@ -0,0 +1,120 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * util/thread_pool.hh:
+ *   Defines a small fixed-size pool of worker threads
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_UTIL_THREAD_POOL_HH
+#define CASCADE_UTIL_THREAD_POOL_HH
+
+#include "util/mixins.hh"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cascade::util {
+  /** @brief A fixed set of worker threads that run submitted tasks in FIFO order */
+  class thread_pool : noncopyable {
+    /** @brief The worker threads */
+    std::vector<std::thread> m_workers;
+
+    /** @brief Tasks that haven't been picked up by a worker yet */
+    std::deque<std::function<void()>> m_tasks;
+
+    /** @brief Guards `m_tasks` and `m_stopping` */
+    std::mutex m_mutex;
+
+    /** @brief Signalled whenever a task is added or the pool is stopping */
+    std::condition_variable m_available;
+
+    /** @brief Set when the pool is being destroyed */
+    bool m_stopping = false;
+
+    /** @brief The loop each worker runs */
+    void work();
+
+    /**
+     * @brief Runs one queued task on the calling thread, if there are any
+     * @return Whether a task was run
+     */
+    bool run_one();
+
+  public:
+    /**
+     * @brief Starts the worker threads
+     * @param threads The number of workers, 0 means one per hardware thread
+     */
+    explicit thread_pool(std::size_t threads = 0);
+
+    /** @brief Finishes every queued task and joins the workers */
+    ~thread_pool();
+
+    /** @brief Returns the number of worker threads */
+    [[nodiscard]] std::size_t size() const { return m_workers.size(); }
+
+    /**
+     * @brief Queues a task to be run on a worker
+     * @param task The function to run
+     * @return A future for the result of @p task, exceptions are forwarded through it
+     */
+    template <class F> [[nodiscard]] std::future<std::invoke_result_t<F>> submit(F task) {
+      // std::function needs a copyable target, packaged_task isn't one
+      using result_type = std::invoke_result_t<F>;
+
+      auto packaged = std::make_shared<std::packaged_task<result_type()>>(std::move(task));
+      auto result = packaged->get_future();
+
+      {
+        std::lock_guard lock(m_mutex);
+
+        m_tasks.emplace_back([packaged] { (*packaged)(); });
+      }
+
+      m_available.notify_one();
+
+      return result;
+    }
+
+    /**
+     * @brief Waits for a future, running queued tasks on this thread in the meantime
+     * @details Makes it safe for a task running on the pool to wait on tasks it
+     * submitted itself, the pool can't deadlock with every worker waiting
+     * @param future The future to wait for
+     */
+    template <class T> void wait(const std::future<T> &future) {
+      while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!run_one()) {
+          // whatever is left is already running on a worker
+          future.wait();
+        }
+      }
+    }
+  };
+} // namespace cascade::util
+
+#endif
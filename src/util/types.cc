@@ -96,9 +96,9 @@ std::string util::to_string(const ast::type_data &node) {
         default:
           assert(false && "how exactly did we get here");
       }
-    } else if constexpr (std::is_same_v<T, std::string>) {
+    } else if constexpr (std::is_same_v<T, util::strong_symbol>) {
       assert(node.base() == base::user_defined);
-      str += data;
+      str += util::interner::instance().lookup(data.id);
     } else {
       // will show the type that caused the failure
       static_assert(always_false_v<T>, "util::to_string: non-exhaustive visitor");
@@ -0,0 +1,626 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * tests/ast/flat.cc:
+ *   Checks that flattening a program loses nothing, and that flat visitors
+ *   see the same nodes that tree visitors do
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "ast/ast.hh"
+#include "ast/flat.hh"
+#include "core/parser.hh"
+#include "errors/diagnostic.hh"
+#include "util/source_manager.hh"
+#include "util/types.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace cascade;
+
+namespace flat = ast::flat;
+namespace fs = std::filesystem;
+
+/** @brief Writes out the kind and position of a node */
+static void head(std::string &out, ast::kind kind, const core::source_info &info) {
+  out += "(" + std::to_string(static_cast<int>(kind)) + "@" + std::to_string(info.position())
+         + ":" + std::to_string(info.length());
+}
+
+/** @brief Writes out a value stored in a node */
+template <class T> static void field(std::string &out, const T &value) {
+  out += ' ';
+
+  if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+    out += '"';
+    out += value;
+    out += '"';
+  } else {
+    out += std::to_string(value);
+  }
+}
+
+/** @brief Writes out the bits of a float, so any difference at all shows up */
+static void field_bits(std::string &out, double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  field(out, bits);
+}
+
+/**
+ * @brief Writes out every node of a tree, with everything stored in each one
+ * @details Has to write exactly what `flat_dump` does for the same program
+ */
+class tree_dump : public ast::visitor<void> {
+  std::string &m_out;
+
+  void child(ast::node &node) { node.accept(*this); }
+
+  template <class T> void optional(const T &node) {
+    if (node) {
+      child(node->get());
+    } else {
+      m_out += " none";
+    }
+  }
+
+  template <class T> void binding(T &ref) {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    child(ref.type());
+    child(ref.initializer());
+    m_out += ")";
+  }
+
+public:
+  explicit tree_dump(std::string &out) : m_out(out) {}
+
+  void visit(ast::type &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, util::to_string(ref.data()));
+    m_out += ")";
+  }
+
+  void visit(ast::const_decl &ref) final { binding(ref); }
+
+  void visit(ast::static_decl &ref) final { binding(ref); }
+
+  void visit(ast::let &ref) final { binding(ref); }
+
+  void visit(ast::mut &ref) final { binding(ref); }
+
+  void visit(ast::argument &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    child(ref.type());
+    m_out += ")";
+  }
+
+  void visit(ast::fn &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    child(ref.type());
+
+    for (auto &arg : ref.args()) {
+      child(arg);
+    }
+
+    if (ref.skimmed()) {
+      m_out += " skimmed";
+    } else {
+      child(ref.body());
+    }
+
+    m_out += ")";
+  }
+
+  void visit(ast::module_decl &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    m_out += ")";
+  }
+
+  void visit(ast::import_decl &) final { throw std::logic_error{"imports can't be flattened"}; }
+
+  void visit(ast::export_decl &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.exported());
+    m_out += ")";
+  }
+
+  void visit(ast::char_literal &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.value()));
+    m_out += ")";
+  }
+
+  void visit(ast::string_literal &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.value());
+    m_out += ")";
+  }
+
+  void visit(ast::int_literal &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.value());
+    field(m_out, static_cast<int>(ref.suffix()));
+    m_out += ")";
+  }
+
+  void visit(ast::float_literal &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field_bits(m_out, ref.value());
+    field(m_out, static_cast<int>(ref.suffix()));
+    m_out += ")";
+  }
+
+  void visit(ast::bool_literal &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.value()));
+    m_out += ")";
+  }
+
+  void visit(ast::identifier &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    m_out += ")";
+  }
+
+  void visit(ast::call &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.callee());
+
+    for (auto &arg : ref.args()) {
+      child(*arg);
+    }
+
+    m_out += ")";
+  }
+
+  void visit(ast::binary &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.op()));
+    child(ref.lhs());
+    child(ref.rhs());
+    m_out += ")";
+  }
+
+  void visit(ast::unary &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.op()));
+    child(ref.rhs());
+    m_out += ")";
+  }
+
+  void visit(ast::field_access &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.accessed());
+    field(m_out, ref.field_name());
+    m_out += ")";
+  }
+
+  void visit(ast::index &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.array());
+    child(ref.idx());
+    m_out += ")";
+  }
+
+  void visit(ast::if_else &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.condition());
+    child(ref.true_clause());
+    optional(ref.else_clause());
+    m_out += ")";
+  }
+
+  void visit(ast::struct_init &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+
+    for (auto &pair : ref.pairs()) {
+      field(m_out, pair.field_name);
+      child(*pair.value);
+    }
+
+    m_out += ")";
+  }
+
+  void visit(ast::block &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.type());
+
+    for (auto &stmt : ref.statements()) {
+      child(*stmt);
+    }
+
+    m_out += ")";
+  }
+
+  void visit(ast::expression_statement &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.expr());
+    m_out += ")";
+  }
+
+  void visit(ast::ret &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    optional(ref.return_value());
+    m_out += ")";
+  }
+
+  void visit(ast::loop &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    optional(ref.condition());
+    child(ref.body());
+    m_out += ")";
+  }
+
+  void visit(ast::type_decl &ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.type());
+    field(m_out, ref.name());
+    m_out += ")";
+  }
+};
+
+/** @brief Writes out every node of a flat program, the same way `tree_dump` does */
+class flat_dump : public flat::visitor<void> {
+  std::string &m_out;
+
+  void child(flat::view node) { node.accept(*this); }
+
+  void optional(std::optional<flat::view> node) {
+    if (node) {
+      child(*node);
+    } else {
+      m_out += " none";
+    }
+  }
+
+  void binding(flat::binding ref) {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    child(ref.type());
+    child(ref.initializer());
+    m_out += ")";
+  }
+
+public:
+  explicit flat_dump(std::string &out) : m_out(out) {}
+
+  void visit(flat::type ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, util::to_string(ref.data()));
+    m_out += ")";
+  }
+
+  void visit(flat::const_decl ref) final { binding(ref); }
+
+  void visit(flat::static_decl ref) final { binding(ref); }
+
+  void visit(flat::let ref) final { binding(ref); }
+
+  void visit(flat::mut ref) final { binding(ref); }
+
+  void visit(flat::argument ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    child(ref.type());
+    m_out += ")";
+  }
+
+  void visit(flat::fn ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    child(ref.type());
+
+    for (auto arg : ref.args()) {
+      child(arg);
+    }
+
+    if (ref.skimmed()) {
+      m_out += " skimmed";
+    } else {
+      child(ref.body());
+    }
+
+    m_out += ")";
+  }
+
+  void visit(flat::module_decl ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    m_out += ")";
+  }
+
+  void visit(flat::import_decl) final { throw std::logic_error{"imports can't be flattened"}; }
+
+  void visit(flat::export_decl ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.exported());
+    m_out += ")";
+  }
+
+  void visit(flat::char_literal ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.value()));
+    m_out += ")";
+  }
+
+  void visit(flat::string_literal ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.value());
+    m_out += ")";
+  }
+
+  void visit(flat::int_literal ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.value());
+    field(m_out, static_cast<int>(ref.suffix()));
+    m_out += ")";
+  }
+
+  void visit(flat::float_literal ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field_bits(m_out, ref.value());
+    field(m_out, static_cast<int>(ref.suffix()));
+    m_out += ")";
+  }
+
+  void visit(flat::bool_literal ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.value()));
+    m_out += ")";
+  }
+
+  void visit(flat::identifier ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+    m_out += ")";
+  }
+
+  void visit(flat::call ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.callee());
+
+    for (auto arg : ref.args()) {
+      child(arg);
+    }
+
+    m_out += ")";
+  }
+
+  void visit(flat::binary ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.op()));
+    child(ref.lhs());
+    child(ref.rhs());
+    m_out += ")";
+  }
+
+  void visit(flat::unary ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, static_cast<int>(ref.op()));
+    child(ref.rhs());
+    m_out += ")";
+  }
+
+  void visit(flat::field_access ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.accessed());
+    field(m_out, ref.field_name());
+    m_out += ")";
+  }
+
+  void visit(flat::index ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.array());
+    child(ref.idx());
+    m_out += ")";
+  }
+
+  void visit(flat::if_else ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.condition());
+    child(ref.true_clause());
+    optional(ref.else_clause());
+    m_out += ")";
+  }
+
+  void visit(flat::struct_init ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    field(m_out, ref.name());
+
+    for (auto i = std::size_t{0}; i < ref.size(); ++i) {
+      field(m_out, ref.field_id(i));
+      child(ref.value(i));
+    }
+
+    m_out += ")";
+  }
+
+  void visit(flat::block ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.type());
+
+    for (auto stmt : ref.statements()) {
+      child(stmt);
+    }
+
+    m_out += ")";
+  }
+
+  void visit(flat::expression_statement ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.expr());
+    m_out += ")";
+  }
+
+  void visit(flat::ret ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    optional(ref.return_value());
+    m_out += ")";
+  }
+
+  void visit(flat::loop ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    optional(ref.condition());
+    child(ref.body());
+    m_out += ")";
+  }
+
+  void visit(flat::type_decl ref) final {
+    head(m_out, ref.raw_kind(), ref.info());
+    child(ref.type());
+    field(m_out, ref.name());
+    m_out += ")";
+  }
+};
+
+/** @brief Dumps every declaration of a tree */
+static std::string dump(ast::program &prog) {
+  auto out = std::string{};
+  auto visitor = tree_dump{out};
+
+  for (auto &decl : prog.decls()) {
+    decl->accept(visitor);
+  }
+
+  return out;
+}
+
+/** @brief Dumps every declaration of a flat program */
+static std::string dump(const ast::flat_program &prog) {
+  auto out = std::string{};
+  auto visitor = flat_dump{out};
+
+  for (auto decl : flat::decls(prog)) {
+    decl.accept(visitor);
+  }
+
+  return out;
+}
+
+/**
+ * @brief Reports where two dumps stop matching
+ * @return Whether they matched
+ */
+static bool same(const std::string &name,
+    const char *what,
+    const std::string &expected,
+    const std::string &actual) {
+  if (expected == actual) {
+    return true;
+  }
+
+  auto at = std::mismatch(expected.begin(), expected.end(), actual.begin(), actual.end());
+
+  std::fprintf(stderr,
+      "%s: %s differs at character %zu\n",
+      name.c_str(),
+      what,
+      static_cast<std::size_t>(at.first - expected.begin()));
+
+  return false;
+}
+
+/**
+ * @brief Checks one file, both fully parsed and skimmed
+ * @return Whether every check passed
+ */
+static bool check(const std::string &name, util::file_id file) {
+  auto errors = 0;
+  auto report = [&errors](std::unique_ptr<errors::error>) { ++errors; };
+  auto diagnostics = errors::diagnostic_sink{file};
+  auto prog = core::parse(core::lexer{file, diagnostics}, report);
+
+  if (errors != 0 || !diagnostics.records().empty()) {
+    std::fprintf(stderr, "%s: doesn't parse cleanly\n", name.c_str());
+
+    return false;
+  }
+
+  auto expected = dump(prog);
+  auto flattened = ast::flatten(prog);
+  auto rebuilt = ast::unflatten(flattened);
+  auto passed = same(name, "flat visitor", expected, dump(flattened));
+
+  passed = same(name, "unflattened tree", expected, dump(rebuilt)) && passed;
+  passed = same(name, "reflattened program", expected, dump(ast::flatten(rebuilt))) && passed;
+
+  // skimmed fns have no body in the flat program, everything else is the same
+  auto skim_diagnostics = errors::diagnostic_sink{file};
+  auto tokens = core::lexer{file, skim_diagnostics}.lex();
+  auto skimmed = core::skim(std::move(tokens), report);
+
+  passed = same(name, "skimmed program", dump(skimmed.program()), dump(ast::flatten(skimmed.program())))
+           && passed;
+
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <corpus directory>\n", argv[0]);
+
+    return 2;
+  }
+
+  auto &manager = util::source_manager::instance();
+  auto paths = std::vector<fs::path>{};
+
+  for (auto &entry : fs::directory_iterator(argv[1])) {
+    if (entry.path().extension() == ".cas") {
+      paths.push_back(entry.path());
+    }
+  }
+
+  std::sort(paths.begin(), paths.end());
+
+  if (paths.empty()) {
+    std::fprintf(stderr, "no .cas files in '%s'\n", argv[1]);
+
+    return 2;
+  }
+
+  auto failed = 0;
+
+  for (auto &path : paths) {
+    auto source = util::file_source::map(path);
+
+    if (!source) {
+      std::fprintf(stderr, "unable to read '%s'\n", path.c_str());
+
+      return 2;
+    }
+
+    failed += check(path.filename().string(), manager.add(std::move(*source))) ? 0 : 1;
+  }
+
+  std::printf("%zu files, %d failed\n", paths.size(), failed);
+
+  return (failed == 0) ? 0 : 1;
+}
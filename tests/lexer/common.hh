@@ -0,0 +1,232 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * tests/lexer/common.hh:
+ *   Inputs and comparisons shared by the lexer's differential tests
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CASCADE_TESTS_LEXER_COMMON_HH
+#define CASCADE_TESTS_LEXER_COMMON_HH
+
+#include "core/lexer.hh"
+#include "errors/diagnostic.hh"
+#include "util/source_manager.hh"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cascade::tests {
+  /** @brief A named file registered with the source_manager */
+  using named_file = std::pair<std::string, util::file_id>;
+
+  /**
+   * @brief Pieces that generated files are built out of, picked to land split
+   * points and edits inside strings, chars and comments as often as possible
+   */
+  inline constexpr std::array<std::string_view, 26> fragments = {
+      "let x = 1;\n",
+      "fn f(a: i32): i32 { ret a * 2; }\n",
+      "\"a string\" ",
+      "\"escaped \\\" quote\" ",
+      "\"ends in a backslash \\\\\" ",
+      "\"-- not a comment\" ",
+      "\"-* not a block *-\" ",
+      "'\\'' ",
+      "'\"' ",
+      "'-' ",
+      "-- line comment \" with ' quotes\n",
+      "-* block comment \" with ' quotes *- ",
+      "-* block comment\n   over -- lines *-\n",
+      "-*-*- *- ",
+      "a - * b ",
+      "a-=-b; ",
+      "12345678901234567890 ",
+      "99999999999999999999999 ",
+      "3.14f32 255u8 0x1F ",
+      "ident_with_numbers123 ",
+      "\t\r\n",
+      "@#~ ",
+      "1\xC3\xA9 0x1F\xC3\xA9 ",
+      "\xC3\xA9t\xC3\xA9 ",
+      "\"unterminated\n",
+      "'u\n",
+  };
+
+  /**
+   * @brief Builds a file out of random fragments
+   * @param seed The seed, the same seed always gives the same file
+   * @param size The minimum size of the file
+   * @return The file
+   */
+  inline std::string generate(std::uint32_t seed, std::size_t size) {
+    auto engine = std::mt19937{seed};
+    auto pick = std::uniform_int_distribution<std::size_t>{0, fragments.size() - 1};
+    auto result = std::string{};
+
+    result.reserve(size + 64);
+
+    while (result.size() < size) {
+      result += fragments[pick(engine)];
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Reports a mismatch
+   * @param name The name of the input (and whatever else identifies the case)
+   * @param what What didn't match
+   * @param index Where it didn't match
+   */
+  inline void mismatch(const std::string &name, const char *what, std::size_t index) {
+    std::fprintf(stderr, "%s: %s differs at index %zu\n", name.c_str(), what, index);
+  }
+
+  /**
+   * @brief Checks that two token buffers hold the same tokens
+   * @return Whether they're the same
+   */
+  inline bool same_tokens(const std::string &name,
+      const core::token_buffer &expected,
+      const core::token_buffer &actual) {
+    if (expected.size() != actual.size()) {
+      mismatch(name, "token count", std::min(expected.size(), actual.size()));
+
+      return false;
+    }
+
+    for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+      auto lhs = expected[i];
+      auto rhs = actual[i];
+
+      if (lhs.type() != rhs.type() || lhs.position() != rhs.position()
+          || lhs.length() != rhs.length() || lhs.raw() != rhs.raw()
+          || lhs.suffix() != rhs.suffix() || lhs.integer() != rhs.integer()) {
+        mismatch(name, "token", i);
+
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Checks that two sinks got the same diagnostics, in the same order
+   * @return Whether they're the same
+   */
+  inline bool same_diagnostics(const std::string &name,
+      const errors::diagnostic_sink &expected,
+      const errors::diagnostic_sink &actual) {
+    auto &lhs = expected.records();
+    auto &rhs = actual.records();
+
+    if (lhs.size() != rhs.size() || expected.dropped() != actual.dropped()) {
+      mismatch(name, "diagnostic count", std::min(lhs.size(), rhs.size()));
+
+      return false;
+    }
+
+    for (auto i = std::size_t{0}; i < lhs.size(); ++i) {
+      if (lhs[i].code != rhs[i].code || lhs[i].offset != rhs[i].offset
+          || lhs[i].length != rhs[i].length || lhs[i].note != rhs[i].note) {
+        mismatch(name, "diagnostic", i);
+
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Registers every input the lexer tests run over
+   * @details Every `.cas` file in @p corpus on its own, then all of them glued
+   * together a few times over, then files generated out of `fragments`. The last
+   * one is several MiB, so even the parallel lexer's default chunk size splits it
+   * @param corpus The corpus directory
+   * @return The inputs, or nothing if the corpus couldn't be read
+   */
+  inline std::optional<std::vector<named_file>> load_inputs(const char *corpus) {
+    namespace fs = std::filesystem;
+
+    auto &manager = util::source_manager::instance();
+    auto files = std::vector<named_file>{};
+    auto paths = std::vector<fs::path>{};
+
+    for (auto &entry : fs::directory_iterator(corpus)) {
+      if (entry.path().extension() == ".cas") {
+        paths.push_back(entry.path());
+      }
+    }
+
+    std::sort(paths.begin(), paths.end());
+
+    if (paths.empty()) {
+      std::fprintf(stderr, "no .cas files in '%s'\n", corpus);
+
+      return std::nullopt;
+    }
+
+    auto combined = std::string{};
+
+    for (auto &path : paths) {
+      auto source = util::file_source::map(path);
+
+      if (!source) {
+        std::fprintf(stderr, "unable to read '%s'\n", path.c_str());
+
+        return std::nullopt;
+      }
+
+      combined += source->source();
+      combined += '\n';
+      files.emplace_back(path.filename().string(), manager.add(std::move(*source)));
+    }
+
+    auto repeated = std::string{};
+
+    while (repeated.size() < (1 << 18)) {
+      repeated += combined;
+    }
+
+    files.emplace_back("<corpus, repeated>",
+        manager.add(util::file_source("repeated.cas", repeated)));
+
+    for (auto seed = std::uint32_t{1}; seed <= 8; ++seed) {
+      auto name = "<generated, seed " + std::to_string(seed) + ">";
+      auto size = std::size_t{1} << (10 + seed);
+
+      files.emplace_back(name, manager.add(util::file_source(name, generate(seed, size))));
+    }
+
+    files.emplace_back("<generated, 4 MiB>",
+        manager.add(util::file_source("large.cas", generate(9, std::size_t{4} << 20))));
+
+    return files;
+  }
+} // namespace cascade::tests
+
+#endif
@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * tests/lexer/legacy_lex.cc:
+ *   Checks that the DFA lexer gives exactly what the hand-written one does
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "common.hh"
+#include "core/lexer.hh"
+#include "errors/diagnostic.hh"
+#include <cstdio>
+#include <string>
+
+using cascade::core::lexer;
+using cascade::core::lexer_engine;
+using cascade::errors::diagnostic_sink;
+using cascade::util::file_id;
+
+namespace tests = cascade::tests;
+
+/**
+ * @brief Lexes a file with both engines, comparing the results
+ * @return Whether they matched
+ */
+static bool check(const std::string &name, file_id file) {
+  auto expected_sink = diagnostic_sink{file};
+  auto expected = lexer{file, expected_sink, lexer_engine::legacy}.lex();
+  auto actual_sink = diagnostic_sink{file};
+  auto actual = lexer{file, actual_sink, lexer_engine::dfa}.lex();
+
+  auto passed = tests::same_tokens(name, expected, actual);
+
+  return tests::same_diagnostics(name, expected_sink, actual_sink) && passed;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <corpus directory>\n", argv[0]);
+
+    return 2;
+  }
+
+  auto files = tests::load_inputs(argv[1]);
+
+  if (!files) {
+    return 2;
+  }
+
+  auto failed = 0;
+
+  for (auto &[name, file] : *files) {
+    failed += check(name, file) ? 0 : 1;
+  }
+
+  std::printf("%zu files, %d failed\n", files->size(), failed);
+
+  return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * tests/lexer/parallel_lex.cc:
+ *   Checks that `lexer::lex(pool, n)` gives exactly what `lexer::lex()` does
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "common.hh"
+#include "core/lexer.hh"
+#include "errors/diagnostic.hh"
+#include "util/thread_pool.hh"
+#include <array>
+#include <cstdio>
+#include <string>
+
+using cascade::core::lexer;
+using cascade::errors::diagnostic_sink;
+using cascade::util::file_id;
+using cascade::util::thread_pool;
+
+namespace tests = cascade::tests;
+
+/** @brief Chunk sizes to split every file with, small ones force splits inside tiny files */
+static constexpr std::array<std::size_t, 6> chunk_sizes = {7, 64, 1000, 4096, 65536, 1 << 20};
+
+/**
+ * @brief Lexes a file serially and then with every chunk size, comparing the results
+ * @return Whether every chunk size matched
+ */
+static bool check(thread_pool &pool, const std::string &name, file_id file) {
+  auto expected_sink = diagnostic_sink{file};
+  auto expected = lexer{file, expected_sink}.lex();
+  auto passed = true;
+
+  for (auto chunk : chunk_sizes) {
+    auto actual_sink = diagnostic_sink{file};
+    auto actual = lexer{file, actual_sink}.lex(pool, chunk);
+    auto label = name + " (chunk size " + std::to_string(chunk) + ")";
+
+    passed = tests::same_tokens(label, expected, actual) && passed;
+    passed = tests::same_diagnostics(label, expected_sink, actual_sink) && passed;
+  }
+
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <corpus directory>\n", argv[0]);
+
+    return 2;
+  }
+
+  auto files = tests::load_inputs(argv[1]);
+
+  if (!files) {
+    return 2;
+  }
+
+  auto pool = thread_pool{4};
+  auto failed = 0;
+
+  for (auto &[name, file] : *files) {
+    failed += check(pool, name, file) ? 0 : 1;
+  }
+
+  std::printf("%zu files, %d failed\n", files->size(), failed);
+
+  return (failed == 0) ? 0 : 1;
+}
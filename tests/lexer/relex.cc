@@ -0,0 +1,134 @@
+/*---------------------------------------------------------------------------*
+ *
+ * Copyright 2020 Evan Cox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *---------------------------------------------------------------------------*
+ *
+ * tests/lexer/relex.cc:
+ *   Checks that `lexer::relex` gives exactly what lexing the edited file does
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "common.hh"
+#include "core/lexer.hh"
+#include "errors/diagnostic.hh"
+#include "util/source_manager.hh"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+
+using cascade::core::lexer;
+using cascade::core::text_edit;
+using cascade::errors::diagnostic_sink;
+using cascade::util::file_id;
+using cascade::util::file_source;
+using cascade::util::source_manager;
+
+namespace tests = cascade::tests;
+
+/** @brief Number of edits made to each input, one after another */
+static constexpr int edits_per_file = 200;
+
+/**
+ * @brief Makes a random edit to @p source
+ * @details Inserted text is a random piece of a fragment, so edits open and
+ * close strings and comments as often as they change plain tokens
+ * @param engine The random engine
+ * @param source The source being edited
+ * @param storage Where the inserted text is kept, it has to outlive the edit
+ * @return The edit
+ */
+static text_edit random_edit(std::mt19937 &engine, std::string_view source, std::string &storage) {
+  auto pick = [&engine](std::size_t max) {
+    return std::uniform_int_distribution<std::size_t>{0, max}(engine);
+  };
+
+  auto fragment = tests::fragments[pick(tests::fragments.size() - 1)];
+  auto begin = pick(fragment.size());
+
+  storage = std::string(fragment.substr(begin, pick(fragment.size() - begin)));
+
+  auto offset = pick(source.size());
+  auto removed = pick(std::min<std::size_t>(source.size() - offset, 12));
+
+  return text_edit{offset, removed, storage};
+}
+
+/**
+ * @brief Makes a series of edits to a file, relexing after each one
+ * @return Whether every relex matched lexing the edited file from scratch
+ */
+static bool check(const std::string &name, file_id file, std::uint32_t seed) {
+  auto &manager = source_manager::instance();
+  auto engine = std::mt19937{seed};
+  auto sink = diagnostic_sink{file};
+  auto tokens = lexer{file, sink}.lex();
+
+  // only the latest source is kept, relex is allowed to never look at the old one
+  auto current = std::make_unique<std::string>(manager.source(file));
+  auto inserted = std::string{};
+
+  for (auto i = 0; i < edits_per_file; ++i) {
+    auto edit = random_edit(engine, *current, inserted);
+    auto edited = std::make_unique<std::string>(edit.apply(*current));
+    auto relex_sink = diagnostic_sink{file};
+
+    lexer::relex(tokens, *edited, edit, relex_sink);
+
+    auto fresh = manager.add(file_source(name, *edited));
+    auto expected_sink = diagnostic_sink{fresh};
+    auto expected = lexer{fresh, expected_sink}.lex();
+    auto label = name + " (edit " + std::to_string(i) + ")";
+
+    if (!tests::same_tokens(label, expected, tokens)) {
+      return false;
+    }
+
+    current = std::move(edited);
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <corpus directory>\n", argv[0]);
+
+    return 2;
+  }
+
+  auto files = tests::load_inputs(argv[1]);
+
+  if (!files) {
+    return 2;
+  }
+
+  auto failed = 0;
+  auto seed = std::uint32_t{0};
+
+  for (auto &[name, file] : *files) {
+    // every edit re-registers the whole file, the biggest inputs would just make this slow
+    if (source_manager::instance().source(file).size() > (1 << 16)) {
+      continue;
+    }
+
+    failed += check(name, file, ++seed) ? 0 : 1;
+  }
+
+  std::printf("%u files, %d failed\n", seed, failed);
+
+  return (failed == 0) ? 0 : 1;
+}